@@ -35,6 +35,12 @@ subject to the following restrictions:
 
 #include <stdio.h> //printf debugging
 #include "GLDebugDrawer.h"
+#include "ProjectilePool.h"
+#include "DemoDynamicsWorld.h"
+#include "CollisionObjectReorder.h"
+#include "StaticGeometryBaker.h"
+#include "FrustumCuller.h"
+#include "OcclusionCuller.h"
 #include "LinearMath/btAabbUtil2.h"
 
 static GLDebugDrawer gDebugDraw;
@@ -71,7 +77,7 @@ void BasicDemo::clientMoveAndDisplay()
 	///step the simulation
 	if (m_dynamicsWorld)
 	{
-		m_dynamicsWorld->stepSimulation(ms / 1000000.f);
+		timedStepSimulation(ms / 1000000.f);
 		//optional but useful: debug drawing
 		m_dynamicsWorld->debugDrawWorld();
 
@@ -87,6 +93,9 @@ void BasicDemo::clientMoveAndDisplay()
 		
 	renderme(); 
 
+	//the debug drawer collected the lines of debugDrawWorld, draw them with the camera of this frame
+	gDebugDraw.flush();
+
 	glFlush();
 
 	swapBuffers();
@@ -104,6 +113,7 @@ void BasicDemo::displayCallback(void) {
 	//optional but useful: debug drawing to detect problems
 	if (m_dynamicsWorld)
 		m_dynamicsWorld->debugDrawWorld();
+	gDebugDraw.flush();
 
 	glFlush();
 	swapBuffers();
@@ -127,14 +137,21 @@ void	BasicDemo::initPhysics()
 	///use the default collision dispatcher. For parallel processing you can use a diffent dispatcher (see Extras/BulletMultiThreaded)
 	m_dispatcher = new	btCollisionDispatcher(m_collisionConfiguration);
 
-	m_broadphase = new btDbvtBroadphase();
+	btDbvtBroadphase* broadphase = new btDbvtBroadphase();
+	m_broadphase = broadphase;
+	///the frustum culling walks the broadphase trees directly
+	getFrustumCuller()->setDbvtBroadphase(broadphase);
+	getOcclusionCuller()->setDbvtBroadphase(broadphase);
 
 	///the default constraint solver. For parallel processing you can use a different solver (see Extras/BulletMultiThreaded)
 	btSequentialImpulseConstraintSolver* sol = new btSequentialImpulseConstraintSolver;
 	m_solver = sol;
 
-	m_dynamicsWorld = new btDiscreteDynamicsWorld(m_dispatcher,m_broadphase,m_solver,m_collisionConfiguration);
+	DemoDynamicsWorld* world = new DemoDynamicsWorld(m_dispatcher,m_broadphase,m_solver,m_collisionConfiguration);
+	m_dynamicsWorld = world;
 	m_dynamicsWorld->setDebugDrawer(&gDebugDraw);
+	///speculative contacts and the reorder of the non-static bodies hook into this world
+	setDemoDynamicsWorld(world);
 	
 	m_dynamicsWorld->setGravity(btVector3(0,-10,0));
 
@@ -169,6 +186,16 @@ void	BasicDemo::initPhysics()
 		m_dynamicsWorld->addRigidBody(body);
 	}
 
+	{
+		///projectiles that fall off the ground are recycled once they drop below its top,
+		///with room around it for shots fired from a camera outside the ground
+		btVector3 groundMin,groundMax;
+		groundShape->getAabb(groundTransform,groundMin,groundMax);
+		const btScalar margin(50.);
+		setProjectileWorldBounds(btVector3(groundMin.getX()-margin,groundMax.getY()-btScalar(10.),groundMin.getZ()-margin),
+			btVector3(groundMax.getX()+margin,groundMax.getY()+btScalar(1000.),groundMax.getZ()+margin));
+	}
+
 
 	{
 		//create a few dynamic rigidbodies
@@ -219,7 +246,28 @@ void	BasicDemo::initPhysics()
 		}
 	}
 
+	if (m_staticBaker)
+		m_staticBaker->bake(m_dynamicsWorld);
+}
+
+BasicDemo::~BasicDemo()
+{
+	exitPhysics();
+	delete m_staticBaker;
+}
 
+void	BasicDemo::setStaticGeometryBaking(bool enable,const char* cacheFileName)
+{
+	if (enable)
+	{
+		if (!m_staticBaker)
+			m_staticBaker = new StaticGeometryBaker();
+		m_staticBaker->setCacheFileName(cacheFileName);
+	} else
+	{
+		delete m_staticBaker;
+		m_staticBaker = 0;
+	}
 }
 void	BasicDemo::clientResetScene()
 {
@@ -233,6 +281,13 @@ void	BasicDemo::exitPhysics()
 
 	//cleanup in the reverse order of creation/initialization
 
+	//the projectile pool doesn't own its bodies, they are deleted below
+	if (getProjectilePool())
+		getProjectilePool()->clear();
+
+	if (getCollisionObjectReorder())
+		getCollisionObjectReorder()->clear();
+
 	//remove the rigidbodies from the dynamics world and delete them
 	int i;
 	for (i=m_dynamicsWorld->getNumCollisionObjects()-1; i>=0 ;i--)
@@ -251,14 +306,26 @@ void	BasicDemo::exitPhysics()
 	for (int j=0;j<m_collisionShapes.size();j++)
 	{
 		btCollisionShape* shape = m_collisionShapes[j];
+		m_shapeDrawer->invalidateShape(shape);
 		delete shape;
 	}
 	m_collisionShapes.clear();
 
+	//the baked body was deleted above, its mesh shape is owned by the baker
+	if (m_staticBaker)
+	{
+		if (m_staticBaker->getShape())
+			m_shapeDrawer->invalidateShape(m_staticBaker->getShape());
+		m_staticBaker->clear();
+	}
+
+	setDemoDynamicsWorld(0);
 	delete m_dynamicsWorld;
 	
 	delete m_solver;
 	
+	getFrustumCuller()->setDbvtBroadphase(0);
+	getOcclusionCuller()->setDbvtBroadphase(0);
 	delete m_broadphase;
 	
 	delete m_dispatcher;
@@ -32,6 +32,7 @@ class btCollisionDispatcher;
 class btConstraintSolver;
 struct btCollisionAlgorithmCreateFunc;
 class btDefaultCollisionConfiguration;
+class StaticGeometryBaker;
 
 ///BasicDemo is good starting point for learning the code base and porting.
 
@@ -49,19 +50,28 @@ class BasicDemo : public PlatformDemoApplication
 
 	btDefaultCollisionConfiguration* m_collisionConfiguration;
 
+	///optional, merges the static ground into one quantized BVH mesh in initPhysics
+	StaticGeometryBaker*	m_staticBaker;
+
 	public:
 
 	BasicDemo()
+		:m_staticBaker(0)
 	{
 	}
-	virtual ~BasicDemo()
-	{
-		exitPhysics();
-	}
+	virtual ~BasicDemo();
+
 	void	initPhysics();
 
 	void	exitPhysics();
 
+	///bake the static bodies on the next initPhysics, the BVH is cached in cacheFileName (0 or "" disables the cache)
+	void	setStaticGeometryBaking(bool enable,const char* cacheFileName);
+	StaticGeometryBaker*	getStaticGeometryBaker()
+	{
+		return m_staticBaker;
+	}
+
 	virtual void clientMoveAndDisplay();
 
 	virtual void displayCallback();
@@ -0,0 +1,85 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "DebugDrawBenchmark.h"
+#include "DemoApplication.h"
+#include "GLDebugDrawer.h"
+#include "GlutStuff.h"
+#include "btBulletDynamicsCommon.h"
+#include "LinearMath/btQuickprof.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void	runDebugDrawBenchmark(DemoApplication* demo,GLDebugDrawer* drawer,const DebugDrawBenchmarkSettings& settings,DebugDrawBenchmarkResults& results)
+{
+	memset(&results,0,sizeof(results));
+	results.m_minDebugDrawTime = 1e30;
+
+	btDynamicsWorld* world = demo->getDynamicsWorld();
+	if (!world)
+		return;
+
+	const int previousMode = demo->getDebugMode();
+	const bool previousBatching = drawer->setBatching(settings.m_batching);
+	demo->setDebugMode(settings.m_debugMode);
+
+	btClock frameClock;
+	btClock clock;
+	for (int frame=0;frame<settings.m_numFrames;frame++)
+	{
+		world->stepSimulation(settings.m_timeStep,1,settings.m_timeStep);
+
+		frameClock.reset();
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+		demo->renderme();
+		glFinish();
+
+		clock.reset();
+		world->debugDrawWorld();
+		drawer->flush();
+		glFinish();
+		const double debugDrawTime = clock.getTimeMicroseconds()*0.001;
+		const double frameTime = frameClock.getTimeMicroseconds()*0.001;
+		demo->swapBuffers();
+
+		results.m_numFrames++;
+		results.m_totalFrameTime += frameTime;
+		results.m_totalDebugDrawTime += debugDrawTime;
+		results.m_minDebugDrawTime = btMin(results.m_minDebugDrawTime,debugDrawTime);
+		results.m_maxDebugDrawTime = btMax(results.m_maxDebugDrawTime,debugDrawTime);
+	}
+	///the immediate mode draws as it goes, so only batched runs know the primitive counts
+	results.m_numLines = drawer->getNumFlushedLines();
+	results.m_numTriangles = drawer->getNumFlushedTriangles();
+
+	demo->setDebugMode(previousMode);
+	drawer->setBatching(previousBatching);
+	if (!results.m_numFrames)
+		results.m_minDebugDrawTime = 0.;
+}
+
+void	printDebugDrawBenchmarkResults(const DebugDrawBenchmarkSettings& settings,const DebugDrawBenchmarkResults& results)
+{
+	int numFrames = btMax(results.m_numFrames,1);
+	printf("--- debug draw benchmark (%s) ---\n",settings.m_batching ? "batched" : "immediate");
+	printf("frames            : %d (debug mode 0x%x)\n",results.m_numFrames,settings.m_debugMode);
+	if (settings.m_batching)
+		printf("primitives        : %d lines, %d triangles per frame\n",results.m_numLines,results.m_numTriangles);
+	printf("frame time        : %.3f ms avg\n",results.m_totalFrameTime/numFrames);
+	printf("debug draw time   : %.3f / %.3f / %.3f ms min/avg/max (%.1f %% of frame time)\n",
+		results.m_minDebugDrawTime,results.m_totalDebugDrawTime/numFrames,results.m_maxDebugDrawTime,
+		results.m_totalFrameTime > 0. ? 100.*results.m_totalDebugDrawTime/results.m_totalFrameTime : 0.);
+}
@@ -0,0 +1,61 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef DEBUG_DRAW_BENCHMARK_H
+#define DEBUG_DRAW_BENCHMARK_H
+
+#include "LinearMath/btScalar.h"
+#include "LinearMath/btIDebugDraw.h"
+
+class DemoApplication;
+class GLDebugDrawer;
+
+struct DebugDrawBenchmarkSettings
+{
+	int			m_numFrames;
+	btScalar	m_timeStep;
+	///btIDebugDraw::DebugDrawModes used for the run
+	int			m_debugMode;
+	///collect the primitives and draw them in GLDebugDrawer::flush, or draw each one in immediate mode
+	bool		m_batching;
+
+	DebugDrawBenchmarkSettings()
+		:m_numFrames(300),
+		m_timeStep(btScalar(1.)/btScalar(60.)),
+		m_debugMode(btIDebugDraw::DBG_DrawWireframe|btIDebugDraw::DBG_DrawAabb|btIDebugDraw::DBG_DrawContactPoints),
+		m_batching(true)
+	{
+	}
+};
+
+struct DebugDrawBenchmarkResults
+{
+	int		m_numFrames;
+	///lines and triangles of the last frame
+	int		m_numLines;
+	int		m_numTriangles;
+	///all times in milliseconds. The debug draw time covers debugDrawWorld and the flush until glFinish returns.
+	double	m_totalFrameTime;
+	double	m_totalDebugDrawTime;
+	double	m_minDebugDrawTime;
+	double	m_maxDebugDrawTime;
+};
+
+///runDebugDrawBenchmark steps the world and draws numFrames frames with debugDrawWorld on top of renderme.
+///It needs a current OpenGL context, and the drawer must be the debug drawer of the demo's world.
+void	runDebugDrawBenchmark(DemoApplication* demo,GLDebugDrawer* drawer,const DebugDrawBenchmarkSettings& settings,DebugDrawBenchmarkResults& results);
+
+void	printDebugDrawBenchmarkResults(const DebugDrawBenchmarkSettings& settings,const DebugDrawBenchmarkResults& results);
+
+#endif //DEBUG_DRAW_BENCHMARK_H
@@ -0,0 +1,187 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "EdgeBuildBenchmark.h"
+#include "GL_ShapeDrawer.h"
+#include "LinearMath/btConvexHullComputer.h"
+#include "LinearMath/btAlignedAllocator.h"
+#include "LinearMath/btQuickprof.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+///gives the benchmark access to the protected edge builder of GL_ShapeDrawer
+class EdgeBenchmarkShapeDrawer : public GL_ShapeDrawer
+{
+public:
+	typedef ShapeCache::Edge	Edge;
+
+	static void	build(const btAlignedObjectArray<unsigned int>& indices,const btAlignedObjectArray<btVector3>& vertices,btAlignedObjectArray<Edge>& edges)
+	{
+		buildEdges(&indices[0],indices.size(),&vertices[0],edges);
+	}
+};
+
+///the previous edge builder, a vertex x vertex table of edge pointers
+static void	buildEdgesDense(const btAlignedObjectArray<unsigned int>& indices,const btAlignedObjectArray<btVector3>& vertices,btAlignedObjectArray<EdgeBenchmarkShapeDrawer::Edge>& result)
+{
+	typedef EdgeBenchmarkShapeDrawer::Edge Edge;
+	const int			ni=indices.size();
+	const int			nv=vertices.size();
+	const unsigned int*	pi=&indices[0];
+	const btVector3*	pv=&vertices[0];
+	btAlignedObjectArray<Edge*>	edges;
+	result.reserve(ni);
+	edges.resize(nv*nv,0);
+	for(int i=0;i<ni;i+=3)
+	{
+		const unsigned int* ti=pi+i;
+		const btVector3		nrm=btCross(pv[ti[1]]-pv[ti[0]],pv[ti[2]]-pv[ti[0]]).normalized();
+		for(int j=2,k=0;k<3;j=k++)
+		{
+			const unsigned int	a=ti[j];
+			const unsigned int	b=ti[k];
+			Edge*&	e=edges[btMin(a,b)*nv+btMax(a,b)];
+			if(!e)
+			{
+				result.push_back(Edge());
+				e=&result[result.size()-1];
+				e->n[0]=nrm;e->n[1]=-nrm;
+				e->v[0]=a;e->v[1]=b;
+			}
+			else
+			{
+				e->n[1]=nrm;
+			}
+		}
+	}
+}
+
+///allocation tracking, only active while one build is measured
+static size_t	sCurrentBytes = 0;
+static size_t	sPeakBytes = 0;
+
+static void*	trackingAlloc(size_t size)
+{
+	char* block = (char*)malloc(size+16);
+	*(size_t*)block = size;
+	sCurrentBytes += size;
+	if (sCurrentBytes > sPeakBytes)
+		sPeakBytes = sCurrentBytes;
+	return block+16;
+}
+
+static void		trackingFree(void* ptr)
+{
+	if (!ptr)
+		return;
+	char* block = (char*)ptr-16;
+	sCurrentBytes -= *(size_t*)block;
+	free(block);
+}
+
+///convex hull of points spread evenly over a sphere (Fibonacci lattice), all points end up on the hull
+static void	createSphereHull(int numPoints,btAlignedObjectArray<btVector3>& vertices,btAlignedObjectArray<unsigned int>& indices)
+{
+	btAlignedObjectArray<btVector3> points;
+	for (int i=0;i<numPoints;i++)
+	{
+		btScalar y = btScalar(1.)-btScalar(2.)*(btScalar(i)+btScalar(0.5))/btScalar(numPoints);
+		btScalar r = btSqrt(btMax(btScalar(0.),btScalar(1.)-y*y));
+		btScalar angle = btScalar(2.39996323)*btScalar(i);
+		points.push_back(btVector3(btCos(angle)*r,y,btSin(angle)*r));
+	}
+
+	btConvexHullComputer hull;
+	hull.compute(&points[0].getX(),sizeof(btVector3),points.size(),btScalar(0.),btScalar(0.));
+
+	vertices.resize(0);
+	indices.resize(0);
+	for (int i=0;i<hull.vertices.size();i++)
+		vertices.push_back(hull.vertices[i]);
+	for (int f=0;f<hull.faces.size();f++)
+	{
+		const btConvexHullComputer::Edge* first = &hull.edges[hull.faces[f]];
+		int v0 = first->getSourceVertex();
+		const btConvexHullComputer::Edge* edge = first->getNextEdgeOfFace();
+		while (edge->getTargetVertex() != v0)
+		{
+			indices.push_back(v0);
+			indices.push_back(edge->getSourceVertex());
+			indices.push_back(edge->getTargetVertex());
+			edge = edge->getNextEdgeOfFace();
+		}
+	}
+}
+
+///returns the average build time in milliseconds, peakBytes is the largest amount of memory alive during a build
+static double	measureBuild(bool dense,const btAlignedObjectArray<unsigned int>& indices,const btAlignedObjectArray<btVector3>& vertices,int iterations,size_t& peakBytes,int& numEdges)
+{
+	btClock clock;
+	double total = 0.;
+	peakBytes = 0;
+	for (int it=0;it<iterations;it++)
+	{
+		sCurrentBytes = 0;
+		sPeakBytes = 0;
+		btAlignedAllocSetCustom(trackingAlloc,trackingFree);
+		clock.reset();
+		{
+			btAlignedObjectArray<EdgeBenchmarkShapeDrawer::Edge> edges;
+			if (dense)
+				buildEdgesDense(indices,vertices,edges);
+			else
+				EdgeBenchmarkShapeDrawer::build(indices,vertices,edges);
+			numEdges = edges.size();
+		}
+		total += clock.getTimeMicroseconds()*0.001;
+		btAlignedAllocSetCustom(0,0);
+		peakBytes = btMax(peakBytes,sPeakBytes);
+	}
+	return total/btMax(iterations,1);
+}
+
+void	runEdgeBuildBenchmark(int minVertices,int maxVertices,int maxDenseVertices,int iterations)
+{
+	printf("--- ShapeCache edge build benchmark (%d iterations) ---\n",iterations);
+	printf("%8s %10s %8s %12s %12s %12s %12s\n","vertices","triangles","edges","sorted ms","sorted KiB","dense ms","dense KiB");
+
+	btAlignedObjectArray<btVector3>		vertices;
+	btAlignedObjectArray<unsigned int>	indices;
+	for (int numPoints=btMax(minVertices,4);numPoints<=maxVertices;numPoints*=2)
+	{
+		createSphereHull(numPoints,vertices,indices);
+		if (!indices.size())
+			continue;
+
+		size_t sortedPeak = 0;
+		int numEdges = 0;
+		double sortedTime = measureBuild(false,indices,vertices,iterations,sortedPeak,numEdges);
+
+		if (vertices.size() <= maxDenseVertices)
+		{
+			size_t densePeak = 0;
+			int numDenseEdges = 0;
+			double denseTime = measureBuild(true,indices,vertices,iterations,densePeak,numDenseEdges);
+			btAssert(numDenseEdges == numEdges);
+			printf("%8d %10d %8d %12.3f %12.1f %12.3f %12.1f\n",vertices.size(),indices.size()/3,numEdges,
+				sortedTime,sortedPeak/1024.,denseTime,densePeak/1024.);
+		} else
+		{
+			printf("%8d %10d %8d %12.3f %12.1f %12s %12s\n",vertices.size(),indices.size()/3,numEdges,
+				sortedTime,sortedPeak/1024.,"-","-");
+		}
+	}
+}
@@ -0,0 +1,24 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef EDGE_BUILD_BENCHMARK_H
+#define EDGE_BUILD_BENCHMARK_H
+
+///runEdgeBuildBenchmark measures the silhouette edge extraction of GL_ShapeDrawer on convex hulls of
+///minVertices..maxVertices points on a sphere (doubling each time): build time and peak memory of the
+///sorted edge builder, and of the previous dense vertex x vertex table up to maxDenseVertices.
+///It needs no OpenGL context.
+void	runEdgeBuildBenchmark(int minVertices,int maxVertices,int maxDenseVertices,int iterations);
+
+#endif //EDGE_BUILD_BENCHMARK_H
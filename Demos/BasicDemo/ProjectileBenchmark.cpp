@@ -0,0 +1,255 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "ProjectileBenchmark.h"
+#include "DemoApplication.h"
+#include "btBulletDynamicsCommon.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btHashMap.h"
+#include "SpeculativeContacts.h"
+#include "CollisionObjectReorder.h"
+#include "DemoDynamicsWorld.h"
+
+#include <stdio.h>
+#include <string.h>
+
+extern int gNumClampedCcdMotions;
+
+///profile blocks that belong to the continuous collision path of btDiscreteDynamicsWorld
+static bool	isContinuousProfileBlock(const char* name)
+{
+	return (strstr(name,"CCD")!=0) || (strstr(name,"Predictive")!=0) || (strstr(name,"Speculative")!=0);
+}
+
+#ifndef BT_NO_PROFILE
+///sum the time of all continuous collision blocks below the current parent of the iterator.
+///stepSimulation resets the profiler, so after a step this is the time of that step only.
+static double	accumulateContinuousTime(CProfileIterator* iterator)
+{
+	int numChildren = 0;
+	for (iterator->First();!iterator->Is_Done();iterator->Next())
+	{
+		numChildren++;
+	}
+
+	double total = 0.;
+	for (int i=0;i<numChildren;i++)
+	{
+		iterator->First();
+		for (int j=0;j<i;j++)
+		{
+			iterator->Next();
+		}
+		if (isContinuousProfileBlock(iterator->Get_Current_Name()))
+		{
+			total += iterator->Get_Current_Total_Time();
+		} else
+		{
+			iterator->Enter_Child(i);
+			total += accumulateContinuousTime(iterator);
+			iterator->Enter_Parent();
+		}
+	}
+	return total;
+}
+#endif //BT_NO_PROFILE
+
+///small deterministic generator, so runs are comparable across platforms
+static btScalar	benchmarkRandom(unsigned int& seed)
+{
+	seed = seed*1664525u + 1013904223u;
+	return btScalar(seed>>8) / btScalar(1<<24);
+}
+
+void	runProjectileBenchmark(DemoApplication* demo,const ProjectileBenchmarkSettings& settings,ProjectileBenchmarkResults& results)
+{
+	memset(&results,0,sizeof(results));
+	results.m_minStepTime = 1e30;
+
+	btDynamicsWorld* world = demo->getDynamicsWorld();
+	if (!world || !settings.isValid())
+		return;
+
+	///aim at the center of the dynamic objects (the stack)
+	btVector3 target(0,0,0);
+	int numDynamic = 0;
+	for (int i=0;i<world->getNumCollisionObjects();i++)
+	{
+		btCollisionObject* colObj = world->getCollisionObjectArray()[i];
+		if (!colObj->isStaticOrKinematicObject())
+		{
+			target += colObj->getWorldTransform().getOrigin();
+			numDynamic++;
+		}
+	}
+	if (numDynamic)
+		target /= btScalar(numDynamic);
+
+	///a projectile whose center gets further than its half extent below the top of the ground (the highest static
+	///object) while it is over the ground tunnelled. Projectiles that fall past its edges are not counted.
+	btScalar groundLevel = -BT_LARGE_FLOAT;
+	btVector3 groundMin(0,0,0),groundMax(0,0,0);
+	for (int i=0;i<world->getNumCollisionObjects();i++)
+	{
+		btCollisionObject* colObj = world->getCollisionObjectArray()[i];
+		if (colObj->isStaticObject() && !colObj->getCollisionShape()->isInfinite())
+		{
+			btVector3 aabbMin,aabbMax;
+			colObj->getCollisionShape()->getAabb(colObj->getWorldTransform(),aabbMin,aabbMax);
+			if (aabbMax.getY() > groundLevel)
+			{
+				groundLevel = aabbMax.getY();
+				groundMin = aabbMin;
+				groundMax = aabbMax;
+			}
+		}
+	}
+	const btScalar tunnelLevel = groundLevel - btScalar(0.5);
+
+	btAlignedObjectArray<btRigidBody*>	projectiles;
+	btAlignedObjectArray<int>			tunnelled;
+	btHashMap<btHashPtr,int>			projectileIndex;
+
+	demo->setProjectileCcdMode(settings.m_ccdMode);
+	demo->setShootBoxInitialSpeed(settings.m_projectileSpeed);
+	gNumClampedCcdMotions = 0;
+
+	unsigned int seed = 12345;
+	btScalar shotsDue = 0.f;
+
+	btClock clock;
+	int settle = 0;
+	while (results.m_numFired < settings.m_numProjectiles || settle < settings.m_settleSteps)
+	{
+		///the steps after the one that fired the last projectile
+		if (results.m_numFired == settings.m_numProjectiles)
+			settle++;
+
+		shotsDue += settings.m_projectilesPerSecond*settings.m_timeStep;
+		while (shotsDue >= btScalar(1.) && results.m_numFired < settings.m_numProjectiles)
+		{
+			shotsDue -= btScalar(1.);
+			///launch positions spiral around the stack (golden angle), aim points jitter over the stack
+			btScalar angle = btScalar(2.39996323) * btScalar(results.m_numFired);
+			btScalar height = btScalar(2.) + btScalar(10.)*benchmarkRandom(seed);
+			btVector3 origin = target + btVector3(btCos(angle)*settings.m_launchDistance,height,btSin(angle)*settings.m_launchDistance);
+			btVector3 jitter(benchmarkRandom(seed)-btScalar(0.5),benchmarkRandom(seed)-btScalar(0.5),benchmarkRandom(seed)-btScalar(0.5));
+			btRigidBody* body = demo->shootBoxFrom(origin,target+jitter*btScalar(8.));
+			results.m_numFired++;
+
+			///pooled bodies are fired more than once, track each launch
+			int* index = projectileIndex.find(btHashPtr(body));
+			if (index)
+			{
+				tunnelled[*index] = 0;
+			} else
+			{
+				projectileIndex.insert(btHashPtr(body),projectiles.size());
+				projectiles.push_back(body);
+				tunnelled.push_back(0);
+			}
+		}
+		clock.reset();
+		world->stepSimulation(settings.m_timeStep,1,settings.m_timeStep);
+		double stepTime = clock.getTimeMicroseconds()*0.001;
+
+		results.m_numSteps++;
+		results.m_totalStepTime += stepTime;
+		results.m_minStepTime = btMin(results.m_minStepTime,stepTime);
+		results.m_maxStepTime = btMax(results.m_maxStepTime,stepTime);
+
+		///the reorder runs outside of the timed step, like it does between frames in the demo
+		if (demo->getCollisionObjectReorder())
+		{
+			if (demo->getDemoDynamicsWorld())
+				demo->getCollisionObjectReorder()->update(demo->getDemoDynamicsWorld());
+			else
+				demo->getCollisionObjectReorder()->update(world);
+		}
+
+		if (demo->getSpeculativeContacts())
+			results.m_numSpeculativeContacts += demo->getSpeculativeContacts()->getNumContacts();
+
+		for (int i=0;i<projectiles.size();i++)
+		{
+			const btVector3& pos = projectiles[i]->getWorldTransform().getOrigin();
+			const bool overGround = pos.getX() >= groundMin.getX() && pos.getX() <= groundMax.getX() &&
+				pos.getZ() >= groundMin.getZ() && pos.getZ() <= groundMax.getZ();
+			if (!tunnelled[i] && overGround && pos.getY() < tunnelLevel)
+			{
+				tunnelled[i] = 1;
+				results.m_numTunnelled++;
+			}
+		}
+
+#ifndef BT_NO_PROFILE
+		CProfileIterator* iterator = CProfileManager::Get_Iterator();
+		double continuousTime = accumulateContinuousTime(iterator);
+		CProfileManager::Release_Iterator(iterator);
+		results.m_totalContinuousTime += continuousTime;
+		results.m_maxContinuousTime = btMax(results.m_maxContinuousTime,continuousTime);
+#endif //BT_NO_PROFILE
+	}
+
+	results.m_numClampedCcdMotions = gNumClampedCcdMotions;
+	if (!results.m_numSteps)
+		results.m_minStepTime = 0.;
+}
+
+void	printProjectileBenchmarkResults(const ProjectileBenchmarkSettings& settings,const ProjectileBenchmarkResults& results)
+{
+	int numSteps = btMax(results.m_numSteps,1);
+	printf("--- CCD projectile benchmark (%s) ---\n",getProjectileCcdModeName(settings.m_ccdMode));
+	printf("projectiles       : %d fired (%.1f per second, speed %.1f)\n",results.m_numFired,(double)settings.m_projectilesPerSecond,(double)settings.m_projectileSpeed);
+	printf("steps             : %d (dt = %.5f s)\n",results.m_numSteps,(double)settings.m_timeStep);
+	printf("step time         : %.3f ms total, %.3f / %.3f / %.3f ms min/avg/max\n",
+		results.m_totalStepTime,results.m_minStepTime,results.m_totalStepTime/numSteps,results.m_maxStepTime);
+#ifndef BT_NO_PROFILE
+	printf("continuous time   : %.3f ms total, %.3f / %.3f ms avg/max per step (%.1f %% of step time)\n",
+		results.m_totalContinuousTime,results.m_totalContinuousTime/numSteps,results.m_maxContinuousTime,
+		results.m_totalStepTime > 0. ? 100.*results.m_totalContinuousTime/results.m_totalStepTime : 0.);
+#else
+	printf("continuous time   : unavailable (BT_NO_PROFILE)\n");
+#endif //BT_NO_PROFILE
+	printf("clamped CCD motions: %d\n",results.m_numClampedCcdMotions);
+	printf("speculative contacts: %d\n",results.m_numSpeculativeContacts);
+	printf("tunnelled         : %d (%.2f %% of fired)\n",results.m_numTunnelled,
+		results.m_numFired ? 100.*results.m_numTunnelled/results.m_numFired : 0.);
+}
+
+void	printProjectileBenchmarkComparison(const ProjectileBenchmarkSettings* settings,const ProjectileBenchmarkResults* results,int numRuns)
+{
+	printf("--- CCD mode comparison ---\n");
+	printf("%-12s %12s %12s %12s %10s\n","mode","avg step ms","max step ms","ccd ms/step","tunnelled");
+	for (int i=0;i<numRuns;i++)
+	{
+		int numSteps = btMax(results[i].m_numSteps,1);
+		printf("%-12s %12.3f %12.3f %12.3f %9.2f%%\n",getProjectileCcdModeName(settings[i].m_ccdMode),
+			results[i].m_totalStepTime/numSteps,results[i].m_maxStepTime,results[i].m_totalContinuousTime/numSteps,
+			results[i].m_numFired ? 100.*results[i].m_numTunnelled/results[i].m_numFired : 0.);
+	}
+}
+
+const char*	getProjectileCcdModeName(int ccdMode)
+{
+	switch (ccdMode)
+	{
+	case DemoApplication::PROJECTILE_CCD_SWEPT_SPHERE: return "swept";
+	case DemoApplication::PROJECTILE_CCD_SPECULATIVE: return "speculative";
+	case DemoApplication::PROJECTILE_CCD_NONE: return "none";
+	default:
+		return "unknown";
+	}
+}
@@ -0,0 +1,83 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef PROJECTILE_BENCHMARK_H
+#define PROJECTILE_BENCHMARK_H
+
+#include "LinearMath/btScalar.h"
+
+class DemoApplication;
+
+///ProjectileBenchmarkSettings controls the scripted shootBox stress test.
+///Projectiles are fired at a fixed rate (in simulated time) from a ring around the stack,
+///so every run with the same settings performs exactly the same sequence of shots.
+struct ProjectileBenchmarkSettings
+{
+	int			m_numProjectiles;
+	btScalar	m_projectilesPerSecond;
+	btScalar	m_projectileSpeed;
+	btScalar	m_timeStep;
+	///number of steps simulated after the last projectile has been fired
+	int			m_settleSteps;
+	///distance of the launch ring from the center of the stack
+	btScalar	m_launchDistance;
+	///one of DemoApplication::ProjectileCcdMode
+	int			m_ccdMode;
+
+	ProjectileBenchmarkSettings()
+		:m_numProjectiles(2000),
+		m_projectilesPerSecond(btScalar(120.)),
+		m_projectileSpeed(btScalar(40.)),
+		m_timeStep(btScalar(1.)/btScalar(60.)),
+		m_settleSteps(120),
+		m_launchDistance(btScalar(30.)),
+		m_ccdMode(0)
+	{
+	}
+
+	///the shots are only all fired for a positive rate and time step
+	bool	isValid() const
+	{
+		return m_numProjectiles >= 0 && m_projectilesPerSecond > btScalar(0.) && m_timeStep > btScalar(0.) && m_settleSteps >= 0;
+	}
+};
+
+struct ProjectileBenchmarkResults
+{
+	int		m_numSteps;
+	int		m_numFired;
+	int		m_numClampedCcdMotions;
+	///projectiles that ended up completely below the top of the static geometry
+	int		m_numTunnelled;
+	int		m_numSpeculativeContacts;
+	///all times in milliseconds
+	double	m_totalStepTime;
+	double	m_minStepTime;
+	double	m_maxStepTime;
+	double	m_totalContinuousTime;
+	double	m_maxContinuousTime;
+};
+
+///runs the benchmark on the world of an initialized demo, without opening a window.
+///It steps until all projectiles are fired, then m_settleSteps more. Invalid settings run no steps.
+void	runProjectileBenchmark(DemoApplication* demo,const ProjectileBenchmarkSettings& settings,ProjectileBenchmarkResults& results);
+
+void	printProjectileBenchmarkResults(const ProjectileBenchmarkSettings& settings,const ProjectileBenchmarkResults& results);
+
+///one line per run, to compare the CCD modes
+void	printProjectileBenchmarkComparison(const ProjectileBenchmarkSettings* settings,const ProjectileBenchmarkResults* results,int numRuns);
+
+const char*	getProjectileCcdModeName(int ccdMode);
+
+#endif //PROJECTILE_BENCHMARK_H
@@ -0,0 +1,138 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "RaytraceBenchmark.h"
+#include "DemoApplication.h"
+#include "FrustumCuller.h"
+#include "RayTracer.h"
+#include "RenderTexture.h"
+#include "btBulletDynamicsCommon.h"
+
+#include <stdio.h>
+#include <string.h>
+
+///half size of the grid of extra objects, inside the top of the ground box of BasicDemo
+static const btScalar	sGridExtent = btScalar(40.);
+
+///replace the extra objects of the previous run with count new ones on a square grid
+static void	setExtraObjects(btCollisionWorld* world,int count,btCollisionShape** shapes,btAlignedObjectArray<btCollisionObject*>& extraObjects)
+{
+	for (int i=0;i<extraObjects.size();i++)
+	{
+		world->removeCollisionObject(extraObjects[i]);
+		delete extraObjects[i];
+	}
+	extraObjects.resize(0);
+
+	int side = 1;
+	while (side*side < count)
+		side++;
+	const btScalar spacing = btScalar(2.)*sGridExtent/btScalar(side);
+	for (int i=0;i<count;i++)
+	{
+		btCollisionObject* obj = new btCollisionObject();
+		obj->setCollisionShape(shapes[i&1]);
+		btTransform trans;
+		trans.setIdentity();
+		trans.setOrigin(btVector3(-sGridExtent+(btScalar(i%side)+btScalar(0.5))*spacing,btScalar(0.5),
+			-sGridExtent+(btScalar(i/side)+btScalar(0.5))*spacing));
+		obj->setWorldTransform(trans);
+		world->addCollisionObject(obj,btBroadphaseProxy::StaticFilter,btBroadphaseProxy::AllFilter ^ btBroadphaseProxy::StaticFilter);
+		extraObjects.push_back(obj);
+	}
+}
+
+void	runRaytraceBenchmark(DemoApplication* demo,const RaytraceBenchmarkSettings& settings)
+{
+	btDynamicsWorld* world = demo->getDynamicsWorld();
+	const int frames = btMax(settings.m_frames,1);
+	RayTracer rayTracer(btMax(settings.m_width,1),btMax(settings.m_height,1),settings.m_numThreads);
+	demo->updateCameraPosition();
+	rayTracer.setCamera(demo->getCameraPosition(),demo->getCameraTargetPosition(),btVector3(0,1,0));
+	rayTracer.setDbvtBroadphase(demo->getFrustumCuller()->getDbvtBroadphase());
+	rayTracer.setShadows(settings.m_shadows);
+
+	btBoxShape box(btVector3(btScalar(0.5),btScalar(0.5),btScalar(0.5)));
+	btSphereShape sphere(btScalar(0.5));
+	btCollisionShape* shapes[2] = {&box,&sphere};
+	btAlignedObjectArray<btCollisionObject*> extraObjects;
+	btAlignedObjectArray<unsigned char> packetImage;
+	const int imageSize = rayTracer.getWidth()*rayTracer.getHeight()*4;
+
+	printf("raytrace benchmark: %dx%d, %d frames per scene, shadows %s, packets of %dx%d on %d threads\n",
+		rayTracer.getWidth(),rayTracer.getHeight(),frames,settings.m_shadows ? "on" : "off",
+		int(RayTracer::PACKET_SIZE),int(RayTracer::PACKET_SIZE),rayTracer.getNumThreads());
+	printf("%8s %9s %9s %10s %9s %9s","objects","primary","shadow","obj tests","ms/frame","Mrays/s");
+	if (settings.m_compareWorldRayTest)
+		printf(" | %13s %9s %7s %8s","rayTest ms","Mrays/s","speedup","differ");
+	printf("\n");
+
+	int numExtra = 0;
+	for (;;)
+	{
+		setExtraObjects(world,numExtra,shapes,extraObjects);
+
+		rayTracer.setUseWorldRayTest(false);
+		double time = 0.;
+		for (int i=0;i<frames;i++)
+		{
+			rayTracer.renderWorld(world);
+			time += rayTracer.getRenderTime();
+		}
+		const double packetTime = time/frames;
+		const int numRays = rayTracer.getNumPrimaryRays()+rayTracer.getNumShadowRays();
+		printf("%8d %9d %9d %10d %9.2f %9.3f",world->getNumCollisionObjects(),rayTracer.getNumPrimaryRays(),
+			rayTracer.getNumShadowRays(),rayTracer.getNumObjectTests(),packetTime,
+			packetTime > 0. ? double(numRays)/(packetTime*1000.) : 0.);
+		if (settings.m_imagePrefix)
+		{
+			char fileName[1024];
+			sprintf(fileName,"%.1000s_%d.png",settings.m_imagePrefix,world->getNumCollisionObjects());
+			if (!rayTracer.writeImage(fileName))
+				printf(" (can't write %s)",fileName);
+		}
+
+		if (settings.m_compareWorldRayTest)
+		{
+			packetImage.resize(imageSize);
+			memcpy(&packetImage[0],rayTracer.getRenderTexture()->getBuffer(),imageSize);
+			rayTracer.setUseWorldRayTest(true);
+			time = 0.;
+			for (int i=0;i<frames;i++)
+			{
+				rayTracer.renderWorld(world);
+				time += rayTracer.getRenderTime();
+			}
+			const double worldTime = time/frames;
+			const int numWorldRays = rayTracer.getNumPrimaryRays()+rayTracer.getNumShadowRays();
+			const unsigned char* worldImage = rayTracer.getRenderTexture()->getBuffer();
+			int numDiffering = 0;
+			for (int i=0;i<imageSize;i+=4)
+			{
+				if (memcmp(&packetImage[i],worldImage+i,4))
+					numDiffering++;
+			}
+			printf(" | %13.2f %9.3f %6.1fx %8d",worldTime,worldTime > 0. ? double(numWorldRays)/(worldTime*1000.) : 0.,
+				packetTime > 0. ? worldTime/packetTime : 0.,numDiffering);
+		}
+		printf("\n");
+
+		if (numExtra >= settings.m_maxExtraObjects)
+			break;
+		numExtra = numExtra ? numExtra*2 : btMax(settings.m_minExtraObjects,1);
+		numExtra = btMin(numExtra,settings.m_maxExtraObjects);
+	}
+	setExtraObjects(world,0,shapes,extraObjects);
+}
@@ -0,0 +1,56 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef RAYTRACE_BENCHMARK_H
+#define RAYTRACE_BENCHMARK_H
+
+class DemoApplication;
+
+///RaytraceBenchmarkSettings controls the ray query throughput test of RayTracer.
+///The scene of the demo is rendered first as it is, then with more and more static boxes and spheres on a
+///grid over the ground (doubling from m_minExtraObjects up to m_maxExtraObjects). The world is not stepped,
+///so every run with the same settings traces the same rays.
+struct RaytraceBenchmarkSettings
+{
+	int		m_width;
+	int		m_height;
+	int		m_frames;
+	///0 uses one thread per processor
+	int		m_numThreads;
+	int		m_minExtraObjects;
+	int		m_maxExtraObjects;
+	bool	m_shadows;
+	///trace the same frames with btCollisionWorld::rayTest on one thread too, and count the differing pixels
+	bool	m_compareWorldRayTest;
+	///when not 0, the image of every scene size is written to <prefix>_<objects>.png
+	const char*	m_imagePrefix;
+
+	RaytraceBenchmarkSettings()
+		:m_width(640),
+		m_height(480),
+		m_frames(5),
+		m_numThreads(0),
+		m_minExtraObjects(64),
+		m_maxExtraObjects(4096),
+		m_shadows(true),
+		m_compareWorldRayTest(true),
+		m_imagePrefix(0)
+	{
+	}
+};
+
+///runs the benchmark on the world of an initialized demo, without opening a window, and prints one line per scene size
+void	runRaytraceBenchmark(DemoApplication* demo,const RaytraceBenchmarkSettings& settings);
+
+#endif //RAYTRACE_BENCHMARK_H
@@ -0,0 +1,264 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "SerializeCheck.h"
+#include "StreamingSerializer.h"
+#include "btBulletDynamicsCommon.h"
+#include "LinearMath/btSerializer.h"
+#include "LinearMath/btHashMap.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const int	sNumMeshes=4;
+static const int	sNumMeshParts=2;
+///quads along each side of a mesh part
+static const int	sGridSize=8;
+static const int	sMaxSerializeBufferSize=1024*1024*5;
+
+///btDefaultSerializer with zeroed chunks, like StreamingSerializer, so padding the serializers skip compares equal
+class ZeroedSerializer : public btDefaultSerializer
+{
+public:
+	ZeroedSerializer(int totalSize)
+		:btDefaultSerializer(totalSize)
+	{
+	}
+	virtual	btChunk*	allocate(size_t size,int numElements)
+	{
+		btChunk* chunk = btDefaultSerializer::allocate(size,numElements);
+		memset(chunk->m_oldPtr,0,size*size_t(numElements));
+		return chunk;
+	}
+};
+
+///maps the unique id of every chunk after the header to its offset.
+///False for a truncated file, or for an id that is used by two chunks.
+static bool	readChunks(const unsigned char* data,int size,btHashMap<btHashPtr,int>& chunks,int& numChunks)
+{
+	numChunks = 0;
+	int offset = BT_HEADER_LENGTH;
+	while (offset < size)
+	{
+		if (size-offset < int(sizeof(btChunk)))
+		{
+			printf("truncated chunk header at %d\n",offset);
+			return false;
+		}
+		const btChunk* chunk = (const btChunk*)(data+offset);
+		if (chunk->m_length < 0 || chunk->m_length > size-offset-int(sizeof(btChunk)))
+		{
+			printf("truncated chunk at %d\n",offset);
+			return false;
+		}
+		if (chunks.find(btHashPtr(chunk->m_oldPtr)))
+		{
+			printf("chunk at %d reuses the id %p\n",offset,chunk->m_oldPtr);
+			return false;
+		}
+		chunks.insert(btHashPtr(chunk->m_oldPtr),offset);
+		numChunks++;
+		offset += int(sizeof(btChunk))+chunk->m_length;
+	}
+	return true;
+}
+
+static bool	readFile(const char* fileName,btAlignedObjectArray<unsigned char>& data)
+{
+	FILE* file = fopen(fileName,"rb");
+	if (!file)
+		return false;
+	fseek(file,0,SEEK_END);
+	const long size = ftell(file);
+	fseek(file,0,SEEK_SET);
+	data.resize(int(size));
+	const bool ok = size>0 && fread(&data[0],1,size_t(size),file)==size_t(size);
+	fclose(file);
+	return ok;
+}
+
+bool	runSerializeCheck(const char* fileName)
+{
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	btSequentialImpulseConstraintSolver solver;
+	btDiscreteDynamicsWorld world(&dispatcher,&broadphase,&solver,&collisionConfiguration);
+
+	btAlignedObjectArray<btCollisionShape*> shapes;
+	btAlignedObjectArray<btTriangleIndexVertexArray*> meshInterfaces;
+
+	//every mesh part is a grid of its own, the arrays are filled before any part refers to them
+	const int numVerticesPerPart = (sGridSize+1)*(sGridSize+1);
+	const int numTrianglesPerPart = sGridSize*sGridSize*2;
+	btAlignedObjectArray<float> vertices;
+	btAlignedObjectArray<int> indices;
+	vertices.resize(sNumMeshes*sNumMeshParts*numVerticesPerPart*3);
+	indices.resize(sNumMeshes*sNumMeshParts*numTrianglesPerPart*3);
+	for (int p=0;p<sNumMeshes*sNumMeshParts;p++)
+	{
+		float* pv = &vertices[p*numVerticesPerPart*3];
+		for (int z=0;z<=sGridSize;z++)
+		{
+			for (int x=0;x<=sGridSize;x++)
+			{
+				*pv++ = float(x+p*sGridSize);
+				*pv++ = float((x*z+p)%3)*0.25f;
+				*pv++ = float(z);
+			}
+		}
+		int* pi = &indices[p*numTrianglesPerPart*3];
+		for (int z=0;z<sGridSize;z++)
+		{
+			for (int x=0;x<sGridSize;x++)
+			{
+				const int i = z*(sGridSize+1)+x;
+				*pi++ = i;*pi++ = i+sGridSize+1;*pi++ = i+1;
+				*pi++ = i+1;*pi++ = i+sGridSize+1;*pi++ = i+sGridSize+2;
+			}
+		}
+	}
+
+	for (int m=0;m<sNumMeshes;m++)
+	{
+		btTriangleIndexVertexArray* meshInterface = new btTriangleIndexVertexArray();
+		for (int j=0;j<sNumMeshParts;j++)
+		{
+			const int p = m*sNumMeshParts+j;
+			btIndexedMesh part;
+			part.m_numTriangles = numTrianglesPerPart;
+			part.m_triangleIndexBase = (const unsigned char*)&indices[p*numTrianglesPerPart*3];
+			part.m_triangleIndexStride = 3*sizeof(int);
+			part.m_numVertices = numVerticesPerPart;
+			part.m_vertexBase = (const unsigned char*)&vertices[p*numVerticesPerPart*3];
+			part.m_vertexStride = 3*sizeof(float);
+			part.m_vertexType = PHY_FLOAT;
+			meshInterface->addIndexedMesh(part,PHY_INTEGER);
+		}
+		meshInterfaces.push_back(meshInterface);
+		btBvhTriangleMeshShape* meshShape = new btBvhTriangleMeshShape(meshInterface,true);
+		shapes.push_back(meshShape);
+
+		btTransform transform;
+		transform.setIdentity();
+		transform.setOrigin(btVector3(0,btScalar(-5*m),0));
+		btRigidBody* body = new btRigidBody(btScalar(0.),0,meshShape);
+		body->setWorldTransform(transform);
+		world.addRigidBody(body);
+	}
+
+	//two compound shapes, their child arrays are chunks of their own like the mesh parts
+	for (int c=0;c<2;c++)
+	{
+		btCompoundShape* compound = new btCompoundShape();
+		btCollisionShape* children[3] = {new btBoxShape(btVector3(1,1,1)),new btSphereShape(btScalar(0.5)),new btCylinderShape(btVector3(btScalar(0.5),1,btScalar(0.5)))};
+		for (int i=0;i<3;i++)
+		{
+			btTransform childTransform;
+			childTransform.setIdentity();
+			childTransform.setOrigin(btVector3(btScalar(i*2),0,btScalar(c)));
+			compound->addChildShape(childTransform,children[i]);
+			shapes.push_back(children[i]);
+		}
+		shapes.push_back(compound);
+
+		btVector3 localInertia(0,0,0);
+		compound->calculateLocalInertia(btScalar(1.),localInertia);
+		btTransform transform;
+		transform.setIdentity();
+		transform.setOrigin(btVector3(btScalar(c*4),10,0));
+		btRigidBody* body = new btRigidBody(btScalar(1.),0,compound,localInertia);
+		body->setWorldTransform(transform);
+		world.addRigidBody(body);
+	}
+
+	ZeroedSerializer reference(sMaxSerializeBufferSize);
+	world.serialize(&reference);
+
+	bool ok = true;
+	FILE* file = fopen(fileName,"wb");
+	if (!file)
+	{
+		printf("can't write %s\n",fileName);
+		ok = false;
+	} else
+	{
+		StreamingSerializer serializer(file);
+		world.serialize(&serializer);
+		if (serializer.hasWriteError())
+		{
+			printf("can't write %s\n",fileName);
+			ok = false;
+		} else
+		{
+			printf("wrote %d chunks, %lu bytes, at most %d chunks in memory\n",serializer.getNumChunks(),
+				(unsigned long)serializer.getBytesWritten(),serializer.getMaxLiveChunks());
+		}
+		fclose(file);
+	}
+
+	btAlignedObjectArray<unsigned char> streamed;
+	if (ok && !readFile(fileName,streamed))
+	{
+		printf("can't read %s\n",fileName);
+		ok = false;
+	}
+
+	const unsigned char* expected = reference.getBufferPointer();
+	const int expectedSize = reference.getCurrentBufferSize();
+	btHashMap<btHashPtr,int> expectedChunks;
+	btHashMap<btHashPtr,int> streamedChunks;
+	int numExpectedChunks = 0;
+	int numStreamedChunks = 0;
+	if (ok)
+	{
+		ok = readChunks(expected,expectedSize,expectedChunks,numExpectedChunks) &&
+			readChunks(&streamed[0],streamed.size(),streamedChunks,numStreamedChunks);
+	}
+	if (ok && (streamed.size()!=expectedSize || numStreamedChunks!=numExpectedChunks || memcmp(&streamed[0],expected,BT_HEADER_LENGTH)))
+	{
+		printf("%d chunks in %d bytes, expected %d chunks in %d bytes\n",numStreamedChunks,streamed.size(),numExpectedChunks,expectedSize);
+		ok = false;
+	}
+	for (int i=0;ok && i<expectedChunks.size();i++)
+	{
+		const btChunk* chunk = (const btChunk*)(expected+*expectedChunks.getAtIndex(i));
+		const int* found = streamedChunks.find(btHashPtr(chunk->m_oldPtr));
+		const btChunk* loaded = found ? (const btChunk*)(&streamed[0]+*found) : 0;
+		if (!loaded || memcmp(loaded,chunk,sizeof(btChunk)+chunk->m_length))
+		{
+			printf("chunk %p (code %d, %d bytes) differs\n",chunk->m_oldPtr,chunk->m_chunkCode,chunk->m_length);
+			ok = false;
+		}
+	}
+	if (ok)
+		printf("%s matches btDefaultSerializer: %d meshes with %d parts, 2 compound shapes\n",fileName,sNumMeshes,sNumMeshParts);
+
+	for (int i=world.getNumCollisionObjects()-1;i>=0;i--)
+	{
+		btCollisionObject* obj = world.getCollisionObjectArray()[i];
+		world.removeCollisionObject(obj);
+		delete obj;
+	}
+	for (int i=0;i<shapes.size();i++)
+	{
+		delete shapes[i];
+	}
+	for (int i=0;i<meshInterfaces.size();i++)
+	{
+		delete meshInterfaces[i];
+	}
+	return ok;
+}
@@ -0,0 +1,25 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef SERIALIZE_CHECK_H
+#define SERIALIZE_CHECK_H
+
+///runSerializeCheck writes a world with several triangle meshes (two mesh parts each) and compound shapes to
+///fileName with StreamingSerializer, reads the file back and compares it chunk by chunk, by unique id, with the
+///buffer of btDefaultSerializer for the same world. Every id must be used by one chunk only, and every chunk must
+///have the same contents, so the pointers in them resolve the same way when the file is loaded.
+///Returns true when the files match. It needs no OpenGL context.
+bool	runSerializeCheck(const char* fileName);
+
+#endif //SERIALIZE_CHECK_H
@@ -17,15 +17,313 @@ subject to the following restrictions:
 #include "GlutStuff.h"
 #include "btBulletDynamicsCommon.h"
 #include "LinearMath/btHashMap.h"
+#include "ProjectileBenchmark.h"
+#include "EdgeBuildBenchmark.h"
+#include "ProjectilePool.h"
+#include "StaticGeometryBaker.h"
+#include "DebugDrawBenchmark.h"
+#include "GLDebugDrawer.h"
+#include "StreamDebugDrawer.h"
+#include "SoftwareRasterizer.h"
+#include "RaytraceBenchmark.h"
+#include "FrameCapture.h"
+#include "SerializeCheck.h"
+#include "LinearMath/btQuickprof.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CommandLineArguments.h"
 
 
 	
 int main(int argc,char** argv)
 {
+	CommandLineArguments args(argc,argv);
+
+	///silhouette edge build time and peak memory against hull vertex count, no window and no physics
+	///e.g. AppBasicDemo --edge-benchmark --edge-min=64 --edge-max=16384 --edge-dense-max=2048 --iterations=10
+	if (args.CheckCmdLineFlag("edge-benchmark"))
+	{
+		int minVertices = 64;
+		int maxVertices = 8192;
+		int maxDenseVertices = 2048;
+		int iterations = 10;
+		args.GetCmdLineArgument("edge-min",minVertices);
+		args.GetCmdLineArgument("edge-max",maxVertices);
+		args.GetCmdLineArgument("edge-dense-max",maxDenseVertices);
+		args.GetCmdLineArgument("iterations",iterations);
+		runEdgeBuildBenchmark(minVertices,maxVertices,maxDenseVertices,iterations);
+		return 0;
+	}
+
+	///write a world with several meshes and compound shapes with StreamingSerializer and compare the file with
+	///btDefaultSerializer, e.g. AppBasicDemo --serialize-check=serializeCheck.bullet
+	if (args.CheckCmdLineFlag("serialize-check"))
+	{
+		std::string fileName("serializeCheck.bullet");
+		args.GetCmdLineArgument("serialize-check",fileName);
+		return runSerializeCheck(fileName.c_str()) ? 0 : 1;
+	}
 
 	BasicDemo ccdDemo;
+
+	///merge the static bodies into one quantized BVH mesh, e.g. --bake-static=BasicDemoStatic.bvh
+	if (args.CheckCmdLineFlag("bake-static"))
+	{
+		std::string cacheFileName("BasicDemoStatic.bvh");
+		args.GetCmdLineArgument("bake-static",cacheFileName);
+		ccdDemo.setStaticGeometryBaking(true,cacheFileName.c_str());
+	}
+
 	ccdDemo.initPhysics();
 
+	if (ccdDemo.getStaticGeometryBaker())
+	{
+		StaticGeometryBaker* baker = ccdDemo.getStaticGeometryBaker();
+		printf("baked %d static objects into %d triangles in %.3f ms (%s)\n",baker->getNumBakedObjects(),baker->getNumTriangles(),
+			baker->getBakeTime(),baker->isLoadedFromCache() ? "BVH loaded from cache" : "BVH built");
+	}
+
+	///recycle shootBox bodies once this many are alive, e.g. --projectile-pool=256
+	int projectilePoolCapacity = 0;
+	args.GetCmdLineArgument("projectile-pool",projectilePoolCapacity);
+	ccdDemo.setProjectilePoolCapacity(projectilePoolCapacity);
+
+	///sort the collision objects by position every N frames (or benchmark steps), e.g. --reorder-interval=60
+	int reorderInterval = 0;
+	args.GetCmdLineArgument("reorder-interval",reorderInterval);
+	ccdDemo.setCollisionObjectReorderInterval(reorderInterval);
+
+	///memory budget of the per-shape render caches in MiB, 0 means no limit, e.g. --render-cache-mb=8
+	if (args.CheckCmdLineFlag("render-cache-mb"))
+	{
+		int renderCacheMegaBytes = 32;
+		args.GetCmdLineArgument("render-cache-mb",renderCacheMegaBytes);
+		ccdDemo.getShapeDrawer()->setCacheMemoryBudget(size_t(renderCacheMegaBytes)*1024*1024);
+	}
+
+	///record the debug geometry of a number of steps into a stream for AppDebugDrawReplay, without a window
+	///e.g. AppBasicDemo --debug-draw-capture=BasicDemo.btdd --steps=600, --capture-ring=120 keeps only the last 120 frames
+	if (args.CheckCmdLineFlag("debug-draw-capture"))
+	{
+		std::string captureFileName("BasicDemo.btdd");
+		int steps = 600;
+		int ringFrames = 0;
+		args.GetCmdLineArgument("debug-draw-capture",captureFileName);
+		args.GetCmdLineArgument("steps",steps);
+		args.GetCmdLineArgument("capture-ring",ringFrames);
+
+		StreamDebugDrawer streamDrawer;
+		if (ringFrames>0)
+		{
+			streamDrawer.setRingBufferFrames(ringFrames);
+		} else if (!streamDrawer.openFile(captureFileName.c_str()))
+		{
+			printf("can't write %s\n",captureFileName.c_str());
+			return 1;
+		}
+		btDynamicsWorld* world = ccdDemo.getDynamicsWorld();
+		btIDebugDraw* previousDrawer = world->getDebugDrawer();
+		world->setDebugDrawer(&streamDrawer);
+		ccdDemo.setDebugMode(btIDebugDraw::DBG_DrawWireframe|btIDebugDraw::DBG_DrawAabb|btIDebugDraw::DBG_DrawContactPoints);
+		for (int i=0;i<steps;i++)
+		{
+			world->stepSimulation(btScalar(1.)/btScalar(60.),1,btScalar(1.)/btScalar(60.));
+			world->debugDrawWorld();
+			streamDrawer.endFrame();
+		}
+		if (ringFrames>0 && !streamDrawer.saveRingBuffer(captureFileName.c_str()))
+		{
+			printf("can't write %s\n",captureFileName.c_str());
+			return 1;
+		}
+		streamDrawer.closeFile();
+		world->setDebugDrawer(previousDrawer);
+		if (ringFrames>0)
+			printf("captured %u frames, saved the last %d into %s\n",streamDrawer.getNumFrames(),btMin(ringFrames,steps),captureFileName.c_str());
+		else
+			printf("captured %u frames into %s (%lu bytes)\n",streamDrawer.getNumFrames(),captureFileName.c_str(),(unsigned long)streamDrawer.getBytesWritten());
+		return 0;
+	}
+
+	///step the demo without a window and rasterize every K-th step on the CPU into numbered images
+	///e.g. AppBasicDemo --software-render=frames/BasicDemo --steps=300 --render-every=10 --width=640 --height=480 --threads=0 --format=png
+	if (args.CheckCmdLineFlag("software-render"))
+	{
+		std::string prefix("BasicDemo");
+		std::string format("png");
+		int steps = 300;
+		int renderEvery = 1;
+		int width = 640;
+		int height = 480;
+		int numThreads = 0;
+		args.GetCmdLineArgument("software-render",prefix);
+		args.GetCmdLineArgument("steps",steps);
+		args.GetCmdLineArgument("render-every",renderEvery);
+		args.GetCmdLineArgument("width",width);
+		args.GetCmdLineArgument("height",height);
+		args.GetCmdLineArgument("threads",numThreads);
+		args.GetCmdLineArgument("format",format);
+		if (renderEvery < 1)
+			renderEvery = 1;
+
+		SoftwareRasterizer rasterizer(btMax(width,1),btMax(height,1),numThreads);
+		ccdDemo.updateCameraPosition();
+		rasterizer.setCamera(ccdDemo.getCameraPosition(),ccdDemo.getCameraTargetPosition(),btVector3(0,1,0));
+
+		btDynamicsWorld* world = ccdDemo.getDynamicsWorld();
+		btClock clock;
+		double stepTime = 0.;
+		double setupTime = 0.;
+		double rasterTime = 0.;
+		int numFrames = 0;
+		for (int i=0;i<steps;i++)
+		{
+			clock.reset();
+			world->stepSimulation(btScalar(1.)/btScalar(60.),1,btScalar(1.)/btScalar(60.));
+			stepTime += double(clock.getTimeMicroseconds())*0.001;
+			if (i%renderEvery)
+				continue;
+
+			rasterizer.renderWorld(world);
+			setupTime += rasterizer.getSetupTime();
+			rasterTime += rasterizer.getRasterTime();
+			char fileName[1024];
+			sprintf(fileName,"%.1000s_%04d.%s",prefix.c_str(),numFrames,format=="ppm" ? "ppm" : "png");
+			if (!rasterizer.writeImage(fileName))
+			{
+				printf("can't write %s\n",fileName);
+				return 1;
+			}
+			numFrames++;
+		}
+		if (numFrames)
+		{
+			printf("rendered %d frames of %dx%d on %d threads: setup %.3f ms, raster %.3f ms, %d triangles, %d cached meshes\n",
+				numFrames,width,height,rasterizer.getNumThreads(),setupTime/numFrames,rasterTime/numFrames,
+				rasterizer.getNumTriangles(),rasterizer.getNumCachedMeshes());
+		}
+		if (steps > 0)
+			printf("simulated %d steps: %.3f ms per step\n",steps,stepTime/steps);
+		return 0;
+	}
+
+	///rays per second of the packet raytracer against the number of objects, compared with btCollisionWorld::rayTest
+	///e.g. AppBasicDemo --raytrace-benchmark --width=640 --height=480 --frames=5 --threads=0 --raytrace-max-objects=4096
+	///--raytrace-image=frames/raytrace writes the image of every scene size, --no-shadows and --no-compare skip those rays
+	if (args.CheckCmdLineFlag("raytrace-benchmark"))
+	{
+		RaytraceBenchmarkSettings settings;
+		std::string imagePrefix;
+		args.GetCmdLineArgument("width",settings.m_width);
+		args.GetCmdLineArgument("height",settings.m_height);
+		args.GetCmdLineArgument("frames",settings.m_frames);
+		args.GetCmdLineArgument("threads",settings.m_numThreads);
+		args.GetCmdLineArgument("raytrace-min-objects",settings.m_minExtraObjects);
+		args.GetCmdLineArgument("raytrace-max-objects",settings.m_maxExtraObjects);
+		args.GetCmdLineArgument("raytrace-image",imagePrefix);
+		settings.m_shadows = !args.CheckCmdLineFlag("no-shadows");
+		settings.m_compareWorldRayTest = !args.CheckCmdLineFlag("no-compare");
+		if (!imagePrefix.empty())
+			settings.m_imagePrefix = imagePrefix.c_str();
+		runRaytraceBenchmark(&ccdDemo,settings);
+		return 0;
+	}
+
+	///debug draw frame time of the batched and the immediate mode GLDebugDrawer, in a window of its own
+	///e.g. AppBasicDemo --debug-draw-benchmark --frames=300
+	if (args.CheckCmdLineFlag("debug-draw-benchmark"))
+	{
+		glutInit(&argc, argv);
+		glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH | GLUT_STENCIL);
+		glutInitWindowSize(1024,600);
+		glutCreateWindow("Bullet debug draw benchmark");
+		ccdDemo.myinit();
+		ccdDemo.reshape(1024,600);
+
+		GLDebugDrawer* drawer = static_cast<GLDebugDrawer*>(ccdDemo.getDynamicsWorld()->getDebugDrawer());
+		DebugDrawBenchmarkSettings settings[2];
+		DebugDrawBenchmarkResults results[2];
+		for (int i=0;i<2;i++)
+		{
+			args.GetCmdLineArgument("frames",settings[i].m_numFrames);
+			settings[i].m_batching = (i==0);
+			if (i)
+				ccdDemo.clientResetScene();
+			runDebugDrawBenchmark(&ccdDemo,drawer,settings[i],results[i]);
+			printDebugDrawBenchmarkResults(settings[i],results[i]);
+		}
+		printf("debug draw speedup: %.2fx\n",results[0].m_totalDebugDrawTime > 0. ? results[1].m_totalDebugDrawTime/results[0].m_totalDebugDrawTime : 0.);
+		return 0;
+	}
+
+	///scripted shootBox stress test, runs without a window
+	///e.g. AppBasicDemo --ccd-benchmark --projectiles=5000 --rate=240 --speed=80
+	///--ccd-mode=swept|speculative|none|all, 'all' runs every mode on a fresh scene and compares them
+	std::string ccdMode("swept");
+	args.GetCmdLineArgument("ccd-mode",ccdMode);
+	int ccdModes[3];
+	int numCcdModes = 0;
+	for (int mode=DemoApplication::PROJECTILE_CCD_SWEPT_SPHERE;mode<=DemoApplication::PROJECTILE_CCD_NONE;mode++)
+	{
+		if (ccdMode=="all" || ccdMode==getProjectileCcdModeName(mode))
+			ccdModes[numCcdModes++] = mode;
+	}
+	if (!numCcdModes)
+	{
+		printf("unknown --ccd-mode=%s, using swept\n",ccdMode.c_str());
+		ccdModes[numCcdModes++] = DemoApplication::PROJECTILE_CCD_SWEPT_SPHERE;
+	}
+	ccdDemo.setProjectileCcdMode(ccdModes[0]);
+
+	if (args.CheckCmdLineFlag("ccd-benchmark"))
+	{
+		ProjectileBenchmarkSettings settings[3];
+		ProjectileBenchmarkResults results[3];
+		for (int i=0;i<numCcdModes;i++)
+		{
+			args.GetCmdLineArgument("projectiles",settings[i].m_numProjectiles);
+			args.GetCmdLineArgument("rate",settings[i].m_projectilesPerSecond);
+			args.GetCmdLineArgument("speed",settings[i].m_projectileSpeed);
+			args.GetCmdLineArgument("timestep",settings[i].m_timeStep);
+			args.GetCmdLineArgument("settle",settings[i].m_settleSteps);
+			settings[i].m_ccdMode = ccdModes[i];
+			if (!settings[i].isValid())
+			{
+				printf("--rate and --timestep must be positive, --projectiles and --settle not negative\n");
+				return 1;
+			}
+
+			if (i)
+				ccdDemo.clientResetScene();
+			runProjectileBenchmark(&ccdDemo,settings[i],results[i]);
+			printProjectileBenchmarkResults(settings[i],results[i]);
+			if (ccdDemo.getProjectilePool())
+				printf("recycled projectiles: %d (pool capacity %d)\n",ccdDemo.getProjectilePool()->getNumRecycled(),ccdDemo.getProjectilePool()->getCapacity());
+			if (ccdDemo.getCollisionObjectReorder())
+				printf("collision object reorders: %d\n",ccdDemo.getCollisionObjectReorder()->getNumReorders());
+		}
+		if (numCcdModes>1)
+			printProjectileBenchmarkComparison(settings,results,numCcdModes);
+		return 0;
+	}
+
+	///record every frame of the window into numbered images, read back asynchronously and written on a thread
+	///e.g. AppBasicDemo --capture=frames/BasicDemo --capture-queue=32 --format=png, 'M' stops and restarts it
+	if (args.CheckCmdLineFlag("capture"))
+	{
+		std::string prefix("BasicDemo");
+		std::string format("png");
+		int queueSize = 16;
+		args.GetCmdLineArgument("capture",prefix);
+		args.GetCmdLineArgument("capture-queue",queueSize);
+		args.GetCmdLineArgument("format",format);
+		ccdDemo.getFrameCapture()->setQueueSize(queueSize);
+		if (!ccdDemo.getFrameCapture()->start(prefix.c_str(),format!="ppm"))
+			printf("can't start the frame capture\n");
+	}
+
 
 #ifdef CHECK_MEMORY_LEAKS
 	ccdDemo.exitPhysics();
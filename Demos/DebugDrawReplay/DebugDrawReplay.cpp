@@ -0,0 +1,121 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "DebugDrawReplay.h"
+#include "GlutStuff.h"
+
+#include <stdio.h>
+
+DebugDrawReplay::DebugDrawReplay()
+:m_frameIndex(0),
+m_loadedFrame(-1),
+m_playing(true)
+{
+}
+
+DebugDrawReplay::~DebugDrawReplay()
+{
+}
+
+bool	DebugDrawReplay::open(const char* fileName)
+{
+	if (!m_reader.open(fileName))
+		return false;
+	m_frameIndex = 0;
+	m_loadedFrame = -1;
+	loadFrame();
+
+	btVector3 aabbMin,aabbMax;
+	if (m_frame.getBounds(aabbMin,aabbMax))
+	{
+		m_cameraTargetPosition = (aabbMin+aabbMax)*btScalar(0.5);
+		setCameraDistance(btMax(btScalar(1.),(aabbMax-aabbMin).length()));
+	}
+	return true;
+}
+
+void	DebugDrawReplay::loadFrame()
+{
+	if (m_frameIndex==m_loadedFrame)
+		return;
+	if (!m_reader.readFrame(m_frameIndex,m_frame))
+		m_frame.clear();
+	m_loadedFrame = m_frameIndex;
+}
+
+void	DebugDrawReplay::clientMoveAndDisplay()
+{
+	if (m_playing && !isIdle() && m_reader.getNumFrames())
+		m_frameIndex = (m_frameIndex+1)%m_reader.getNumFrames();
+	displayCallback();
+}
+
+void	DebugDrawReplay::displayCallback()
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	renderme();
+
+	loadFrame();
+	m_frame.draw(&m_drawer);
+	m_drawer.flush();
+
+	if ((getDebugMode() & btIDebugDraw::DBG_NoHelpText)==0)
+	{
+		char status[128];
+		sprintf(status,"frame %d of %d (%s): %u lines, %u triangles, %u contacts",
+			m_frameIndex+1,m_reader.getNumFrames(),m_playing ? "playing" : "paused",
+			m_frame.m_header.m_numLines,m_frame.m_header.m_numTriangles,m_frame.m_header.m_numContacts);
+		glDisable(GL_LIGHTING);
+		glColor3f(0,0,0);
+		setOrthographicProjection();
+		displayProfileString(10,m_glutScreenHeight-20,status);
+		resetPerspectiveProjection();
+		glEnable(GL_LIGHTING);
+	}
+
+	glFlush();
+	swapBuffers();
+}
+
+void	DebugDrawReplay::clientResetScene()
+{
+	m_frameIndex = 0;
+}
+
+void	DebugDrawReplay::keyboardCallback(unsigned char key, int x, int y)
+{
+	const int numFrames = m_reader.getNumFrames();
+	switch (key)
+	{
+	case 'k':
+		m_playing = false;
+		if (numFrames)
+			m_frameIndex = (m_frameIndex+1)%numFrames;
+		break;
+	case 'j':
+		m_playing = false;
+		if (numFrames)
+			m_frameIndex = (m_frameIndex+numFrames-1)%numFrames;
+		break;
+	case 'K':
+		m_playing = true;
+		break;
+	default:
+		GlutDemoApplication::keyboardCallback(key,x,y);
+		return;
+	}
+	glutPostRedisplay();
+}
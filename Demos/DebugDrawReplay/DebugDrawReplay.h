@@ -0,0 +1,52 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef DEBUG_DRAW_REPLAY_H
+#define DEBUG_DRAW_REPLAY_H
+
+#include "GlutDemoApplication.h"
+#include "GLDebugDrawer.h"
+#include "StreamDebugDrawer.h"
+
+///DebugDrawReplay plays back a debug draw stream written by StreamDebugDrawer, for example on a simulation
+///server without a window. There is no physics world, the frames are drawn with a GLDebugDrawer.
+///'k' and 'j' step one frame forward and back and pause the playback, 'K' resumes it, space rewinds.
+class DebugDrawReplay : public GlutDemoApplication
+{
+	DebugDrawStreamReader	m_reader;
+	DebugDrawStreamFrame	m_frame;
+	GLDebugDrawer			m_drawer;
+	int		m_frameIndex;
+	int		m_loadedFrame;
+	bool	m_playing;
+
+	void	loadFrame();
+
+public:
+
+	DebugDrawReplay();
+	virtual ~DebugDrawReplay();
+
+	///open the stream and aim the camera at the geometry of its first frame
+	bool	open(const char* fileName);
+
+	virtual void	initPhysics() {}
+
+	virtual void	clientMoveAndDisplay();
+	virtual void	displayCallback();
+	virtual void	clientResetScene();
+	virtual void	keyboardCallback(unsigned char key, int x, int y);
+};
+
+#endif //DEBUG_DRAW_REPLAY_H
@@ -0,0 +1,37 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "DebugDrawReplay.h"
+#include "GlutStuff.h"
+
+#include <stdio.h>
+
+int main(int argc,char** argv)
+{
+	if (argc<2)
+	{
+		printf("usage: %s stream.btdd\n",argv[0]);
+		return 1;
+	}
+
+	DebugDrawReplay replay;
+	if (!replay.open(argv[1]))
+	{
+		printf("%s is not a debug draw stream\n",argv[1]);
+		return 1;
+	}
+
+	return glutmain(argc, argv,1024,600,"Bullet debug draw replay",&replay);
+}
@@ -0,0 +1,194 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "CollisionObjectReorder.h"
+#include "DemoDynamicsWorld.h"
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+#include "LinearMath/btQuickprof.h"
+
+///spread the lower 10 bits of v, so there are two zero bits between each of them
+static unsigned int	spreadBits(unsigned int v)
+{
+	v &= 0x3ff;
+	v = (v | (v << 16)) & 0x030000ff;
+	v = (v | (v << 8)) & 0x0300f00f;
+	v = (v | (v << 4)) & 0x030c30c3;
+	v = (v | (v << 2)) & 0x09249249;
+	return v;
+}
+
+CollisionObjectReorder::CollisionObjectReorder(int interval)
+:m_interval(interval),
+m_counter(0),
+m_numReorders(0)
+{
+}
+
+bool	CollisionObjectReorder::isReorderDue()
+{
+	if (m_interval <= 0)
+		return false;
+	if (++m_counter < m_interval)
+		return false;
+	m_counter = 0;
+	return true;
+}
+
+void	CollisionObjectReorder::update(btDynamicsWorld* world)
+{
+	if (isReorderDue())
+		reorder(world);
+}
+
+void	CollisionObjectReorder::update(DemoDynamicsWorld* world)
+{
+	if (isReorderDue())
+		reorder(world);
+}
+
+void	CollisionObjectReorder::reorder(btDynamicsWorld* world)
+{
+	BT_PROFILE("reorderCollisionObjects");
+
+	btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	int numObjects = objects.size();
+	if (numObjects < 2)
+	{
+		updateHandleIndices(world);
+		return;
+	}
+
+	btVector3 boundsMin(BT_LARGE_FLOAT,BT_LARGE_FLOAT,BT_LARGE_FLOAT);
+	btVector3 boundsMax(-BT_LARGE_FLOAT,-BT_LARGE_FLOAT,-BT_LARGE_FLOAT);
+	for (int i=0;i<numObjects;i++)
+	{
+		const btVector3& pos = objects[i]->getWorldTransform().getOrigin();
+		boundsMin.setMin(pos);
+		boundsMax.setMax(pos);
+	}
+	btVector3 extent = boundsMax-boundsMin;
+	btVector3 scale;
+	for (int axis=0;axis<3;axis++)
+	{
+		scale[axis] = extent[axis] > SIMD_EPSILON ? btScalar(1023.)/extent[axis] : btScalar(0.);
+	}
+
+	m_keys.resize(numObjects);
+	for (int i=0;i<numObjects;i++)
+	{
+		btVector3 cell = (objects[i]->getWorldTransform().getOrigin()-boundsMin)*scale;
+		m_keys[i].m_code = spreadBits((unsigned int)cell.getX()) | (spreadBits((unsigned int)cell.getY())<<1) | (spreadBits((unsigned int)cell.getZ())<<2);
+		m_keys[i].m_index = i;
+	}
+
+	///radix sort on the 30 bit code, 3 passes of 10 bits, it is stable so equal codes keep their order
+	m_tempKeys.resize(numObjects);
+	btAlignedObjectArray<SortKey>* src = &m_keys;
+	btAlignedObjectArray<SortKey>* dst = &m_tempKeys;
+	int counts[1024];
+	for (int shift=0;shift<30;shift+=10)
+	{
+		for (int b=0;b<1024;b++)
+			counts[b] = 0;
+		for (int i=0;i<numObjects;i++)
+			counts[((*src)[i].m_code>>shift)&0x3ff]++;
+		int offset = 0;
+		for (int b=0;b<1024;b++)
+		{
+			int count = counts[b];
+			counts[b] = offset;
+			offset += count;
+		}
+		for (int i=0;i<numObjects;i++)
+			(*dst)[counts[((*src)[i].m_code>>shift)&0x3ff]++] = (*src)[i];
+		btAlignedObjectArray<SortKey>* swapTemp = src;
+		src = dst;
+		dst = swapTemp;
+	}
+
+	m_sorted.resize(numObjects);
+	for (int i=0;i<numObjects;i++)
+		m_sorted[i] = objects[(*src)[i].m_index];
+	for (int i=0;i<numObjects;i++)
+		objects[i] = m_sorted[i];
+
+	m_numReorders++;
+	updateHandleIndices(world);
+}
+
+void	CollisionObjectReorder::reorder(DemoDynamicsWorld* world)
+{
+	reorder((btDynamicsWorld*)world);
+
+	///the non-static bodies are a subset of the collision objects, give them the same relative order
+	btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	btAlignedObjectArray<btRigidBody*>& bodies = world->getNonStaticRigidBodies();
+	btHashMap<btHashPtr,int> isNonStatic;
+	for (int i=0;i<bodies.size();i++)
+		isNonStatic.insert(btHashPtr(bodies[i]),i);
+	int numBodies = 0;
+	for (int i=0;i<objects.size() && numBodies<bodies.size();i++)
+	{
+		if (isNonStatic.find(btHashPtr(objects[i])))
+			bodies[numBodies++] = (btRigidBody*)objects[i];
+	}
+	btAssert(numBodies == bodies.size());
+}
+
+void	CollisionObjectReorder::updateHandleIndices(btDynamicsWorld* world)
+{
+	for (int i=0;i<m_handleIndices.size();i++)
+		m_handleIndices[i] = -1;
+
+	btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	for (int i=0;i<objects.size();i++)
+	{
+		int* handle = m_objectHandles.find(btHashPtr(objects[i]));
+		if (handle)
+			m_handleIndices[*handle] = i;
+	}
+
+	///objects that were removed from the world lose their handle
+	for (int i=0;i<m_handleIndices.size();i++)
+	{
+		if (m_handleIndices[i] < 0 && m_handleObjects[i])
+		{
+			m_objectHandles.remove(btHashPtr(m_handleObjects[i]));
+			m_handleObjects[i] = 0;
+		}
+	}
+}
+
+int		CollisionObjectReorder::getHandle(btDynamicsWorld* world,const btCollisionObject* obj)
+{
+	int* handle = m_objectHandles.find(btHashPtr(obj));
+	if (handle)
+		return *handle;
+
+	int newHandle = m_handleObjects.size();
+	m_objectHandles.insert(btHashPtr(obj),newHandle);
+	m_handleObjects.push_back((btCollisionObject*)obj);
+	int index = world->getCollisionObjectArray().findLinearSearch((btCollisionObject*)obj);
+	m_handleIndices.push_back(index < world->getNumCollisionObjects() ? index : -1);
+	return newHandle;
+}
+
+void	CollisionObjectReorder::clear()
+{
+	m_handleObjects.clear();
+	m_handleIndices.clear();
+	m_objectHandles.clear();
+	m_counter = 0;
+}
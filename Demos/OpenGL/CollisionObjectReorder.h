@@ -0,0 +1,101 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef COLLISION_OBJECT_REORDER_H
+#define COLLISION_OBJECT_REORDER_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btHashMap.h"
+
+class btCollisionObject;
+class btDynamicsWorld;
+class btRigidBody;
+class DemoDynamicsWorld;
+
+///CollisionObjectReorder sorts the collision object array of a world by the Morton code (Z-order curve) of
+///the object positions, so the loops over getCollisionObjectArray() visit objects that are close in space
+///one after the other. Only the pointer arrays are permuted, the objects themselves stay where they were
+///allocated. For a DemoDynamicsWorld the array of non-static rigid bodies, which is used for integration
+///and motion prediction, is sorted the same way.
+///Only call it between simulation steps. Array indices change on every reorder, so code that needs to refer
+///to an object by number should use the stable handles instead.
+class CollisionObjectReorder
+{
+	struct SortKey
+	{
+		unsigned int	m_code;
+		int				m_index;
+	};
+
+	///handle -> object, 0 for objects that left the world
+	btAlignedObjectArray<btCollisionObject*>	m_handleObjects;
+	///handle -> index in the collision object array, -1 for objects that left the world
+	btAlignedObjectArray<int>					m_handleIndices;
+	btHashMap<btHashPtr,int>					m_objectHandles;
+
+	btAlignedObjectArray<SortKey>				m_keys;
+	btAlignedObjectArray<SortKey>				m_tempKeys;
+	btAlignedObjectArray<btCollisionObject*>	m_sorted;
+
+	int		m_interval;
+	int		m_counter;
+	int		m_numReorders;
+
+	bool	isReorderDue();
+	void	updateHandleIndices(btDynamicsWorld* world);
+
+public:
+
+	CollisionObjectReorder(int interval);
+
+	///reorder every interval calls of update, 0 disables the periodic reorder
+	void	setInterval(int interval)
+	{
+		m_interval = interval;
+	}
+	int		getInterval() const
+	{
+		return m_interval;
+	}
+	int		getNumReorders() const
+	{
+		return m_numReorders;
+	}
+
+	///call once per simulation step or frame
+	void	update(btDynamicsWorld* world);
+	void	update(DemoDynamicsWorld* world);
+
+	///reorder sorts the collision object array, and for a DemoDynamicsWorld also its non-static rigid bodies
+	void	reorder(btDynamicsWorld* world);
+	void	reorder(DemoDynamicsWorld* world);
+
+	///getHandle returns a number that keeps referring to obj, it is assigned on first use
+	int		getHandle(btDynamicsWorld* world,const btCollisionObject* obj);
+	btCollisionObject*	getObject(int handle) const
+	{
+		return m_handleObjects[handle];
+	}
+	///current index of the object in getCollisionObjectArray(), -1 once it left the world.
+	///It is refreshed on every reorder, removing objects from the world moves other objects too.
+	int		getObjectIndex(int handle) const
+	{
+		return m_handleIndices[handle];
+	}
+
+	///forget all handles, when the world is deleted (for example in exitPhysics)
+	void	clear();
+};
+
+#endif //COLLISION_OBJECT_REORDER_H
@@ -31,7 +31,22 @@ subject to the following restrictions:
 #include "LinearMath/btQuickprof.h"
 #include "LinearMath/btDefaultMotionState.h"
 #include "LinearMath/btSerializer.h"
+#include "StreamingSerializer.h"
 #include "GLDebugFont.h"
+#include "ProjectilePool.h"
+#include "SpeculativeContacts.h"
+#include "DemoDynamicsWorld.h"
+#include "CollisionObjectReorder.h"
+#include "FrustumCuller.h"
+#include "OcclusionCuller.h"
+#include "ProfileHud.h"
+#include "FrameTimeHistogram.h"
+#include "RayTracer.h"
+#include "FrameCapture.h"
+#include "RenderTexture.h"
+#include "RenderQueue.h"
+#include "GL_UnitShapes.h"
+#include "LinearMath/btAabbUtil2.h"
 
 
 extern bool gDisableDeactivation;
@@ -61,6 +76,13 @@ DemoApplication::DemoApplication()
 m_dynamicsWorld(0),
 m_pickConstraint(0),
 m_shootBoxShape(0),
+m_projectilePool(0),
+m_projectileBoundsMin(-1000,-1000,-1000),
+m_projectileBoundsMax(1000,1000,1000),
+m_projectileCcdMode(PROJECTILE_CCD_SWEPT_SPHERE),
+m_speculativeContacts(0),
+m_demoDynamicsWorld(0),
+m_objectReorder(0),
 m_cameraDistance(15.0),
 m_debugMode(0),
 m_ele(20.f),
@@ -86,6 +108,14 @@ m_stepping(true),
 m_singleStep(false),
 m_idle(false),
 
+m_instancedRendering(true),
+m_frustumCulling(true),
+m_occlusionCulling(false),
+m_numOccludedObjects(0),
+m_rayTracedView(false),
+m_rayTracer(0),
+m_rayTraceDownscale(2),
+m_frameCapture(new FrameCapture()),
 m_enableshadows(false),
 m_sundirection(btVector3(1,-2,1)*1000),
 m_defaultContactProcessingThreshold(BT_LARGE_FLOAT)
@@ -97,6 +127,11 @@ m_defaultContactProcessingThreshold(BT_LARGE_FLOAT)
 	m_shapeDrawer = new GL_ShapeDrawer ();
 	m_shapeDrawer->enableTexture(true);
 	m_enableshadows = false;
+	m_frustumCuller = new FrustumCuller();
+	m_occlusionCuller = new OcclusionCuller();
+	m_renderQueue = new RenderQueue();
+	m_profileHud = new ProfileHud();
+	m_hitchDetector = new HitchDetector();
 }
 
 
@@ -108,7 +143,21 @@ DemoApplication::~DemoApplication()
 #endif //BT_NO_PROFILE
 
 	if (m_shootBoxShape)
+	{
+		m_shapeDrawer->invalidateShape(m_shootBoxShape);
 		delete m_shootBoxShape;
+	}
+
+	delete m_projectilePool;
+	delete m_speculativeContacts;
+	delete m_objectReorder;
+	delete m_frustumCuller;
+	delete m_occlusionCuller;
+	delete m_renderQueue;
+	delete m_profileHud;
+	delete m_hitchDetector;
+	delete m_rayTracer;
+	delete m_frameCapture;
 
 	if (m_shapeDrawer)
 		delete m_shapeDrawer;
@@ -118,6 +167,7 @@ DemoApplication::~DemoApplication()
 void DemoApplication::overrideGLShapeDrawer (GL_ShapeDrawer* shapeDrawer)
 {
 	shapeDrawer->enableTexture (m_shapeDrawer->hasTextureEnabled());
+	shapeDrawer->setCacheMemoryBudget (m_shapeDrawer->getCacheMemoryBudget());
 	delete m_shapeDrawer;
 	m_shapeDrawer = shapeDrawer;
 }
@@ -150,6 +200,8 @@ void DemoApplication::myinit(void)
 	glShadeModel(GL_SMOOTH);
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LESS);
+	///the unit spheres, cylinders and cones are scaled by the modelview matrix
+	glEnable(GL_NORMALIZE);
 
 	glClearColor(btScalar(0.7),btScalar(0.7),btScalar(0.7),btScalar(0));
 
@@ -173,6 +225,8 @@ float	DemoApplication::getCameraDistance()
 void DemoApplication::toggleIdle() {
 	if (m_idle) {
 		m_idle = false;
+		//the first frame after the pause is as long as the pause
+		m_hitchDetector->ignoreNextFrame();
 	}
 	else {
 		m_idle = true;
@@ -182,11 +236,8 @@ void DemoApplication::toggleIdle() {
 
 
 
-void DemoApplication::updateCamera() {
-
-
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
+void DemoApplication::updateCameraPosition()
+{
 	btScalar rele = m_ele * btScalar(0.01745329251994329547);// rads per deg
 	btScalar razi = m_azi * btScalar(0.01745329251994329547);// rads per deg
 
@@ -211,6 +262,14 @@ void DemoApplication::updateCamera() {
 	m_cameraPosition[1] = eyePos.getY();
 	m_cameraPosition[2] = eyePos.getZ();
 	m_cameraPosition += m_cameraTargetPosition;
+}
+
+void DemoApplication::updateCamera() {
+
+
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	updateCameraPosition();
 
 	if (m_glutScreenWidth == 0 && m_glutScreenHeight == 0)
 		return;
@@ -317,10 +376,12 @@ void DemoApplication::keyboardCallback(unsigned char key, int x, int y)
 	{
 		int child = key-0x31;
 		m_profileIterator->Enter_Child(child);
+		m_profileHud->invalidate();
 	}
 	if (key==0x30)
 	{
 		m_profileIterator->Enter_Parent();
+		m_profileHud->invalidate();
 	}
 #endif //BT_NO_PROFILE
 
@@ -333,6 +394,8 @@ void DemoApplication::keyboardCallback(unsigned char key, int x, int y)
 			{
 				btCollisionObject* obj = getDynamicsWorld()->getCollisionObjectArray()[numObj-1];
 
+				if (m_projectilePool)
+					m_projectilePool->removeBody(obj);
 				getDynamicsWorld()->removeCollisionObject(obj);
 				btRigidBody* body = btRigidBody::upcast(obj);
 				if (body && body->getMotionState())
@@ -346,6 +409,8 @@ void DemoApplication::keyboardCallback(unsigned char key, int x, int y)
 			break;
 		}
 	case 'q' : 
+		//the last frames are still in the pixel buffers
+		m_frameCapture->stop();
 #ifdef BT_USE_FREEGLUT
 		//return from glutMainLoop(), detect memory leaks etc.
 		glutLeaveMainLoop();
@@ -363,6 +428,8 @@ void DemoApplication::keyboardCallback(unsigned char key, int x, int y)
 	case 'i' : toggleIdle(); break;
 	case 'g' : m_enableshadows=!m_enableshadows;break;
 	case 'u' : m_shapeDrawer->enableTexture(!m_shapeDrawer->enableTexture(false));break;
+	case 'v' : m_shapeDrawer->enableRetainedMeshes(!m_shapeDrawer->enableRetainedMeshes(false));break;
+	case 'V' : m_instancedRendering=!m_instancedRendering;break;
 	case 'h':
 		if (m_debugMode & btIDebugDraw::DBG_NoHelpText)
 			m_debugMode = m_debugMode & (~btIDebugDraw::DBG_NoHelpText);
@@ -386,14 +453,20 @@ void DemoApplication::keyboardCallback(unsigned char key, int x, int y)
 
 	case '=':
 		{
-			int maxSerializeBufferSize = 1024*1024*5;
-			btDefaultSerializer*	serializer = new btDefaultSerializer(maxSerializeBufferSize);
+			//the chunks are written as they are serialized, large worlds do not need a buffer of their size
+			FILE* f2 = fopen("testFile.bullet","wb");
+			if (!f2)
+			{
+				printf("can't write testFile.bullet\n");
+				break;
+			}
+			StreamingSerializer*	serializer = new StreamingSerializer(f2);
 			//serializer->setSerializationFlags(BT_SERIALIZE_NO_DUPLICATE_ASSERT);
 			m_dynamicsWorld->serialize(serializer);
-			FILE* f2 = fopen("testFile.bullet","wb");
-			fwrite(serializer->getBufferPointer(),serializer->getCurrentBufferSize(),1,f2);
-			fclose(f2);
+			if (serializer->hasWriteError())
+				printf("can't write testFile.bullet\n");
 			delete serializer;
+			fclose(f2);
 			break;
 
 		}
@@ -477,6 +550,33 @@ void DemoApplication::keyboardCallback(unsigned char key, int x, int y)
 			m_ortho = !m_ortho;//m_stepping = !m_stepping;
 			break;
 		}
+	case 'O' :
+		{
+			m_occlusionCulling = !m_occlusionCulling;
+			break;
+		}
+	case 'H' :
+		{
+			m_hitchDetector->printSummary(stdout);
+			break;
+		}
+	case 'R' :
+		{
+			m_rayTracedView = !m_rayTracedView;
+			break;
+		}
+	case 'M' :
+		{
+			if (m_frameCapture->isCapturing())
+			{
+				m_frameCapture->stop();
+				printf("captured %d frames, wrote %d, dropped %d\n",m_frameCapture->getNumFrames(),m_frameCapture->getNumWritten(),m_frameCapture->getNumDropped());
+			} else if (!m_frameCapture->start("capture"))
+			{
+				printf("can't start the frame capture\n");
+			}
+			break;
+		}
 	case 's' : clientMoveAndDisplay(); break;
 		//    case ' ' : newRandom(); break;
 	case ' ':
@@ -532,6 +632,28 @@ void	DemoApplication::setDebugMode(int mode)
 
 
 
+btScalar	DemoApplication::getDeltaTimeMicroseconds()
+{
+#ifdef USE_BT_CLOCK
+	btScalar dt = (btScalar)m_clock.getTimeMicroseconds();
+	m_clock.reset();
+	m_hitchDetector->recordFrame(dt);
+	return dt;
+#else
+	return btScalar(16666.);
+#endif
+}
+
+int	DemoApplication::timedStepSimulation(btScalar timeStep,int maxSubSteps,btScalar fixedTimeStep)
+{
+	if (!m_dynamicsWorld)
+		return 0;
+	btClock clock;
+	int numSubSteps = m_dynamicsWorld->stepSimulation(timeStep,maxSubSteps,fixedTimeStep);
+	m_hitchDetector->recordStep((btScalar)clock.getTimeMicroseconds());
+	return numSubSteps;
+}
+
 void DemoApplication::moveAndDisplay()
 {
 	if (!m_idle)
@@ -561,18 +683,34 @@ void	DemoApplication::setShootBoxShape ()
 
 void	DemoApplication::shootBox(const btVector3& destination)
 {
+	shootBoxFrom(getCameraPosition(),destination);
+}
+
+btRigidBody*	DemoApplication::shootBoxFrom(const btVector3& camPos,const btVector3& destination)
+{
+	btRigidBody* body = 0;
 
 	if (m_dynamicsWorld)
 	{
 		float mass = 1.f;
 		btTransform startTransform;
 		startTransform.setIdentity();
-		btVector3 camPos = getCameraPosition();
 		startTransform.setOrigin(camPos);
 
 		setShootBoxShape ();
 
-		btRigidBody* body = this->localCreateRigidBody(mass, startTransform,m_shootBoxShape);
+		if (m_projectilePool)
+		{
+			body = m_projectilePool->acquireRecycledBody(m_dynamicsWorld,startTransform);
+			if (!body)
+			{
+				body = this->localCreateRigidBody(mass, startTransform,m_shootBoxShape);
+				m_projectilePool->addBody(body);
+			}
+		} else
+		{
+			body = this->localCreateRigidBody(mass, startTransform,m_shootBoxShape);
+		}
 		body->setLinearFactor(btVector3(1,1,1));
 		//body->setRestitution(1);
 
@@ -584,13 +722,80 @@ void	DemoApplication::shootBox(const btVector3& destination)
 		body->getWorldTransform().setRotation(btQuaternion(0,0,0,1));
 		body->setLinearVelocity(linVel);
 		body->setAngularVelocity(btVector3(0,0,0));
-		body->setCcdMotionThreshold(0.5);
-		body->setCcdSweptSphereRadius(0.4f);//value should be smaller (embedded) than the half extends of the box (see ::setShootBoxShape)
+		if (m_projectileCcdMode == PROJECTILE_CCD_SWEPT_SPHERE)
+		{
+			body->setCcdMotionThreshold(0.5);
+			body->setCcdSweptSphereRadius(0.4f);//value should be smaller (embedded) than the half extends of the box (see ::setShootBoxShape)
+		} else
+		{
+			//speculative contacts (if any) take care of fast motion, disable the swept sphere
+			body->setCcdMotionThreshold(0.);
+		}
 //		printf("shootBox uid=%d\n", body->getBroadphaseHandle()->getUid());
 //		printf("camPos=%f,%f,%f\n",camPos.getX(),camPos.getY(),camPos.getZ());
 //		printf("destination=%f,%f,%f\n",destination.getX(),destination.getY(),destination.getZ());
 		
 	}
+	return body;
+}
+
+
+void	DemoApplication::setProjectilePoolCapacity(int capacity)
+{
+	///bodies of a previous pool stay in the world, they are just no longer recycled
+	delete m_projectilePool;
+	m_projectilePool = capacity > 0 ? new ProjectilePool(capacity) : 0;
+	if (m_projectilePool)
+		m_projectilePool->setWorldBounds(m_projectileBoundsMin,m_projectileBoundsMax);
+}
+
+void	DemoApplication::setProjectileWorldBounds(const btVector3& boundsMin,const btVector3& boundsMax)
+{
+	m_projectileBoundsMin = boundsMin;
+	m_projectileBoundsMax = boundsMax;
+	if (m_projectilePool)
+		m_projectilePool->setWorldBounds(boundsMin,boundsMax);
+}
+
+
+void	DemoApplication::setDemoDynamicsWorld(DemoDynamicsWorld* world)
+{
+	m_demoDynamicsWorld = world;
+	if (m_demoDynamicsWorld)
+		m_demoDynamicsWorld->setSpeculativeContacts(m_speculativeContacts);
+}
+
+void	DemoApplication::setProjectileCcdMode(int mode)
+{
+	m_projectileCcdMode = mode;
+	if (mode == PROJECTILE_CCD_SPECULATIVE)
+	{
+		if (!m_speculativeContacts)
+			m_speculativeContacts = new SpeculativeContacts();
+		if (m_demoDynamicsWorld)
+			m_demoDynamicsWorld->setSpeculativeContacts(m_speculativeContacts);
+	} else
+	{
+		if (m_demoDynamicsWorld)
+			m_demoDynamicsWorld->setSpeculativeContacts(0);
+		delete m_speculativeContacts;
+		m_speculativeContacts = 0;
+	}
+}
+
+
+void	DemoApplication::setCollisionObjectReorderInterval(int interval)
+{
+	if (interval > 0)
+	{
+		if (!m_objectReorder)
+			m_objectReorder = new CollisionObjectReorder(interval);
+		m_objectReorder->setInterval(interval);
+	} else
+	{
+		delete m_objectReorder;
+		m_objectReorder = 0;
+	}
 }
 
 
@@ -1087,97 +1292,51 @@ void DemoApplication::displayProfileString(int xOffset,int yStart,char* message)
 void DemoApplication::showProfileInfo(int& xOffset,int& yStart, int yIncr)
 {
 #ifndef BT_NO_PROFILE
-
-	static double time_since_reset = 0.f;
-	if (!m_idle)
-	{
-		time_since_reset = CProfileManager::Get_Time_Since_Reset();
-	}
-
-
-	{
-		//recompute profiling data, and store profile strings
-
-		char blockTime[128];
-
-		double totalTime = 0;
-
-		int frames_since_reset = CProfileManager::Get_Frame_Count_Since_Reset();
-
-		m_profileIterator->First();
-
-		double parent_time = m_profileIterator->Is_Root() ? time_since_reset : m_profileIterator->Get_Current_Parent_Total_Time();
-
-		{
-			sprintf(blockTime,"--- Profiling: %s (total running time: %.3f ms) ---",	m_profileIterator->Get_Current_Parent_Name(), parent_time );
-			displayProfileString(xOffset,yStart,blockTime);
-			yStart += yIncr;
-			sprintf(blockTime,"press (1,2...) to display child timings, or 0 for parent" );
-			displayProfileString(xOffset,yStart,blockTime);
-			yStart += yIncr;
-
-		}
-
-
-		double accumulated_time = 0.f;
-
-		for (int i = 0; !m_profileIterator->Is_Done(); m_profileIterator->Next())
-		{
-			double current_total_time = m_profileIterator->Get_Current_Total_Time();
-			accumulated_time += current_total_time;
-			double fraction = parent_time > SIMD_EPSILON ? (current_total_time / parent_time) * 100 : 0.f;
-
-			sprintf(blockTime,"%d -- %s (%.2f %%) :: %.3f ms / frame (%d calls)",
-				++i, m_profileIterator->Get_Current_Name(), fraction,
-				(current_total_time / (double)frames_since_reset),m_profileIterator->Get_Current_Total_Calls());
-			displayProfileString(xOffset,yStart,blockTime);
-			yStart += yIncr;
-			totalTime += current_total_time;
-		}
-
-		sprintf(blockTime,"%s (%.3f %%) :: %.3f ms", "Unaccounted",
-			// (min(0, time_since_reset - totalTime) / time_since_reset) * 100);
-			parent_time > SIMD_EPSILON ? ((parent_time - accumulated_time) / parent_time) * 100 : 0.f, parent_time - accumulated_time);
-
-		displayProfileString(xOffset,yStart,blockTime);
-		yStart += yIncr;
-
-
-
-		sprintf(blockTime,"-------------------------------------------------");
-		displayProfileString(xOffset,yStart,blockTime);
-		yStart += yIncr;
-
-	}
+	//the profile iterator is only sampled a few times per second, the text is formatted at that time
+	m_profileHud->update(m_profileIterator,m_idle);
+	m_profileHud->draw(xOffset,yStart,yIncr);
 #endif//BT_NO_PROFILE
-
-
-
-
 }
 
 
-//
-void	DemoApplication::renderscene(int pass)
+///buildRenderQueue collects the visible objects and the shadow casters of this frame, sorted by GL state
+void	DemoApplication::buildRenderQueue()
 {
-	btScalar	m[16];
-	btMatrix3x3	rot;rot.setIdentity();
+	BT_PROFILE("buildRenderQueue");
+	m_renderQueue->clear();
+	if (!m_dynamicsWorld)
+		return;
+
+	btTransform	trans;
 	const int	numObjects=m_dynamicsWorld->getNumCollisionObjects();
-	btVector3 wireColor(1,0,0);
+	btVector3	frustumMin,frustumMax;
+	m_frustumCuller->getFrustumAabb(frustumMin,frustumMax);
+	m_numOccludedObjects = 0;
 	for(int i=0;i<numObjects;i++)
 	{
 		btCollisionObject*	colObj=m_dynamicsWorld->getCollisionObjectArray()[i];
+		int passMask = 0;
+		if (m_frustumCuller->isVisible(colObj))
+		{
+			if (m_occlusionCuller->isVisible(colObj))
+				passMask |= RenderQueue::PASS_SCENE;
+			else
+				m_numOccludedObjects++;
+		}
+		if (m_enableshadows && m_frustumCuller->isShadowCasterVisible(colObj))
+			passMask |= RenderQueue::PASS_SHADOW;
+		if (!passMask)
+			continue;
+
 		btRigidBody*		body=btRigidBody::upcast(colObj);
 		if(body&&body->getMotionState())
 		{
 			btDefaultMotionState* myMotionState = (btDefaultMotionState*)body->getMotionState();
-			myMotionState->m_graphicsWorldTrans.getOpenGLMatrix(m);
-			rot=myMotionState->m_graphicsWorldTrans.getBasis();
+			trans=myMotionState->m_graphicsWorldTrans;
 		}
 		else
 		{
-			colObj->getWorldTransform().getOpenGLMatrix(m);
-			rot=colObj->getWorldTransform().getBasis();
+			trans=colObj->getWorldTransform();
 		}
 		btVector3 wireColor(1.f,1.0f,0.5f); //wants deactivation
 		if(i&1) wireColor=btVector3(0.f,0.0f,1.f);
@@ -1205,38 +1364,177 @@ void	DemoApplication::renderscene(int pass)
 			}
 		}
 
+		const btCollisionShape* shape = colObj->getCollisionShape();
+		RenderQueue::RenderItem& item = m_renderQueue->addItem(shape,m_shapeDrawer->getStateKey(shape,getDebugMode()),wireColor);
+		item.m_passMask = passMask;
+		trans.getOpenGLMatrix(item.m_transform);
+		item.m_shadowExtrusion = m_sundirection*trans.getBasis();
+
 		btVector3 aabbMin(0,0,0),aabbMax(0,0,0);
 		//m_dynamicsWorld->getBroadphase()->getBroadphaseAabb(aabbMin,aabbMax);
 		
 		aabbMin-=btVector3(BT_LARGE_FLOAT,BT_LARGE_FLOAT,BT_LARGE_FLOAT);
 		aabbMax+=btVector3(BT_LARGE_FLOAT,BT_LARGE_FLOAT,BT_LARGE_FLOAT);
-//		printf("aabbMin=(%f,%f,%f)\n",aabbMin.getX(),aabbMin.getY(),aabbMin.getZ());
-//		printf("aabbMax=(%f,%f,%f)\n",aabbMax.getX(),aabbMax.getY(),aabbMax.getZ());
-//		m_dynamicsWorld->getDebugDrawer()->drawAabb(aabbMin,aabbMax,btVector3(1,1,1));
+		///concave meshes only process the triangles that overlap the frustum, the bounds are in mesh space
+		if (m_frustumCuller->isValid() && shape->isConcave())
+		{
+			btTransformAabb(frustumMin,frustumMax,btScalar(0.),trans.inverse(),aabbMin,aabbMax);
+		}
+		item.m_boundsMin = aabbMin;
+		item.m_boundsMax = aabbMax;
+	}
+
+	m_renderQueue->sort();
+}
 
+///renderscene submits the items of the render queue that take part in the pass, in sorted order
+void	DemoApplication::renderscene(int pass)
+{
+	BT_PROFILE("renderscene");
+	///the GL state was changed by the code between the passes
+	m_shapeDrawer->invalidateState();
+	if (getDebugMode() & btIDebugDraw::DBG_DrawWireframe)
+		return;
 
-		if (!(getDebugMode()& btIDebugDraw::DBG_DrawWireframe))
+	const int	passMask=(pass==1) ? RenderQueue::PASS_SHADOW : RenderQueue::PASS_SCENE;
+	///the shadow volume pass 1 is always drawn per object
+	const bool	instanced=m_instancedRendering && (pass!=1);
+	const int	debugMode=(pass==0) ? getDebugMode() : 0;
+	m_renderInstances.resize(0);
+	for (int i=0;i<m_renderQueue->size();i++)
+	{
+		const RenderQueue::RenderItem& item = m_renderQueue->getSortedItem(i);
+		if (!(item.m_passMask & passMask))
+			continue;
+
+		///items are sorted by shape, items of other passes in between don't end a batch
+		if (m_renderInstances.size() && m_renderInstances[0].m_shape != item.m_shape)
 		{
-			switch(pass)
-			{
-			case	0:	m_shapeDrawer->drawOpenGL(m,colObj->getCollisionShape(),wireColor,getDebugMode(),aabbMin,aabbMax);break;
-			case	1:	m_shapeDrawer->drawShadow(m,m_sundirection*rot,colObj->getCollisionShape(),aabbMin,aabbMax);break;
-			case	2:	m_shapeDrawer->drawOpenGL(m,colObj->getCollisionShape(),wireColor*btScalar(0.3),0,aabbMin,aabbMax);break;
-			}
+			m_shapeDrawer->drawInstances(&m_renderInstances[0],m_renderInstances.size());
+			m_renderInstances.resize(0);
+		}
+
+		const btVector3 color = (pass==2) ? item.m_color*btScalar(0.3) : item.m_color;
+		if (instanced && m_shapeDrawer->canDrawInstanced(item.m_shape,debugMode))
+		{
+			GL_ShapeDrawer::ShapeInstance& instance = m_renderInstances.expand();
+			for (int j=0;j<16;j++)
+				instance.m_transform[j] = item.m_transform[j];
+			instance.m_color = color;
+			instance.m_shape = item.m_shape;
+			continue;
 		}
+
+		btScalar* m = (btScalar*)item.m_transform;
+		if (pass==1)
+			m_shapeDrawer->drawShadow(m,item.m_shadowExtrusion,item.m_shape,item.m_boundsMin,item.m_boundsMax);
+		else
+			m_shapeDrawer->drawOpenGL(m,item.m_shape,color,debugMode,item.m_boundsMin,item.m_boundsMax);
+	}
+
+	if (m_renderInstances.size())
+	{
+		m_shapeDrawer->drawInstances(&m_renderInstances[0],m_renderInstances.size());
+		m_renderInstances.resize(0);
 	}
+	m_shapeDrawer->restoreState();
 }
 
 //
+void	DemoApplication::renderRayTraced()
+{
+	if (!m_glutScreenWidth || !m_glutScreenHeight)
+		return;
+	const int width = btMax(m_glutScreenWidth/m_rayTraceDownscale,1);
+	const int height = btMax(m_glutScreenHeight/m_rayTraceDownscale,1);
+	if (!m_rayTracer || m_rayTracer->getWidth()!=width || m_rayTracer->getHeight()!=height)
+	{
+		delete m_rayTracer;
+		m_rayTracer = new RayTracer(width,height);
+	}
+	m_rayTracer->setDbvtBroadphase(m_frustumCuller->getDbvtBroadphase());
+	m_rayTracer->setShadows(m_enableshadows);
+	m_rayTracer->setLightDirection(m_sundirection);
+	///the frustum of updateCamera has a vertical half angle of 45 degrees
+	m_rayTracer->setCamera(m_cameraPosition,m_cameraTargetPosition,m_cameraUp,btScalar(90.));
+	m_rayTracer->renderWorld(m_dynamicsWorld);
+
+	///the texture rows go top to bottom, so they are drawn downwards from the top left corner
+	setOrthographicProjection();
+	glDisable(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_TEXTURE_2D);
+	glRasterPos2i(0,0);
+	glPixelZoom(GLfloat(m_rayTraceDownscale),-GLfloat(m_rayTraceDownscale));
+	glDrawPixels(width,height,GL_RGBA,GL_UNSIGNED_BYTE,m_rayTracer->getRenderTexture()->getBuffer());
+	glPixelZoom(1.f,1.f);
+	glEnable(GL_DEPTH_TEST);
+	resetPerspectiveProjection();
+}
+
+void	DemoApplication::captureFrame()
+{
+	if (m_frameCapture->isCapturing())
+		m_frameCapture->captureFrame(m_glutScreenWidth,m_glutScreenHeight);
+}
+
 void DemoApplication::renderme()
 {
 	myinit();
 
 	updateCamera();
 
+	if (m_objectReorder && !m_idle)
+	{
+		if (m_demoDynamicsWorld)
+			m_objectReorder->update(m_demoDynamicsWorld);
+		else if (m_dynamicsWorld)
+			m_objectReorder->update(m_dynamicsWorld);
+	}
+
+	if (m_dynamicsWorld && m_frustumCulling && (m_glutScreenWidth || m_glutScreenHeight))
+	{
+		GLfloat projection[16],modelview[16];
+		glGetFloatv(GL_PROJECTION_MATRIX,projection);
+		glGetFloatv(GL_MODELVIEW_MATRIX,modelview);
+		btScalar projectionMatrix[16],modelviewMatrix[16];
+		for (int i=0;i<16;i++)
+		{
+			projectionMatrix[i] = btScalar(projection[i]);
+			modelviewMatrix[i] = btScalar(modelview[i]);
+		}
+		m_frustumCuller->setFrustum(projectionMatrix,modelviewMatrix);
+		m_frustumCuller->cullObjects(m_dynamicsWorld,m_enableshadows ? &m_sundirection : 0);
+		///shadow casters are not occlusion culled, an occluded object can still cast a shadow into view
+		if (m_occlusionCulling)
+			m_occlusionCuller->cullObjects(m_dynamicsWorld,*m_frustumCuller,projectionMatrix,modelviewMatrix);
+		else
+			m_occlusionCuller->invalidate();
+	} else
+	{
+		m_frustumCuller->invalidate();
+		m_occlusionCuller->invalidate();
+	}
+
+	///the frustum of updateCamera has a vertical half angle of 45 degrees
+	if (m_glutScreenHeight)
+	{
+		if (m_ortho)
+			GL_UnitShapes::setView(m_cameraPosition,btScalar(m_glutScreenHeight)/(btScalar(2.)*m_cameraDistance),false);
+		else
+			GL_UnitShapes::setView(m_cameraPosition,btScalar(m_glutScreenHeight)*btScalar(0.5),true);
+	}
+
+	m_shapeDrawer->resetStatistics();
+	buildRenderQueue();
+
 	if (m_dynamicsWorld)
 	{			
-		if(m_enableshadows)
+		if (m_rayTracedView)
+		{
+			renderRayTraced();
+		}
+		else if(m_enableshadows)
 		{
 			glClear(GL_STENCIL_BUFFER_BIT);
 			glEnable(GL_CULL_FACE);
@@ -1298,6 +1596,50 @@ void DemoApplication::renderme()
 
 			showProfileInfo(xOffset,yStart,yIncr);
 
+			{
+				char	renderStats[128];
+				sprintf(renderStats,"render queue: %d items, %d draw calls, %d state changes",
+					m_renderQueue->size(),m_shapeDrawer->getNumDrawCalls(),m_shapeDrawer->getNumStateChanges());
+				displayProfileString(xOffset,yStart,renderStats);
+				yStart += yIncr;
+			}
+			{
+				const FrameTimeHistogram& frameTimes = m_hitchDetector->getFrameTimes();
+				char	frameStats[128];
+				sprintf(frameStats,"frames: p50 %.2f / p99 %.2f / max %.2f ms, step p99 %.2f ms, %d hitches (H prints)",
+					frameTimes.getValueAtPercentile(50.)*0.001,frameTimes.getValueAtPercentile(99.)*0.001,frameTimes.getMaxValue()*0.001,
+					m_hitchDetector->getStepTimes().getValueAtPercentile(99.)*0.001,m_hitchDetector->getNumHitches());
+				displayProfileString(xOffset,yStart,frameStats);
+				yStart += yIncr;
+			}
+			if (m_rayTracedView && m_rayTracer)
+			{
+				char	rayTraceStats[128];
+				sprintf(rayTraceStats,"raytrace: %dx%d, %d threads, %.1f ms, %.2f Mrays/s, %d object tests (R toggles)",
+					m_rayTracer->getWidth(),m_rayTracer->getHeight(),m_rayTracer->getNumThreads(),m_rayTracer->getRenderTime(),
+					m_rayTracer->getRaysPerSecond()*1e-6,m_rayTracer->getNumObjectTests());
+				displayProfileString(xOffset,yStart,rayTraceStats);
+				yStart += yIncr;
+			}
+			if (m_frameCapture->isCapturing())
+			{
+				char	captureStats[256];
+				sprintf(captureStats,"capture: %d frames, %d written, %d queued, %d dropped, readback %.2f ms (%s)%s (M stops)",
+					m_frameCapture->getNumFrames(),m_frameCapture->getNumWritten(),m_frameCapture->getNumQueued(),m_frameCapture->getNumDropped(),
+					m_frameCapture->getReadbackTime(),m_frameCapture->getUsePixelBuffers() ? "PBO" : "sync",
+					m_frameCapture->hasWriteError() ? ", write error" : "");
+				displayProfileString(xOffset,yStart,captureStats);
+				yStart += yIncr;
+			}
+			if (m_occlusionCulling)
+			{
+				char	occlusionStats[128];
+				sprintf(occlusionStats,"occlusion: %d occluders, %d objects culled, %d node tests",
+					m_occlusionCuller->getNumOccluders(),m_numOccludedObjects,m_occlusionCuller->getNumNodeTests());
+				displayProfileString(xOffset,yStart,occlusionStats);
+				yStart += yIncr;
+			}
+
 #ifdef USE_QUICKPROF
 
 		
@@ -1322,6 +1664,7 @@ void DemoApplication::renderme()
 
 			
 
+			GLDebugFlushStrings();
 			resetPerspectiveProjection();
 		}
 
@@ -35,14 +35,38 @@ class	btCollisionShape;
 class	btDynamicsWorld;
 class	btRigidBody;
 class	btTypedConstraint;
+class	ProjectilePool;
+class	SpeculativeContacts;
+class	DemoDynamicsWorld;
+class	CollisionObjectReorder;
+class	FrustumCuller;
+class	OcclusionCuller;
+class	RenderQueue;
+class	ProfileHud;
+class	HitchDetector;
+class	RayTracer;
+class	FrameCapture;
 
 
 
 class DemoApplication
 {
+public:
+	///how fast shootBox projectiles are kept from tunnelling
+	enum	ProjectileCcdMode
+	{
+		PROJECTILE_CCD_SWEPT_SPHERE=0,
+		PROJECTILE_CCD_SPECULATIVE,
+		PROJECTILE_CCD_NONE
+	};
+
 protected:
 	void	displayProfileString(int xOffset,int yStart,char* message);
 	class CProfileIterator* m_profileIterator;
+	///sampled profile text and history graphs of showProfileInfo
+	ProfileHud*	m_profileHud;
+	///frame and step time histograms, slow frames dump the profile tree to a file
+	HitchDetector*	m_hitchDetector;
 
 	protected:
 #ifdef USE_BT_CLOCK
@@ -62,6 +86,20 @@ protected:
 
 	btCollisionShape*	m_shootBoxShape;
 
+	///optional, when set shootBox recycles bodies instead of allocating new ones
+	ProjectilePool*		m_projectilePool;
+	///bodies of the pool that leave these bounds can be recycled, see setProjectileWorldBounds
+	btVector3			m_projectileBoundsMin;
+	btVector3			m_projectileBoundsMax;
+
+	int						m_projectileCcdMode;
+	SpeculativeContacts*	m_speculativeContacts;
+	///m_dynamicsWorld when the demo created a DemoDynamicsWorld, see setDemoDynamicsWorld
+	DemoDynamicsWorld*		m_demoDynamicsWorld;
+
+	///optional, sorts the collision objects by position every few frames
+	CollisionObjectReorder*	m_objectReorder;
+
 	float	m_cameraDistance;
 	int	m_debugMode;
 	
@@ -99,9 +137,30 @@ protected:
 	int m_lastKey;
 
 	void showProfileInfo(int& xOffset,int& yStart, int yIncr);
+	void buildRenderQueue();
 	void renderscene(int pass);
+	void renderRayTraced();
 
 	GL_ShapeDrawer*	m_shapeDrawer;
+	///objects that share a collision shape are drawn in one batch per shape
+	bool			m_instancedRendering;
+	btAlignedObjectArray<GL_ShapeDrawer::ShapeInstance>	m_renderInstances;
+	///draw items of the current frame, sorted to reduce GL state changes
+	RenderQueue*	m_renderQueue;
+	///only the objects in the view frustum (or casting a shadow into it) are drawn
+	bool			m_frustumCulling;
+	FrustumCuller*	m_frustumCuller;
+	///objects hidden behind large static boxes are not drawn either, toggled with 'O'
+	bool			m_occlusionCulling;
+	OcclusionCuller*	m_occlusionCuller;
+	int				m_numOccludedObjects;
+	///the scene is raytraced on the CPU through the collision world instead of drawn with OpenGL, toggled with 'R'
+	bool			m_rayTracedView;
+	RayTracer*		m_rayTracer;
+	///the raytraced image has 1/m_rayTraceDownscale of the window resolution
+	int				m_rayTraceDownscale;
+	///reads back every frame and writes it on a thread, toggled with 'M'
+	FrameCapture*	m_frameCapture;
 	bool			m_enableshadows;
 	btVector3		m_sundirection;
 	btScalar		m_defaultContactProcessingThreshold;
@@ -125,6 +184,10 @@ public:
 	}
 
 	void overrideGLShapeDrawer (GL_ShapeDrawer* shapeDrawer);
+	GL_ShapeDrawer*	getShapeDrawer()
+	{
+		return m_shapeDrawer;
+	}
 	
 	void setOrthographicProjection();
 	void resetPerspectiveProjection();
@@ -135,10 +198,59 @@ public:
 	{
 		return m_shapeDrawer->hasTextureEnabled();
 	}
+	bool	setInstancedRendering(bool enable) { bool p=m_instancedRendering;m_instancedRendering=enable;return(p); }
+	bool	getInstancedRendering() const
+	{
+		return m_instancedRendering;
+	}
 	bool	getShadows() const
 	{
 		return m_enableshadows;
 	}
+	bool	setFrustumCulling(bool enable) { bool p=m_frustumCulling;m_frustumCulling=enable;return(p); }
+	bool	getFrustumCulling() const
+	{
+		return m_frustumCulling;
+	}
+	FrustumCuller*	getFrustumCuller()
+	{
+		return m_frustumCuller;
+	}
+	bool	setOcclusionCulling(bool enable) { bool p=m_occlusionCulling;m_occlusionCulling=enable;return(p); }
+	bool	getOcclusionCulling() const
+	{
+		return m_occlusionCulling;
+	}
+	OcclusionCuller*	getOcclusionCuller()
+	{
+		return m_occlusionCuller;
+	}
+	bool	setRayTracedView(bool enable) { bool p=m_rayTracedView;m_rayTracedView=enable;return(p); }
+	bool	getRayTracedView() const
+	{
+		return m_rayTracedView;
+	}
+	void	setRayTraceDownscale(int downscale)
+	{
+		m_rayTraceDownscale = btMax(downscale,1);
+	}
+	///created by the first raytraced frame, and again when the window size changes
+	RayTracer*	getRayTracer()
+	{
+		return m_rayTracer;
+	}
+	FrameCapture*	getFrameCapture()
+	{
+		return m_frameCapture;
+	}
+	ProfileHud*	getProfileHud()
+	{
+		return m_profileHud;
+	}
+	HitchDetector*	getHitchDetector()
+	{
+		return m_hitchDetector;
+	}
 
 
 	int		getDebugMode()
@@ -172,6 +284,8 @@ public:
 	void toggleIdle();
 	
 	virtual void updateCamera();
+	///m_cameraPosition from the target, distance, azimuth and elevation, without any GL call
+	void	updateCameraPosition();
 
 	btVector3	getCameraPosition()
 	{
@@ -182,16 +296,11 @@ public:
 		return m_cameraTargetPosition;
 	}
 
-	btScalar	getDeltaTimeMicroseconds()
-	{
-#ifdef USE_BT_CLOCK
-		btScalar dt = (btScalar)m_clock.getTimeMicroseconds();
-		m_clock.reset();
-		return dt;
-#else
-		return btScalar(16666.);
-#endif
-	}
+	///the time since the previous call, it is recorded as the frame time of the hitch detector
+	btScalar	getDeltaTimeMicroseconds();
+
+	///stepSimulation of the world that records the step duration in the hitch detector
+	int		timedStepSimulation(btScalar timeStep,int maxSubSteps=1,btScalar fixedTimeStep=btScalar(1.)/btScalar(60.));
 	void setFrustumZPlanes(float zNear, float zFar)
 	{
 		m_frustumZNear = zNear;
@@ -211,6 +320,52 @@ public:
 	///Demo functions
 	virtual void setShootBoxShape ();
 	virtual void	shootBox(const btVector3& destination);
+	///shootBoxFrom launches a CCD-enabled box from an arbitrary origin, so it can be scripted without a camera
+	btRigidBody*	shootBoxFrom(const btVector3& origin,const btVector3& destination);
+
+	void	setShootBoxInitialSpeed(float speed)
+	{
+		m_ShootBoxInitialSpeed = speed;
+	}
+	float	getShootBoxInitialSpeed() const
+	{
+		return m_ShootBoxInitialSpeed;
+	}
+
+	///limit the number of shootBox bodies, 0 disables the pool (every shot allocates a new body)
+	void	setProjectilePoolCapacity(int capacity);
+	///projectiles whose center leaves these bounds (like falling off the ground) can be recycled while they
+	///are still active, demos set them in initPhysics. Kept for pools created later.
+	void	setProjectileWorldBounds(const btVector3& boundsMin,const btVector3& boundsMax);
+	ProjectilePool*	getProjectilePool()
+	{
+		return m_projectilePool;
+	}
+
+	///demos that create a DemoDynamicsWorld pass it here after creating it, and 0 before deleting it
+	void	setDemoDynamicsWorld(DemoDynamicsWorld* world);
+	DemoDynamicsWorld*	getDemoDynamicsWorld()
+	{
+		return m_demoDynamicsWorld;
+	}
+
+	///PROJECTILE_CCD_SPECULATIVE runs SpeculativeContacts in the DemoDynamicsWorld, other worlds ignore it
+	void	setProjectileCcdMode(int mode);
+	int		getProjectileCcdMode() const
+	{
+		return m_projectileCcdMode;
+	}
+	SpeculativeContacts*	getSpeculativeContacts()
+	{
+		return m_speculativeContacts;
+	}
+
+	///sort the collision objects by Morton code every interval frames, 0 disables it
+	void	setCollisionObjectReorderInterval(int interval);
+	CollisionObjectReorder*	getCollisionObjectReorder()
+	{
+		return m_objectReorder;
+	}
 
 
 	btVector3	getRayTo(int x,int y);
@@ -239,6 +394,9 @@ public:
 
 	virtual		void swapBuffers() = 0;
 
+	///hands the finished back buffer to m_frameCapture, swapBuffers calls it before the swap
+	void	captureFrame();
+
 	virtual		void	updateModifierKeys() = 0;
 
 	void stepLeft();
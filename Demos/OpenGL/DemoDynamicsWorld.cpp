@@ -0,0 +1,65 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "DemoDynamicsWorld.h"
+#include "SpeculativeContacts.h"
+#include "BulletCollision/BroadphaseCollision/btDispatcher.h"
+
+DemoDynamicsWorld::DemoDynamicsWorld(btDispatcher* dispatcher,btBroadphaseInterface* pairCache,btConstraintSolver* constraintSolver,btCollisionConfiguration* collisionConfiguration)
+:btDiscreteDynamicsWorld(dispatcher,pairCache,constraintSolver,collisionConfiguration),
+m_speculativeContacts(0),
+m_internalTimeStep(btScalar(0.)),
+m_inInternalStep(false),
+m_numSpeculativeManifolds(0)
+{
+}
+
+DemoDynamicsWorld::~DemoDynamicsWorld()
+{
+	releaseSpeculativeManifolds();
+}
+
+void	DemoDynamicsWorld::releaseSpeculativeManifolds()
+{
+	const int numManifolds = m_predictiveManifolds.size();
+	for (int i=numManifolds-m_numSpeculativeManifolds;i<numManifolds;i++)
+	{
+		m_dispatcher1->releaseManifold(m_predictiveManifolds[i]);
+	}
+	m_predictiveManifolds.resize(numManifolds-m_numSpeculativeManifolds);
+	m_numSpeculativeManifolds = 0;
+}
+
+void	DemoDynamicsWorld::internalSingleStepSimulation(btScalar timeStep)
+{
+	m_internalTimeStep = timeStep;
+	m_inInternalStep = true;
+	btDiscreteDynamicsWorld::internalSingleStepSimulation(timeStep);
+	m_inInternalStep = false;
+	releaseSpeculativeManifolds();
+}
+
+void	DemoDynamicsWorld::performDiscreteCollisionDetection()
+{
+	btDiscreteDynamicsWorld::performDiscreteCollisionDetection();
+	//createPredictiveContacts has released the predictive manifolds of the previous step before this,
+	//calculateSimulationIslands comes after it
+	if (m_inInternalStep && m_speculativeContacts)
+	{
+		const int numManifolds = m_predictiveManifolds.size();
+		m_speculativeContacts->createContacts(this,m_internalTimeStep,m_predictiveManifolds);
+		m_numSpeculativeManifolds = m_predictiveManifolds.size()-numManifolds;
+	}
+}
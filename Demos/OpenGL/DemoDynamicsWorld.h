@@ -0,0 +1,64 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef DEMO_DYNAMICS_WORLD_H
+#define DEMO_DYNAMICS_WORLD_H
+
+#include "BulletDynamics/Dynamics/btDiscreteDynamicsWorld.h"
+
+class SpeculativeContacts;
+
+///DemoDynamicsWorld is a btDiscreteDynamicsWorld with the hooks the demo tools need: SpeculativeContacts runs
+///inside each internal step, after the discrete collision detection, and its manifolds are appended to the
+///predictive manifolds, so the islands of their bodies are merged like for any predictive contact. They are
+///released at the end of the step, so no manifold outlives its bodies between steps.
+class DemoDynamicsWorld : public btDiscreteDynamicsWorld
+{
+	SpeculativeContacts*	m_speculativeContacts;
+	btScalar	m_internalTimeStep;
+	bool		m_inInternalStep;
+	///the speculative manifolds are the last ones of m_predictiveManifolds during a step
+	int			m_numSpeculativeManifolds;
+
+	void	releaseSpeculativeManifolds();
+
+protected:
+
+	virtual void	internalSingleStepSimulation(btScalar timeStep);
+
+public:
+
+	DemoDynamicsWorld(btDispatcher* dispatcher,btBroadphaseInterface* pairCache,btConstraintSolver* constraintSolver,btCollisionConfiguration* collisionConfiguration);
+	virtual ~DemoDynamicsWorld();
+
+	virtual void	performDiscreteCollisionDetection();
+
+	///the world does not own the contacts, 0 disables them
+	void	setSpeculativeContacts(SpeculativeContacts* contacts)
+	{
+		m_speculativeContacts = contacts;
+	}
+	SpeculativeContacts*	getSpeculativeContacts()
+	{
+		return m_speculativeContacts;
+	}
+
+	///the dynamic and kinematic bodies that are predicted and integrated every step, in that order
+	btAlignedObjectArray<btRigidBody*>&	getNonStaticRigidBodies()
+	{
+		return m_nonStaticRigidBodies;
+	}
+};
+
+#endif //DEMO_DYNAMICS_WORLD_H
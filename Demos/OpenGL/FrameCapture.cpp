@@ -0,0 +1,391 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "FrameCapture.h"
+#include "RenderTexture.h"
+#include "ThreadSupport.h"
+#include "GlutStuff.h"
+#include "LinearMath/btQuickprof.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__APPLE__)
+#include <dlfcn.h>
+#elif !defined(_WIN32)
+#include <GL/glx.h>
+#endif
+
+//the tree has no extension loader and GL/gl.h may only declare OpenGL 1.1
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER	0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ			0x88E1
+#endif
+#ifndef GL_READ_ONLY
+#define GL_READ_ONLY			0x88B8
+#endif
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+typedef void		(APIENTRY *GenBuffersFunc)(GLsizei n,GLuint* buffers);
+typedef void		(APIENTRY *DeleteBuffersFunc)(GLsizei n,const GLuint* buffers);
+typedef void		(APIENTRY *BindBufferFunc)(GLenum target,GLuint buffer);
+typedef void		(APIENTRY *BufferDataFunc)(GLenum target,ptrdiff_t size,const GLvoid* data,GLenum usage);
+typedef GLvoid*		(APIENTRY *MapBufferFunc)(GLenum target,GLenum access);
+typedef GLboolean	(APIENTRY *UnmapBufferFunc)(GLenum target);
+
+static GenBuffersFunc	sGenBuffers = 0;
+static DeleteBuffersFunc	sDeleteBuffers = 0;
+static BindBufferFunc	sBindBuffer = 0;
+static BufferDataFunc	sBufferData = 0;
+static MapBufferFunc	sMapBuffer = 0;
+static UnmapBufferFunc	sUnmapBuffer = 0;
+
+static void*	getProcAddress(const char* name)
+{
+#if defined(_WIN32)
+	return (void*)wglGetProcAddress(name);
+#elif defined(__APPLE__)
+	return dlsym(RTLD_DEFAULT,name);
+#else
+	return (void*)glXGetProcAddressARB((const GLubyte*)name);
+#endif
+}
+
+///the OpenGL 1.5 name, or the GL_ARB_vertex_buffer_object one
+static void*	getBufferProcAddress(const char* name,const char* arbName)
+{
+	void* proc = getProcAddress(name);
+	return proc ? proc : getProcAddress(arbName);
+}
+
+struct FrameCapture::Shared
+{
+	ThreadMutex		m_mutex;
+	///an image was queued, or the capture stops
+	ThreadCondition	m_queued;
+	ThreadHandle	m_thread;
+	bool			m_quit;
+
+	///ring of images waiting for the writer, m_images[m_head] is written while it stays in the queue
+	btAlignedObjectArray<renderTexture*>	m_images;
+	btAlignedObjectArray<int>	m_frames;
+	int		m_head;
+	int		m_count;
+
+	char	m_prefix[1024];
+	bool	m_png;
+	int		m_numWritten;
+	bool	m_writeError;
+};
+
+static void	writerThread(void* arg)
+{
+	FrameCapture::Shared* shared = (FrameCapture::Shared*)arg;
+	lockMutex(shared->m_mutex);
+	for (;;)
+	{
+		while (!shared->m_quit && shared->m_count==0)
+		{
+			waitCondition(shared->m_queued,shared->m_mutex);
+		}
+		//the queue is flushed before the thread ends
+		if (shared->m_count==0)
+			break;
+		const int index = shared->m_head;
+		const int frame = shared->m_frames[index];
+		unlockMutex(shared->m_mutex);
+
+		char fileName[1100];
+		sprintf(fileName,"%s_%06d.%s",shared->m_prefix,frame,shared->m_png ? "png" : "ppm");
+		const renderTexture* image = shared->m_images[index];
+		const bool written = shared->m_png ? image->writePNG(fileName) : image->writePPM(fileName);
+
+		lockMutex(shared->m_mutex);
+		shared->m_head = (shared->m_head+1)%shared->m_images.size();
+		shared->m_count--;
+		if (written)
+			shared->m_numWritten++;
+		else
+			shared->m_writeError = true;
+	}
+	unlockMutex(shared->m_mutex);
+}
+
+FrameCapture::FrameCapture(int queueSize)
+:m_shared(new Shared),
+m_capturing(false),
+m_pixelBuffersChecked(false),
+m_usePixelBuffers(false),
+m_bufferWidth(0),
+m_bufferHeight(0),
+m_numFrames(0),
+m_numDropped(0),
+m_readbackTime(0.)
+{
+	initMutex(m_shared->m_mutex);
+	initCondition(m_shared->m_queued);
+	m_shared->m_quit = false;
+	m_shared->m_images.resize(btMax(queueSize,1),0);
+	m_shared->m_frames.resize(m_shared->m_images.size(),0);
+	m_shared->m_head = 0;
+	m_shared->m_count = 0;
+	m_shared->m_prefix[0] = 0;
+	m_shared->m_png = true;
+	m_shared->m_numWritten = 0;
+	m_shared->m_writeError = false;
+	for (int i=0;i<NUM_PIXEL_BUFFERS;i++)
+	{
+		m_pixelBuffers[i] = 0;
+		m_pendingFrames[i] = -1;
+	}
+}
+
+FrameCapture::~FrameCapture()
+{
+	if (m_capturing)
+	{
+		lockMutex(m_shared->m_mutex);
+		m_shared->m_quit = true;
+		broadcastCondition(m_shared->m_queued);
+		unlockMutex(m_shared->m_mutex);
+		joinThread(m_shared->m_thread);
+	}
+	for (int i=0;i<m_shared->m_images.size();i++)
+	{
+		delete m_shared->m_images[i];
+	}
+	destroyCondition(m_shared->m_queued);
+	destroyMutex(m_shared->m_mutex);
+	delete m_shared;
+}
+
+void	FrameCapture::setQueueSize(int queueSize)
+{
+	btAssert(!m_capturing);
+	for (int i=0;i<m_shared->m_images.size();i++)
+	{
+		delete m_shared->m_images[i];
+	}
+	m_shared->m_images.resize(0);
+	m_shared->m_images.resize(btMax(queueSize,1),0);
+	m_shared->m_frames.resize(m_shared->m_images.size(),0);
+}
+
+bool	FrameCapture::start(const char* prefix,bool png)
+{
+	stop();
+	strncpy(m_shared->m_prefix,prefix,sizeof(m_shared->m_prefix)-1);
+	m_shared->m_prefix[sizeof(m_shared->m_prefix)-1] = 0;
+	m_shared->m_png = png;
+	m_shared->m_quit = false;
+	m_shared->m_head = 0;
+	m_shared->m_count = 0;
+	m_shared->m_numWritten = 0;
+	m_shared->m_writeError = false;
+	m_numFrames = 0;
+	m_numDropped = 0;
+	m_readbackTime = 0.;
+	m_capturing = startThread(m_shared->m_thread,writerThread,m_shared);
+	return m_capturing;
+}
+
+void	FrameCapture::stop()
+{
+	if (!m_capturing)
+		return;
+	retireAllPixelBuffers();
+	deletePixelBuffers();
+	lockMutex(m_shared->m_mutex);
+	m_shared->m_quit = true;
+	broadcastCondition(m_shared->m_queued);
+	unlockMutex(m_shared->m_mutex);
+	joinThread(m_shared->m_thread);
+	m_capturing = false;
+}
+
+///deletePixelBuffers frees the pixel buffers, the next captureFrame checks for them and creates them again
+void	FrameCapture::deletePixelBuffers()
+{
+	if (m_usePixelBuffers)
+	{
+		sDeleteBuffers(NUM_PIXEL_BUFFERS,m_pixelBuffers);
+		for (int i=0;i<NUM_PIXEL_BUFFERS;i++)
+		{
+			m_pixelBuffers[i] = 0;
+		}
+	}
+	m_pixelBuffersChecked = false;
+	m_usePixelBuffers = false;
+	m_bufferWidth = 0;
+	m_bufferHeight = 0;
+}
+
+void	FrameCapture::checkPixelBuffers()
+{
+	m_pixelBuffersChecked = true;
+	const char* version = (const char*)glGetString(GL_VERSION);
+	const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+	int major = 0;
+	int minor = 0;
+	if (version)
+		sscanf(version,"%d.%d",&major,&minor);
+	if (major<2 || (major==2 && minor<1))
+	{
+		if (!extensions || !strstr(extensions,"GL_ARB_pixel_buffer_object"))
+			return;
+	}
+	sGenBuffers = (GenBuffersFunc)getBufferProcAddress("glGenBuffers","glGenBuffersARB");
+	sDeleteBuffers = (DeleteBuffersFunc)getBufferProcAddress("glDeleteBuffers","glDeleteBuffersARB");
+	sBindBuffer = (BindBufferFunc)getBufferProcAddress("glBindBuffer","glBindBufferARB");
+	sBufferData = (BufferDataFunc)getBufferProcAddress("glBufferData","glBufferDataARB");
+	sMapBuffer = (MapBufferFunc)getBufferProcAddress("glMapBuffer","glMapBufferARB");
+	sUnmapBuffer = (UnmapBufferFunc)getBufferProcAddress("glUnmapBuffer","glUnmapBufferARB");
+	m_usePixelBuffers = sGenBuffers && sDeleteBuffers && sBindBuffer && sBufferData && sMapBuffer && sUnmapBuffer;
+	if (m_usePixelBuffers)
+		sGenBuffers(NUM_PIXEL_BUFFERS,m_pixelBuffers);
+}
+
+void	FrameCapture::resizePixelBuffers(int width,int height)
+{
+	retireAllPixelBuffers();
+	for (int i=0;i<NUM_PIXEL_BUFFERS;i++)
+	{
+		sBindBuffer(GL_PIXEL_PACK_BUFFER,m_pixelBuffers[i]);
+		sBufferData(GL_PIXEL_PACK_BUFFER,ptrdiff_t(width)*height*4,0,GL_STREAM_READ);
+	}
+	sBindBuffer(GL_PIXEL_PACK_BUFFER,0);
+	m_bufferWidth = width;
+	m_bufferHeight = height;
+}
+
+void	FrameCapture::retirePixelBuffer(int index)
+{
+	if (m_pendingFrames[index] < 0)
+		return;
+	sBindBuffer(GL_PIXEL_PACK_BUFFER,m_pixelBuffers[index]);
+	const unsigned char* pixels = (const unsigned char*)sMapBuffer(GL_PIXEL_PACK_BUFFER,GL_READ_ONLY);
+	if (!pixels || !queueFrame(pixels,m_bufferWidth,m_bufferHeight,m_pendingFrames[index]))
+		m_numDropped++;
+	if (pixels)
+		sUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	sBindBuffer(GL_PIXEL_PACK_BUFFER,0);
+	m_pendingFrames[index] = -1;
+}
+
+void	FrameCapture::retireAllPixelBuffers()
+{
+	if (!m_usePixelBuffers)
+		return;
+	//oldest frame first, the buffer of the next frame is already empty
+	for (int i=0;i<NUM_PIXEL_BUFFERS;i++)
+	{
+		retirePixelBuffer((m_numFrames+i)%NUM_PIXEL_BUFFERS);
+	}
+}
+
+bool	FrameCapture::queueFrame(const unsigned char* pixels,int width,int height,int frame)
+{
+	lockMutex(m_shared->m_mutex);
+	const int queueSize = m_shared->m_images.size();
+	const bool full = m_shared->m_count==queueSize;
+	const int index = (m_shared->m_head+m_shared->m_count)%queueSize;
+	unlockMutex(m_shared->m_mutex);
+	if (full)
+		return false;
+
+	//the writer does not touch the slots outside the queue, the copy happens without the lock
+	renderTexture*& image = m_shared->m_images[index];
+	if (!image || image->getWidth()!=width || image->getHeight()!=height)
+	{
+		delete image;
+		image = new renderTexture(width,height);
+	}
+	const int stride = width*4;
+	unsigned char* dst = image->getBuffer();
+	for (int y=0;y<height;y++)
+	{
+		//OpenGL rows are bottom to top, the back buffer alpha is not meaningful
+		unsigned char* row = dst+y*stride;
+		memcpy(row,pixels+(height-1-y)*stride,stride);
+		for (int x=3;x<stride;x+=4)
+		{
+			row[x] = 255;
+		}
+	}
+
+	lockMutex(m_shared->m_mutex);
+	m_shared->m_frames[index] = frame;
+	m_shared->m_count++;
+	broadcastCondition(m_shared->m_queued);
+	unlockMutex(m_shared->m_mutex);
+	return true;
+}
+
+void	FrameCapture::captureFrame(int width,int height)
+{
+	if (!m_capturing || width<=0 || height<=0)
+		return;
+	btClock clock;
+	if (!m_pixelBuffersChecked)
+		checkPixelBuffers();
+	const int frame = m_numFrames++;
+	if (m_usePixelBuffers)
+	{
+		if (width!=m_bufferWidth || height!=m_bufferHeight)
+			resizePixelBuffers(width,height);
+		const int index = frame%NUM_PIXEL_BUFFERS;
+		sBindBuffer(GL_PIXEL_PACK_BUFFER,m_pixelBuffers[index]);
+		glReadPixels(0,0,width,height,GL_RGBA,GL_UNSIGNED_BYTE,0);
+		sBindBuffer(GL_PIXEL_PACK_BUFFER,0);
+		m_pendingFrames[index] = frame;
+		//read two frames ago, the GPU is done with it
+		retirePixelBuffer((frame+1)%NUM_PIXEL_BUFFERS);
+	} else
+	{
+		m_pixels.resize(width*height*4);
+		glReadPixels(0,0,width,height,GL_RGBA,GL_UNSIGNED_BYTE,&m_pixels[0]);
+		if (!queueFrame(&m_pixels[0],width,height,frame))
+			m_numDropped++;
+	}
+	m_readbackTime = double(clock.getTimeMicroseconds())*0.001;
+}
+
+int	FrameCapture::getNumWritten() const
+{
+	lockMutex(m_shared->m_mutex);
+	const int numWritten = m_shared->m_numWritten;
+	unlockMutex(m_shared->m_mutex);
+	return numWritten;
+}
+
+int	FrameCapture::getNumQueued() const
+{
+	lockMutex(m_shared->m_mutex);
+	const int numQueued = m_shared->m_count;
+	unlockMutex(m_shared->m_mutex);
+	return numQueued;
+}
+
+bool	FrameCapture::hasWriteError() const
+{
+	lockMutex(m_shared->m_mutex);
+	const bool writeError = m_shared->m_writeError;
+	unlockMutex(m_shared->m_mutex);
+	return writeError;
+}
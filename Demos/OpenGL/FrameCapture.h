@@ -0,0 +1,117 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+
+///FrameCapture records the frames a demo draws as numbered images without stalling the render loop, so long
+///benchmark runs can be reviewed without an external screen grabber that perturbs the timing.
+///captureFrame starts an asynchronous glReadPixels into one of three pixel buffer objects and maps the one
+///written two frames earlier, which the GPU has finished by then. The mapped pixels are copied into a bounded
+///queue of images. A writer thread compresses and writes them, the render loop never waits for the disk: a
+///frame that finds the queue full is dropped and counted instead.
+///The pixel buffer functions are loaded at run time (OpenGL 2.1 or GL_ARB_pixel_buffer_object). Without them
+///the frames are read back synchronously, still written by the thread.
+class FrameCapture
+{
+public:
+
+	enum
+	{
+		NUM_PIXEL_BUFFERS = 3
+	};
+
+	///the image queue and the writer thread, only FrameCapture.cpp knows them
+	struct Shared;
+
+private:
+
+	Shared*	m_shared;
+	bool	m_capturing;
+
+	bool	m_pixelBuffersChecked;
+	bool	m_usePixelBuffers;
+	unsigned int	m_pixelBuffers[NUM_PIXEL_BUFFERS];
+	///frame number read into each pixel buffer, -1 when it holds none
+	int		m_pendingFrames[NUM_PIXEL_BUFFERS];
+	int		m_bufferWidth;
+	int		m_bufferHeight;
+	///pixels of the synchronous readback
+	btAlignedObjectArray<unsigned char>	m_pixels;
+
+	int		m_numFrames;
+	int		m_numDropped;
+	double	m_readbackTime;
+
+	void	checkPixelBuffers();
+	void	resizePixelBuffers(int width,int height);
+	///map the pixel buffer and queue its frame
+	void	retirePixelBuffer(int index);
+	void	retireAllPixelBuffers();
+	void	deletePixelBuffers();
+	///copy a bottom-up RGBA image into a free queue slot, false drops it
+	bool	queueFrame(const unsigned char* pixels,int width,int height,int frame);
+
+public:
+
+	///queueSize images at most wait for the writer, each one takes width*height*4 bytes
+	FrameCapture(int queueSize=16);
+	///finishes writing the queued images. Frames still in the pixel buffers are lost and the buffers are not
+	///deleted, call stop() while the OpenGL context is current to keep the frames and free the buffers.
+	~FrameCapture();
+
+	///only while not capturing
+	void	setQueueSize(int queueSize);
+
+	///write <prefix>_000000.png, <prefix>_000001.png ... (or .ppm), numbered from 0 again at every start
+	bool	start(const char* prefix,bool png=true);
+	///queue the frames still in the pixel buffers and delete them, write every queued image and end the
+	///writer thread. Needs the OpenGL context.
+	void	stop();
+	bool	isCapturing() const
+	{
+		return m_capturing;
+	}
+
+	///read the back buffer of the current frame, call it before the buffers are swapped
+	void	captureFrame(int width,int height);
+
+	///frames read back since start
+	int		getNumFrames() const
+	{
+		return m_numFrames;
+	}
+	///frames lost because the queue was full
+	int		getNumDropped() const
+	{
+		return m_numDropped;
+	}
+	int		getNumWritten() const;
+	int		getNumQueued() const;
+	///the writer could not write an image
+	bool	hasWriteError() const;
+	///milliseconds of the last captureFrame
+	double	getReadbackTime() const
+	{
+		return m_readbackTime;
+	}
+	bool	getUsePixelBuffers() const
+	{
+		return m_usePixelBuffers;
+	}
+};
+
+#endif //FRAME_CAPTURE_H
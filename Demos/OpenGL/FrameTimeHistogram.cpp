@@ -0,0 +1,229 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "FrameTimeHistogram.h"
+#include "LinearMath/btQuickprof.h"
+#include <string.h>
+
+///values below this have a bucket each
+static const unsigned int	sLinearRange = 64;
+///log2 of the number of sub-buckets per power of two above the linear range
+static const int	sSubBucketBits = 5;
+static const int	sNumBuckets = sLinearRange+(31-sSubBucketBits)*(1<<sSubBucketBits);
+
+FrameTimeHistogram::FrameTimeHistogram()
+{
+	m_counts.resize(sNumBuckets,0);
+	reset();
+}
+
+int	FrameTimeHistogram::getBucketIndex(unsigned int value)
+{
+	if (value < sLinearRange)
+		return int(value);
+	int highestBit = 0;
+	while (value>>(highestBit+1))
+		highestBit++;
+	const int shift = highestBit-sSubBucketBits;
+	const int subBucket = int(value>>shift)-(1<<sSubBucketBits);
+	return int(sLinearRange)+(shift-1)*(1<<sSubBucketBits)+subBucket;
+}
+
+unsigned int	FrameTimeHistogram::getBucketValue(int index)
+{
+	if (index < int(sLinearRange))
+		return (unsigned int)index;
+	const int shift = (index-int(sLinearRange))/(1<<sSubBucketBits)+1;
+	const unsigned int subBucket = (unsigned int)((index-int(sLinearRange))%(1<<sSubBucketBits)+(1<<sSubBucketBits));
+	return ((subBucket+1)<<shift)-1;
+}
+
+void	FrameTimeHistogram::reset()
+{
+	for (int i=0;i<m_counts.size();i++)
+	{
+		m_counts[i] = 0;
+	}
+	m_totalCount = 0;
+	m_minValue = 0xffffffff;
+	m_maxValue = 0;
+	m_sum = 0.;
+}
+
+void	FrameTimeHistogram::record(btScalar microseconds)
+{
+	const unsigned int value = microseconds > btScalar(0.) ? (unsigned int)btMin(microseconds,btScalar(4.0e9)) : 0;
+	m_counts[getBucketIndex(value)]++;
+	m_totalCount++;
+	m_minValue = btMin(m_minValue,value);
+	m_maxValue = btMax(m_maxValue,value);
+	m_sum += double(value);
+}
+
+unsigned int	FrameTimeHistogram::getValueAtPercentile(double percentile) const
+{
+	if (!m_totalCount)
+		return 0;
+	const double fraction = btMin(btMax(percentile,0.),100.)*0.01;
+	unsigned int target = (unsigned int)(fraction*double(m_totalCount)+0.5);
+	if (target < 1)
+		target = 1;
+	unsigned int accumulated = 0;
+	for (int i=0;i<m_counts.size();i++)
+	{
+		accumulated += m_counts[i];
+		if (accumulated >= target)
+			return btMin(getBucketValue(i),m_maxValue);
+	}
+	return m_maxValue;
+}
+
+void	FrameTimeHistogram::print(FILE* file,const char* title) const
+{
+	fprintf(file,"%s: %u samples, mean %.3f ms, min %.3f ms, max %.3f ms\n",title,m_totalCount,
+		getMean()*0.001,double(getMinValue())*0.001,double(m_maxValue)*0.001);
+	if (!m_totalCount)
+		return;
+	static const double percentiles[] = {50.,90.,99.,99.9,99.99,100.};
+	for (int i=0;i<int(sizeof(percentiles)/sizeof(percentiles[0]));i++)
+	{
+		fprintf(file,"  %7.2f%% <= %9.3f ms\n",percentiles[i],double(getValueAtPercentile(percentiles[i]))*0.001);
+	}
+}
+
+HitchDetector::HitchDetector()
+:m_threshold(btScalar(50.)),
+m_frameIndex(0),
+m_numHitches(0),
+m_stepDumped(false),
+m_ignoreNextFrame(true),
+m_lastStepTime(btScalar(0.))
+{
+	setDumpFileName("hitches.txt");
+}
+
+void	HitchDetector::setDumpFileName(const char* fileName)
+{
+	strncpy(m_dumpFileName,fileName,sizeof(m_dumpFileName)-1);
+	m_dumpFileName[sizeof(m_dumpFileName)-1] = 0;
+}
+
+void	HitchDetector::reset()
+{
+	m_frameTimes.reset();
+	m_stepTimes.reset();
+	m_frameIndex = 0;
+	m_numHitches = 0;
+	m_stepDumped = false;
+	m_ignoreNextFrame = true;
+}
+
+void	HitchDetector::recordFrame(btScalar microseconds)
+{
+	if (m_ignoreNextFrame)
+	{
+		m_ignoreNextFrame = false;
+	} else
+	{
+		m_frameTimes.record(microseconds);
+		if (m_threshold > btScalar(0.) && microseconds > m_threshold*btScalar(1000.))
+		{
+			dumpHitch("frame",microseconds);
+		}
+	}
+	m_frameIndex++;
+	m_stepDumped = false;
+}
+
+void	HitchDetector::recordStep(btScalar microseconds)
+{
+	m_stepTimes.record(microseconds);
+	m_lastStepTime = microseconds;
+	if (m_threshold > btScalar(0.) && microseconds > m_threshold*btScalar(1000.) && !m_stepDumped)
+	{
+		dumpHitch("step",microseconds);
+		m_stepDumped = true;
+	}
+}
+
+#ifndef BT_NO_PROFILE
+///write the children of the current node of the iterator and all their descendants
+static void	dumpProfileNode(FILE* file,CProfileIterator* iterator,int depth)
+{
+	const double parentTime = iterator->Is_Root() ? double(CProfileManager::Get_Time_Since_Reset()) : double(iterator->Get_Current_Parent_Total_Time());
+	int numChildren = 0;
+	for (iterator->First();!iterator->Is_Done();iterator->Next())
+	{
+		numChildren++;
+	}
+
+	double accumulated = 0.;
+	for (int i=0;i<numChildren;i++)
+	{
+		iterator->First();
+		for (int j=0;j<i;j++)
+		{
+			iterator->Next();
+		}
+		const double totalTime = iterator->Get_Current_Total_Time();
+		accumulated += totalTime;
+		fprintf(file,"%*s%s: %.3f ms (%.1f %%, %d calls)\n",depth*2+2,"",iterator->Get_Current_Name(),totalTime,
+			parentTime > SIMD_EPSILON ? totalTime/parentTime*100. : 0.,iterator->Get_Current_Total_Calls());
+		iterator->Enter_Child(i);
+		dumpProfileNode(file,iterator,depth+1);
+		iterator->Enter_Parent();
+	}
+	if (numChildren)
+	{
+		fprintf(file,"%*sUnaccounted: %.3f ms\n",depth*2+2,"",parentTime-accumulated);
+	}
+}
+#endif //BT_NO_PROFILE
+
+void	HitchDetector::dumpHitch(const char* what,btScalar microseconds)
+{
+	m_numHitches++;
+	FILE* file = fopen(m_dumpFileName,"a");
+	if (!file)
+	{
+		printf("HitchDetector: cannot open %s\n",m_dumpFileName);
+		return;
+	}
+	fprintf(file,"=== hitch %d: %s of frame %d took %.3f ms (threshold %.3f ms, last step %.3f ms) ===\n",
+		m_numHitches,what,m_frameIndex,double(microseconds)*0.001,double(m_threshold),double(m_lastStepTime)*0.001);
+	if (m_stepDumped)
+	{
+		fprintf(file,"  the profile tree of this frame is in the previous dump\n");
+	} else
+	{
+#ifndef BT_NO_PROFILE
+		CProfileIterator* iterator = CProfileManager::Get_Iterator();
+		fprintf(file,"  %s: %.3f ms, %d frames since reset\n",iterator->Get_Current_Parent_Name(),
+			double(CProfileManager::Get_Time_Since_Reset()),CProfileManager::Get_Frame_Count_Since_Reset());
+		dumpProfileNode(file,iterator,1);
+		CProfileManager::Release_Iterator(iterator);
+#else
+		fprintf(file,"  profiling is disabled (BT_NO_PROFILE)\n");
+#endif //BT_NO_PROFILE
+	}
+	fclose(file);
+}
+
+void	HitchDetector::printSummary(FILE* file) const
+{
+	m_frameTimes.print(file,"frame time");
+	m_stepTimes.print(file,"step time");
+	fprintf(file,"%d hitches above %.1f ms written to %s\n",m_numHitches,double(m_threshold),m_dumpFileName);
+}
@@ -0,0 +1,131 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef FRAME_TIME_HISTOGRAM_H
+#define FRAME_TIME_HISTOGRAM_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btScalar.h"
+#include <stdio.h>
+
+///FrameTimeHistogram counts durations in microseconds with a log-linear bucket layout, like HdrHistogram.
+///Values below 64 us have a bucket each, above that every power of two is split into 32 linear sub-buckets,
+///so any value is known to about 3% while the whole range up to an hour takes less than 1000 counters.
+///Recording is a few shifts and an increment, and percentiles stay exact at that precision however long
+///it runs, which an average of the frame times is not.
+class FrameTimeHistogram
+{
+	btAlignedObjectArray<unsigned int>	m_counts;
+	unsigned int	m_totalCount;
+	unsigned int	m_minValue;
+	unsigned int	m_maxValue;
+	double			m_sum;
+
+	static int			getBucketIndex(unsigned int value);
+	///the largest value that is counted in the bucket
+	static unsigned int	getBucketValue(int index);
+
+public:
+
+	FrameTimeHistogram();
+
+	void	record(btScalar microseconds);
+	void	reset();
+
+	unsigned int	getTotalCount() const
+	{
+		return m_totalCount;
+	}
+	///microseconds, 0 when nothing was recorded
+	unsigned int	getMinValue() const
+	{
+		return m_totalCount ? m_minValue : 0;
+	}
+	unsigned int	getMaxValue() const
+	{
+		return m_maxValue;
+	}
+	double	getMean() const
+	{
+		return m_totalCount ? m_sum/double(m_totalCount) : 0.;
+	}
+	///the smallest bucket value that percentile percent of the recorded values are not larger than
+	unsigned int	getValueAtPercentile(double percentile) const;
+
+	///percentile table in milliseconds
+	void	print(FILE* file,const char* title) const;
+};
+
+///HitchDetector records the frame and step times of a demo, and writes the profile tree of any frame or
+///step that takes longer than the threshold to a file. stepSimulation resets the profiler when it starts, so
+///right after a step (and until the next one) the tree holds the timings of that step alone.
+class HitchDetector
+{
+	FrameTimeHistogram	m_frameTimes;
+	FrameTimeHistogram	m_stepTimes;
+	btScalar	m_threshold;
+	char		m_dumpFileName[256];
+	int			m_frameIndex;
+	int			m_numHitches;
+	///the profile tree of this frame was written for a slow step already
+	bool		m_stepDumped;
+	bool		m_ignoreNextFrame;
+	btScalar	m_lastStepTime;
+
+	void	dumpHitch(const char* what,btScalar microseconds);
+
+public:
+
+	HitchDetector();
+
+	///frames or steps longer than this many milliseconds are hitches, 0 disables the dumps
+	void	setThreshold(btScalar milliseconds)
+	{
+		m_threshold = milliseconds;
+	}
+	btScalar	getThreshold() const
+	{
+		return m_threshold;
+	}
+	///the hitches are appended to this file, hitches.txt by default
+	void	setDumpFileName(const char* fileName);
+
+	///the time between two frames, at the start of the next frame
+	void	recordFrame(btScalar microseconds);
+	///the duration of one stepSimulation, right after it returned
+	void	recordStep(btScalar microseconds);
+	///the next frame time includes a pause, like the time the demo was idle
+	void	ignoreNextFrame()
+	{
+		m_ignoreNextFrame = true;
+	}
+	void	reset();
+
+	const FrameTimeHistogram&	getFrameTimes() const
+	{
+		return m_frameTimes;
+	}
+	const FrameTimeHistogram&	getStepTimes() const
+	{
+		return m_stepTimes;
+	}
+	int		getNumHitches() const
+	{
+		return m_numHitches;
+	}
+
+	void	printSummary(FILE* file) const;
+};
+
+#endif //FRAME_TIME_HISTOGRAM_H
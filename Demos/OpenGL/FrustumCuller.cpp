@@ -0,0 +1,180 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "FrustumCuller.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+#include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.h"
+#include "BulletCollision/CollisionShapes/btCollisionShape.h"
+#include "LinearMath/btQuickprof.h"
+
+///adds the client objects of the leaves that collideKDOP reports
+struct FrustumCullCallback : public btDbvt::ICollide
+{
+	btHashMap<btHashPtr,int>&	m_visible;
+
+	FrustumCullCallback(btHashMap<btHashPtr,int>& visible)
+		:m_visible(visible)
+	{
+	}
+
+	virtual void	Process(const btDbvtNode* leaf)
+	{
+		const btDbvtProxy* proxy = (const btDbvtProxy*)leaf->data;
+		m_visible.insert(btHashPtr(proxy->m_clientObject),1);
+	}
+};
+
+///intersection point of three planes
+static btVector3	intersectPlanes(const btVector3& n0,btScalar d0,const btVector3& n1,btScalar d1,const btVector3& n2,btScalar d2)
+{
+	const btVector3 n12 = n1.cross(n2);
+	const btScalar denominator = n0.dot(n12);
+	if (btFabs(denominator) < SIMD_EPSILON)
+		return btVector3(0,0,0);
+	return -(n12*d0 + n2.cross(n0)*d1 + n0.cross(n1)*d2) / denominator;
+}
+
+FrustumCuller::FrustumCuller()
+:m_frustumAabbMin(-BT_LARGE_FLOAT,-BT_LARGE_FLOAT,-BT_LARGE_FLOAT),
+m_frustumAabbMax(BT_LARGE_FLOAT,BT_LARGE_FLOAT,BT_LARGE_FLOAT),
+m_margin(btScalar(1.)),
+m_valid(false),
+m_dbvtBroadphase(0)
+{
+}
+
+void	FrustumCuller::setFrustum(const btScalar* projectionMatrix,const btScalar* modelviewMatrix)
+{
+	///clip = projection*modelview, both column major
+	btScalar clip[16];
+	for (int column=0;column<4;column++)
+	{
+		for (int row=0;row<4;row++)
+		{
+			btScalar sum = 0.f;
+			for (int k=0;k<4;k++)
+				sum += projectionMatrix[k*4+row]*modelviewMatrix[column*4+k];
+			clip[column*4+row] = sum;
+		}
+	}
+
+	///planes from the sum and difference of the fourth row and the other rows (Gribb and Hartmann)
+	for (int i=0;i<6;i++)
+	{
+		const int row = i>>1;
+		const btScalar sign = (i&1) ? btScalar(-1.) : btScalar(1.);
+		btVector3 normal(clip[3]+sign*clip[row],clip[7]+sign*clip[4+row],clip[11]+sign*clip[8+row]);
+		btScalar offset = clip[15]+sign*clip[12+row];
+		btScalar length = normal.length();
+		if (length > SIMD_EPSILON)
+		{
+			normal /= length;
+			offset /= length;
+		}
+		m_planeNormals[i] = normal;
+		m_planeOffsets[i] = offset + m_margin;
+	}
+
+	m_frustumAabbMin.setValue(BT_LARGE_FLOAT,BT_LARGE_FLOAT,BT_LARGE_FLOAT);
+	m_frustumAabbMax.setValue(-BT_LARGE_FLOAT,-BT_LARGE_FLOAT,-BT_LARGE_FLOAT);
+	for (int corner=0;corner<8;corner++)
+	{
+		const int x = (corner&1), y = 2+((corner>>1)&1), z = 4+((corner>>2)&1);
+		btVector3 point = intersectPlanes(m_planeNormals[x],m_planeOffsets[x],m_planeNormals[y],m_planeOffsets[y],m_planeNormals[z],m_planeOffsets[z]);
+		m_frustumAabbMin.setMin(point);
+		m_frustumAabbMax.setMax(point);
+	}
+
+	m_valid = true;
+}
+
+void	FrustumCuller::invalidate()
+{
+	m_valid = false;
+	m_visibleObjects.clear();
+	m_visibleShadowCasters.clear();
+	m_frustumAabbMin.setValue(-BT_LARGE_FLOAT,-BT_LARGE_FLOAT,-BT_LARGE_FLOAT);
+	m_frustumAabbMax.setValue(BT_LARGE_FLOAT,BT_LARGE_FLOAT,BT_LARGE_FLOAT);
+}
+
+void	FrustumCuller::cull(btCollisionWorld* world,const btVector3& extrusion,btHashMap<btHashPtr,int>& visible)
+{
+	visible.clear();
+
+	///a volume extruded along the extrusion eventually enters every half space whose normal points along it
+	btVector3	normals[6];
+	btScalar	offsets[6];
+	int numPlanes = 0;
+	for (int i=0;i<6;i++)
+	{
+		if (m_planeNormals[i].dot(extrusion) > btScalar(0.))
+			continue;
+		normals[numPlanes] = m_planeNormals[i];
+		offsets[numPlanes] = m_planeOffsets[i];
+		numPlanes++;
+	}
+
+	if (m_dbvtBroadphase && (btBroadphaseInterface*)m_dbvtBroadphase == world->getBroadphase())
+	{
+		btDbvtBroadphase* dbvt = m_dbvtBroadphase;
+		FrustumCullCallback callback(visible);
+		for (int i=0;i<2;i++)
+		{
+			if (dbvt->m_sets[i].m_root)
+				btDbvt::collideKDOP(dbvt->m_sets[i].m_root,normals,offsets,numPlanes,callback);
+		}
+		return;
+	}
+
+	for (int i=0;i<world->getNumCollisionObjects();i++)
+	{
+		btCollisionObject* colObj = world->getCollisionObjectArray()[i];
+		btBroadphaseProxy* proxy = colObj->getBroadphaseHandle();
+		btVector3 aabbMin,aabbMax;
+		if (proxy)
+		{
+			aabbMin = proxy->m_aabbMin;
+			aabbMax = proxy->m_aabbMax;
+		} else
+		{
+			colObj->getCollisionShape()->getAabb(colObj->getWorldTransform(),aabbMin,aabbMax);
+		}
+
+		bool inside = true;
+		for (int j=0;j<numPlanes && inside;j++)
+		{
+			///the corner furthest along the plane normal
+			btVector3 corner(normals[j].getX()>=0.f ? aabbMax.getX() : aabbMin.getX(),
+				normals[j].getY()>=0.f ? aabbMax.getY() : aabbMin.getY(),
+				normals[j].getZ()>=0.f ? aabbMax.getZ() : aabbMin.getZ());
+			inside = normals[j].dot(corner)+offsets[j] >= btScalar(0.);
+		}
+		if (inside)
+			visible.insert(btHashPtr(colObj),1);
+	}
+}
+
+void	FrustumCuller::cullObjects(btCollisionWorld* world,const btVector3* shadowExtrusion)
+{
+	BT_PROFILE("cullObjects");
+	if (!m_valid)
+		return;
+
+	cull(world,btVector3(0,0,0),m_visibleObjects);
+	if (shadowExtrusion)
+		cull(world,*shadowExtrusion,m_visibleShadowCasters);
+	else
+		m_visibleShadowCasters.clear();
+}
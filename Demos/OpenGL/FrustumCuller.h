@@ -0,0 +1,123 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef FRUSTUM_CULLER_H
+#define FRUSTUM_CULLER_H
+
+#include "LinearMath/btVector3.h"
+#include "LinearMath/btHashMap.h"
+
+class btCollisionObject;
+class btCollisionWorld;
+class btDbvtBroadphase;
+
+///FrustumCuller finds the collision objects whose broadphase AABB touches the view frustum.
+///When the world uses the btDbvtBroadphase given to setDbvtBroadphase, its dynamic and static trees are walked
+///with btDbvt::collideKDOP, so whole subtrees outside of the frustum are rejected at once. Other broadphases
+///fall back to a test per object.
+///Shadow casters are culled separately: a shadow volume is extruded along the light direction, so the
+///planes it can cross from the outside are left out of that test.
+class FrustumCuller
+{
+	///left, right, bottom, top, near, far. A point p is inside when dot(normal,p)+offset >= 0
+	btVector3	m_planeNormals[6];
+	btScalar	m_planeOffsets[6];
+	btVector3	m_frustumAabbMin;
+	btVector3	m_frustumAabbMax;
+	btScalar	m_margin;
+	bool		m_valid;
+	btDbvtBroadphase*	m_dbvtBroadphase;
+
+	btHashMap<btHashPtr,int>	m_visibleObjects;
+	btHashMap<btHashPtr,int>	m_visibleShadowCasters;
+
+	void	cull(btCollisionWorld* world,const btVector3& extrusion,btHashMap<btHashPtr,int>& visible);
+
+public:
+
+	FrustumCuller();
+
+	///set the frustum from OpenGL style (column major) projection and modelview matrices
+	void	setFrustum(const btScalar* projectionMatrix,const btScalar* modelviewMatrix);
+
+	///cull the objects of the world. When shadowExtrusion is not 0, the shadow casters are culled too,
+	///shadowExtrusion is the world space direction in which the shadow volumes are extruded.
+	void	cullObjects(btCollisionWorld* world,const btVector3* shadowExtrusion);
+
+	///the broadphase of the culled world, if it is a btDbvtBroadphase. Reset it before the broadphase is deleted.
+	void	setDbvtBroadphase(btDbvtBroadphase* broadphase)
+	{
+		m_dbvtBroadphase = broadphase;
+	}
+	btDbvtBroadphase*	getDbvtBroadphase()
+	{
+		return m_dbvtBroadphase;
+	}
+
+	///until the next setFrustum, every object counts as visible
+	void	invalidate();
+
+	bool	isValid() const
+	{
+		return m_valid;
+	}
+
+	bool	isVisible(const btCollisionObject* obj) const
+	{
+		return !m_valid || m_visibleObjects.find(btHashPtr(obj))!=0;
+	}
+	bool	isShadowCasterVisible(const btCollisionObject* obj) const
+	{
+		return !m_valid || m_visibleShadowCasters.find(btHashPtr(obj))!=0;
+	}
+
+	int		getNumVisibleObjects() const
+	{
+		return m_visibleObjects.size();
+	}
+	int		getNumVisibleShadowCasters() const
+	{
+		return m_visibleShadowCasters.size();
+	}
+
+	///the six planes of setFrustum (left, right, bottom, top, near, far), including the margin
+	const btVector3*	getPlaneNormals() const
+	{
+		return m_planeNormals;
+	}
+	const btScalar*	getPlaneOffsets() const
+	{
+		return m_planeOffsets;
+	}
+
+	///world space AABB of the frustum corners
+	void	getFrustumAabb(btVector3& aabbMin,btVector3& aabbMax) const
+	{
+		aabbMin = m_frustumAabbMin;
+		aabbMax = m_frustumAabbMax;
+	}
+
+	///the planes are moved outwards by this distance, the rendered (interpolated) transform of a body can
+	///lag behind its broadphase AABB by up to one simulation step
+	void	setMargin(btScalar margin)
+	{
+		m_margin = margin;
+	}
+	btScalar	getMargin() const
+	{
+		return m_margin;
+	}
+};
+
+#endif //FRUSTUM_CULLER_H
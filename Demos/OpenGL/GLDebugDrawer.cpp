@@ -2,12 +2,16 @@
 #include "GLDebugDrawer.h"
 #include "GLDebugFont.h"
 #include "GlutStuff.h"
+#include "GL_UnitShapes.h"
 
 
 
 #include <stdio.h> //printf debugging
 GLDebugDrawer::GLDebugDrawer()
-:m_debugMode(0)
+:m_debugMode(0),
+m_batching(true),
+m_numFlushedLines(0),
+m_numFlushedTriangles(0)
 {
 
 }
@@ -16,8 +20,38 @@ GLDebugDrawer::~GLDebugDrawer()
 {
 }
 
+void	GLDebugDrawer::addLineVertex(const btVector3& v,const btVector3& color)
+{
+	m_lines.push_back(float(color.getX()));
+	m_lines.push_back(float(color.getY()));
+	m_lines.push_back(float(color.getZ()));
+	m_lines.push_back(float(v.getX()));
+	m_lines.push_back(float(v.getY()));
+	m_lines.push_back(float(v.getZ()));
+}
+
+void	GLDebugDrawer::addTriangleVertex(const btVector3& v,const btVector3& n,const btVector3& color,btScalar alpha)
+{
+	m_triangles.push_back(float(color.getX()));
+	m_triangles.push_back(float(color.getY()));
+	m_triangles.push_back(float(color.getZ()));
+	m_triangles.push_back(float(alpha));
+	m_triangles.push_back(float(n.getX()));
+	m_triangles.push_back(float(n.getY()));
+	m_triangles.push_back(float(n.getZ()));
+	m_triangles.push_back(float(v.getX()));
+	m_triangles.push_back(float(v.getY()));
+	m_triangles.push_back(float(v.getZ()));
+}
+
 void	GLDebugDrawer::drawLine(const btVector3& from,const btVector3& to,const btVector3& fromColor, const btVector3& toColor)
 {
+	if (m_batching)
+	{
+		addLineVertex(from,fromColor);
+		addLineVertex(to,toColor);
+		return;
+	}
 	glBegin(GL_LINES);
 		glColor3f(fromColor.getX(), fromColor.getY(), fromColor.getZ());
 		glVertex3d(from.getX(), from.getY(), from.getZ());
@@ -33,36 +67,24 @@ void	GLDebugDrawer::drawLine(const btVector3& from,const btVector3& to,const btV
 
 void GLDebugDrawer::drawSphere (const btVector3& p, btScalar radius, const btVector3& color)
 {
+	if (m_batching)
+	{
+		m_spheres.push_back(float(p.getX()));
+		m_spheres.push_back(float(p.getY()));
+		m_spheres.push_back(float(p.getZ()));
+		m_spheres.push_back(float(radius));
+		m_spheres.push_back(float(color.getX()));
+		m_spheres.push_back(float(color.getY()));
+		m_spheres.push_back(float(color.getZ()));
+		return;
+	}
 	glColor4f (color.getX(), color.getY(), color.getZ(), btScalar(1.0f));
 	glPushMatrix ();
 	glTranslatef (p.getX(), p.getY(), p.getZ());
+	glScalef (radius, radius, radius);
 
-	int lats = 5;
-	int longs = 5;
-
-	int i, j;
-	for(i = 0; i <= lats; i++) {
-		btScalar lat0 = SIMD_PI * (-btScalar(0.5) + (btScalar) (i - 1) / lats);
-		btScalar z0  = radius*sin(lat0);
-		btScalar zr0 =  radius*cos(lat0);
-
-		btScalar lat1 = SIMD_PI * (-btScalar(0.5) + (btScalar) i / lats);
-		btScalar z1 = radius*sin(lat1);
-		btScalar zr1 = radius*cos(lat1);
-
-		glBegin(GL_QUAD_STRIP);
-		for(j = 0; j <= longs; j++) {
-			btScalar lng = 2 * SIMD_PI * (btScalar) (j - 1) / longs;
-			btScalar x = cos(lng);
-			btScalar y = sin(lng);
-
-			glNormal3f(x * zr0, y * zr0, z0);
-			glVertex3f(x * zr0, y * zr0, z0);
-			glNormal3f(x * zr1, y * zr1, z1);
-			glVertex3f(x * zr1, y * zr1, z1);
-		}
-		glEnd();
-	}
+	//coarsest level without a view, like the 5x5 sphere that was drawn here before
+	GL_UnitShapes::drawSphere(GL_UnitShapes::selectLod(p,radius,0));
 
 	glPopMatrix();
 }
@@ -74,6 +96,13 @@ void	GLDebugDrawer::drawTriangle(const btVector3& a,const btVector3& b,const btV
 //	if (m_debugMode > 0)
 	{
 		const btVector3	n=btCross(b-a,c-a).normalized();
+		if (m_batching)
+		{
+			addTriangleVertex(a,n,color,alpha);
+			addTriangleVertex(b,n,color,alpha);
+			addTriangleVertex(c,n,color,alpha);
+			return;
+		}
 		glBegin(GL_TRIANGLES);		
 		glColor4f(color.getX(), color.getY(), color.getZ(),alpha);
 		glNormal3d(n.getX(),n.getY(),n.getZ());
@@ -107,6 +136,12 @@ void	GLDebugDrawer::drawContactPoint(const btVector3& pointOnB,const btVector3&
 	{
 		btVector3 to=pointOnB+normalOnB*1;//distance;
 		const btVector3&from = pointOnB;
+		if (m_batching)
+		{
+			addLineVertex(from,color);
+			addLineVertex(to,color);
+			return;
+		}
 		glColor4f(color.getX(), color.getY(), color.getZ(),1.f);
 		//glColor4f(0,0,0,1.f);
 		glBegin(GL_LINES);
@@ -124,7 +159,53 @@ void	GLDebugDrawer::drawContactPoint(const btVector3& pointOnB,const btVector3&
 	}
 }
 
+void	GLDebugDrawer::flush()
+{
+	m_numFlushedLines = m_lines.size()/12;
+	m_numFlushedTriangles = m_triangles.size()/30;
+	if (!m_lines.size() && !m_triangles.size() && !m_spheres.size())
+		return;
 
+	glPushAttrib(GL_ENABLE_BIT|GL_CURRENT_BIT);
+	glDisable(GL_TEXTURE_2D);
 
+	if (m_triangles.size())
+	{
+		glInterleavedArrays(GL_C4F_N3F_V3F,0,&m_triangles[0]);
+		glDrawArrays(GL_TRIANGLES,0,m_triangles.size()/10);
+		glDisableClientState(GL_COLOR_ARRAY);
+		glDisableClientState(GL_NORMAL_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+	}
 
+	for (int i=0;i<m_spheres.size();i+=7)
+	{
+		const float* sphere = &m_spheres[i];
+		glColor4f(sphere[4],sphere[5],sphere[6],1.f);
+		glPushMatrix();
+		glTranslatef(sphere[0],sphere[1],sphere[2]);
+		glScalef(sphere[3],sphere[3],sphere[3]);
+		GL_UnitShapes::drawSphere(GL_UnitShapes::selectLod(btVector3(sphere[0],sphere[1],sphere[2]),sphere[3],0));
+		glPopMatrix();
+	}
 
+	if (m_lines.size())
+	{
+		glDisable(GL_LIGHTING);
+		glInterleavedArrays(GL_C3F_V3F,0,&m_lines[0]);
+		glDrawArrays(GL_LINES,0,m_lines.size()/6);
+		glDisableClientState(GL_COLOR_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+	}
+
+	glPopAttrib();
+	clear();
+}
+
+void	GLDebugDrawer::clear()
+{
+	//resize keeps the capacity, so the arrays stop growing after the first frames
+	m_lines.resize(0);
+	m_triangles.resize(0);
+	m_spheres.resize(0);
+}
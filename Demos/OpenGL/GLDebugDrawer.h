@@ -2,12 +2,29 @@
 #define GL_DEBUG_DRAWER_H
 
 #include "LinearMath/btIDebugDraw.h"
+#include "LinearMath/btAlignedObjectArray.h"
 
 
 
+///GLDebugDrawer collects the lines, triangles and spheres of a frame and draws them in flush, with one
+///glDrawArrays per primitive type. setBatching(false) draws every primitive right away in immediate mode.
 class GLDebugDrawer : public btIDebugDraw
 {
 	int m_debugMode;
+	bool m_batching;
+
+	///interleaved color and position (GL_C3F_V3F), two vertices per line
+	btAlignedObjectArray<float>	m_lines;
+	///interleaved color, normal and position (GL_C4F_N3F_V3F), three vertices per triangle
+	btAlignedObjectArray<float>	m_triangles;
+	///center, radius and color of each sphere
+	btAlignedObjectArray<float>	m_spheres;
+
+	int m_numFlushedLines;
+	int m_numFlushedTriangles;
+
+	void	addLineVertex(const btVector3& v,const btVector3& color);
+	void	addTriangleVertex(const btVector3& v,const btVector3& n,const btVector3& color,btScalar alpha);
 
 public:
 
@@ -32,6 +49,28 @@ public:
 
 	virtual int		getDebugMode() const { return m_debugMode;}
 
+	///draw the primitives collected since the last flush, once per frame with the camera matrices set
+	void	flush();
+	///forget the collected primitives without drawing them
+	void	clear();
+
+	bool	setBatching(bool batching) { bool p=m_batching;flush();m_batching=batching;return(p); }
+	bool	isBatching() const
+	{
+		return m_batching;
+	}
+
+	///primitives drawn by the last flush
+	int		getNumFlushedLines() const
+	{
+		return m_numFlushedLines;
+	}
+	int		getNumFlushedTriangles() const
+	{
+		return m_numFlushedTriangles;
+	}
+
 };
 
 #endif//GL_DEBUG_DRAWER_H
+
@@ -14,6 +14,8 @@ subject to the following restrictions:
 */
 
 #include "GLDebugFont.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btHashMap.h"
 
 
 #ifdef _WIN32//for glut.h
@@ -79,146 +81,245 @@ void GLDebugResetFont(int screenWidth,int screenHeight)
 
 }
 
-#define USE_ARRAYS 1
+///one vertex of a glyph quad, laid out as GL_T2F_C4UB_V3F
+struct GlyphVertex
+{
+	float			m_u;
+	float			m_v;
+	unsigned char	m_color[4];
+	float			m_x;
+	float			m_y;
+	float			m_z;
+};
 
-void	GLDebugDrawStringInternal(int x,int y,const char* string, const btVector3& rgb)
+///glyph quads of a string relative to its origin, reused while the same text is drawn again
+struct LaidOutString
 {
-	GLDebugDrawStringInternal(x,y,string,rgb,true,10);
+	btAlignedObjectArray<char>	m_text;
+	int							m_spacing;
+	unsigned int				m_hash;
+	LaidOutString*				m_lruprev;
+	LaidOutString*				m_lrunext;
+	///texture coordinate and position (u,v,x,y) of each quad corner
+	btAlignedObjectArray<float>	m_corners;
+};
+
+///once this many different strings are cached, the least recently drawn one is laid out again when it returns
+static const int	sMaxCachedStrings = 512;
+
+static btHashMap<btHashInt,LaidOutString*>	sStringCache;
+//most recently drawn first
+static LaidOutString*						sStringHead = 0;
+static LaidOutString*						sStringTail = 0;
+static btAlignedObjectArray<GlyphVertex>	sBlendedGlyphs;
+static btAlignedObjectArray<GlyphVertex>	sOpaqueGlyphs;
+
+static void	unlinkString(LaidOutString* laidOut)
+{
+	if (laidOut->m_lruprev) laidOut->m_lruprev->m_lrunext = laidOut->m_lrunext;
+	else sStringHead = laidOut->m_lrunext;
+	if (laidOut->m_lrunext) laidOut->m_lrunext->m_lruprev = laidOut->m_lruprev;
+	else sStringTail = laidOut->m_lruprev;
 }
 
-void	GLDebugDrawStringInternal(int x,int y,const char* string, const btVector3& rgb, bool enableBlend, int spacing)
+static void	linkStringFirst(LaidOutString* laidOut)
 {
+	laidOut->m_lruprev = 0;
+	laidOut->m_lrunext = sStringHead;
+	if (sStringHead) sStringHead->m_lruprev = laidOut;
+	else sStringTail = laidOut;
+	sStringHead = laidOut;
+}
 
-	if (!sTexturesInitialized)
+static void	removeString(LaidOutString* laidOut)
+{
+	unlinkString(laidOut);
+	sStringCache.remove(btHashInt(int(laidOut->m_hash)));
+	delete laidOut;
+}
+
+///FNV-1a of the text and the spacing
+static unsigned int	hashString(const char* string,int length,int spacing)
+{
+	unsigned int hash = 2166136261u^(unsigned int)spacing;
+	for (int i=0;i<length;i++)
 	{
-		GLDebugResetFont(sScreenWidth,sScreenHeight);
+		hash = (hash^(unsigned char)string[i])*16777619u;
 	}
-	if (strlen(string))
+	return hash;
+}
+
+static const LaidOutString*	layoutString(const char* string,int length,int spacing)
+{
+	const unsigned int hash = hashString(string,length,spacing);
+	LaidOutString** found = sStringCache.find(btHashInt(int(hash)));
+	if (found)
 	{
-		
-		glColor4f(rgb.getX(),rgb.getY(),rgb.getZ(),1.f);
-		float	cx;
-		float	cy;
-
-		glMatrixMode(GL_TEXTURE);
-		glLoadIdentity();
-
-		glDisable(GL_TEXTURE_GEN_S);
-		glDisable(GL_TEXTURE_GEN_T);
-		glDisable(GL_TEXTURE_GEN_R);
-
-		glEnable(GL_TEXTURE_2D);
-		glBlendFunc(GL_SRC_ALPHA,GL_ONE);
-		glDepthFunc (GL_LEQUAL);
-		
-		if (enableBlend)
-		{
-			glEnable(GL_BLEND);
-		} else
+		LaidOutString* laidOut = *found;
+		if (laidOut->m_spacing==spacing && laidOut->m_text.size()==length && memcmp(&laidOut->m_text[0],string,length)==0)
 		{
-			glDisable(GL_BLEND);
+			if (laidOut!=sStringHead)
+			{
+				unlinkString(laidOut);
+				linkStringFirst(laidOut);
+			}
+			return laidOut;
 		}
-		glEnable (GL_DEPTH_TEST);
-		glBindTexture(GL_TEXTURE_2D, sTexture);
-		glDisable(GL_DEPTH_TEST);
-		glMatrixMode(GL_PROJECTION);
-		glPushMatrix();
-		glLoadIdentity();
-
-		glOrtho(0,sScreenWidth,0,sScreenHeight,-1,1);
-
-		glMatrixMode(GL_MODELVIEW);
-		glPushMatrix();
-		glLoadIdentity();
-		glTranslatef(btScalar(x),btScalar(sScreenHeight - y),btScalar(0));
-
-#if USE_ARRAYS
-		
-		glDisableClientState(GL_COLOR_ARRAY);
-		glDisableClientState(GL_NORMAL_ARRAY);
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState (GL_TEXTURE_COORD_ARRAY);
-#endif
+		//hash collision, the newer string takes the slot
+		removeString(laidOut);
+	}
+	while (sStringCache.size()>=sMaxCachedStrings && sStringTail)
+		removeString(sStringTail);
 
-		GLfloat verts[] ={
-			0.0f, 1.0f, 0.0f,
-			-1.0f, -1.0f, 0.0f,
-			1.0f, -1.0f, 0.0f,
-			0.f,0.f,0.f
-		};
-		
-		GLfloat uv_texcoords[] = {
-			0,0,
-			0,0,
-			0,0,
-			0,0
-		};
-		verts[0] = 0;		verts[1] = 0;		verts[2] = 0;
-		verts[3] = 16-1;	verts[4] = 0;		verts[5] = 0;
-		verts[6] = 16-1;	verts[7] = 16-1;	verts[8] = 0;
-		verts[9] = 0;		verts[10] = 16-1;	verts[11] = 0;
-		
-		for (int i=0;i<int (strlen(string));i++)
-		{
-			char ch = string[i]-32;
-			if (ch>=0)
-			{
-				cx=float(ch%16) * btScalar(1./16.f);
-				cy=float(ch/16) * btScalar(1./16.f);
-
-				uv_texcoords[0] = cx;			uv_texcoords[1] = btScalar(1-cy-1./16.f);
-				uv_texcoords[2] = btScalar(cx+1./16.f);	uv_texcoords[3] = btScalar(1-cy-1./16.f);
-				uv_texcoords[4] = btScalar(cx+1./16.f);	uv_texcoords[5] = btScalar(1-cy);
-				uv_texcoords[6] = cx;			uv_texcoords[7] = btScalar(1-cy);
-#if USE_ARRAYS
-				glTexCoordPointer(2,GL_FLOAT,0,uv_texcoords);
-				glVertexPointer(3, GL_FLOAT, 0, verts);
-				glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-#else
-				glBegin(GL_QUADS);
-				glTexCoord2f(cx,1-cy-1./16.f);
+	LaidOutString* laidOut = new LaidOutString;
+	laidOut->m_spacing = spacing;
+	laidOut->m_hash = hash;
+	laidOut->m_text.resize(length);
+	memcpy(&laidOut->m_text[0],string,length);
 
-				glVertex2i(0,0);
-				glTexCoord2f(cx+1./16.f,1-cy-1./16.f);
+	///the glyph cell is 16x16 texels of the 256x256 font texture, drawn as a 15x15 pixel quad
+	static const float cornerX[4] = {0.f,15.f,15.f,0.f};
+	static const float cornerY[4] = {0.f,0.f,15.f,15.f};
+	float pen = 0.f;
+	for (int i=0;i<length;i++)
+	{
+		const int ch = int((unsigned char)string[i])-32;
+		if (ch<0)
+			continue;
+		const float cx = float(ch%16)*(1.f/16.f);
+		const float cy = float(ch/16)*(1.f/16.f);
+		const float u[4] = {cx,cx+1.f/16.f,cx+1.f/16.f,cx};
+		const float v[4] = {1.f-cy-1.f/16.f,1.f-cy-1.f/16.f,1.f-cy,1.f-cy};
+		for (int c=0;c<4;c++)
+		{
+			laidOut->m_corners.push_back(u[c]);
+			laidOut->m_corners.push_back(v[c]);
+			laidOut->m_corners.push_back(pen+cornerX[c]);
+			laidOut->m_corners.push_back(cornerY[c]);
+		}
+		pen += float(spacing);
+	}
+	sStringCache.insert(btHashInt(int(hash)),laidOut);
+	linkStringFirst(laidOut);
+	return laidOut;
+}
 
-				glVertex2i(16 - 1,0);
-				glTexCoord2f(cx+1./16.f,1-cy);
+void	GLDebugDrawStringInternal(int x,int y,const char* string, const btVector3& rgb)
+{
+	GLDebugDrawStringInternal(x,y,string,rgb,true,10);
+}
 
-				glVertex2i(16 - 1,16 -1);
-				glTexCoord2f(cx,1-cy);
+///the glyph quads are only collected here, GLDebugFlushStrings draws them
+void	GLDebugDrawStringInternal(int x,int y,const char* string, const btVector3& rgb, bool enableBlend, int spacing)
+{
+	const int length = int(strlen(string));
+	if (!length)
+		return;
 
-				glVertex2i(0,16 -1);
-				glEnd();
-#endif			
+	const LaidOutString* laidOut = layoutString(string,length,spacing);
+	btAlignedObjectArray<GlyphVertex>& glyphs = enableBlend ? sBlendedGlyphs : sOpaqueGlyphs;
+	unsigned char color[4];
+	for (int i=0;i<3;i++)
+	{
+		color[i] = (unsigned char)(btMax(btScalar(0.),btMin(btScalar(1.),rgb[i]))*btScalar(255.)+btScalar(0.5));
+	}
+	color[3] = 255;
 
-				glTranslatef(spacing,0,0);
-			}
-		}
+	const float originX = float(x);
+	const float originY = float(sScreenHeight-y);
+	const int numCorners = laidOut->m_corners.size()/4;
+	const int first = glyphs.size();
+	glyphs.resize(first+numCorners);
+	for (int i=0;i<numCorners;i++)
+	{
+		const float* corner = &laidOut->m_corners[i*4];
+		GlyphVertex& vertex = glyphs[first+i];
+		vertex.m_u = corner[0];
+		vertex.m_v = corner[1];
+		memcpy(vertex.m_color,color,sizeof(color));
+		vertex.m_x = originX+corner[2];
+		vertex.m_y = originY+corner[3];
+		vertex.m_z = 0.f;
+	}
+}
 
-		glMatrixMode(GL_PROJECTION);
-		glPopMatrix();
-		glMatrixMode(GL_MODELVIEW);
-		glPopMatrix();
-#if 1
-		glEnable(GL_DEPTH_TEST);
-		glBlendFunc(GL_SRC_ALPHA,GL_ONE);
-		glDepthFunc (GL_LEQUAL);
+static void	drawGlyphs(btAlignedObjectArray<GlyphVertex>& glyphs,bool enableBlend)
+{
+	if (!glyphs.size())
+		return;
+	if (enableBlend)
+	{
+		glEnable(GL_BLEND);
+	} else
+	{
 		glDisable(GL_BLEND);
-		glDisable(GL_TEXTURE_2D);
+	}
+	glInterleavedArrays(GL_T2F_C4UB_V3F,0,&glyphs[0]);
+	glDrawArrays(GL_QUADS,0,glyphs.size());
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	//resize keeps the capacity for the next frame
+	glyphs.resize(0);
+}
 
-		glMatrixMode(GL_TEXTURE);
-		glLoadIdentity();
-		glScalef(btScalar(0.025),btScalar(0.025),btScalar(0.025));
-#endif
-		glMatrixMode(GL_MODELVIEW);
-#if USE_ARRAYS
-		glDisableClientState(GL_VERTEX_ARRAY);
-		glDisableClientState (GL_TEXTURE_COORD_ARRAY);
-#endif
-		//glDisable(GL_TEXTURE_2D);
+void	GLDebugFlushStrings()
+{
+	if (!sBlendedGlyphs.size() && !sOpaqueGlyphs.size())
+		return;
+
+	//the glyph colors are per vertex, so lighting is off while they are drawn
+	const GLboolean lighting = glIsEnabled(GL_LIGHTING);
+	glMatrixMode(GL_TEXTURE);
+	glLoadIdentity();
+
+	glDisable(GL_TEXTURE_GEN_S);
+	glDisable(GL_TEXTURE_GEN_T);
+	glDisable(GL_TEXTURE_GEN_R);
+	glDisable(GL_LIGHTING);
+
+	glEnable(GL_TEXTURE_2D);
+	glBlendFunc(GL_SRC_ALPHA,GL_ONE);
+	glBindTexture(GL_TEXTURE_2D, sTexture);
+	glDisable(GL_DEPTH_TEST);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+
+	glOrtho(0,sScreenWidth,0,sScreenHeight,-1,1);
+
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	drawGlyphs(sBlendedGlyphs,true);
+	drawGlyphs(sOpaqueGlyphs,false);
+
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc (GL_LEQUAL);
+	glDisable(GL_BLEND);
+	glDisable(GL_TEXTURE_2D);
+
+	glMatrixMode(GL_TEXTURE);
+	glLoadIdentity();
+	glScalef(btScalar(0.025),btScalar(0.025),btScalar(0.025));
+	glMatrixMode(GL_MODELVIEW);
+	if (lighting)
+	{
+		glEnable(GL_LIGHTING);
 	}
 }
 
+int		GLDebugGetNumCachedStrings()
+{
+	return sStringCache.size();
+}
+
 void	GLDebugDrawString(int x,int y,const char* string)
 {
 
@@ -25,5 +25,11 @@ void	GLDebugDrawStringInternal(int x,int y,const char* string,const btVector3& r
 void	GLDebugDrawString(int x,int y,const char* string);
 void	GLDebugResetFont(int screenWidth,int screenHeight);
 
+///the GLDebugDrawString functions only queue the glyph quads of a string. GLDebugFlushStrings draws all of
+///them with one glDrawArrays, it is called before the buffers are swapped.
+void	GLDebugFlushStrings();
+///strings are laid out once and reused while the same text is drawn again
+int		GLDebugGetNumCachedStrings();
+
 #endif //BT_DEBUG_FONT_H
 
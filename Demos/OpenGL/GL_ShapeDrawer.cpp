@@ -22,6 +22,7 @@ subject to the following restrictions:
 
 #include "GlutStuff.h"
 #include "GL_ShapeDrawer.h"
+#include "GL_UnitShapes.h"
 #include "BulletCollision/CollisionShapes/btPolyhedralConvexShape.h"
 #include "BulletCollision/CollisionShapes/btTriangleMeshShape.h"
 #include "BulletCollision/CollisionShapes/btBoxShape.h"
@@ -41,6 +42,7 @@ subject to the following restrictions:
 #include "BulletCollision/CollisionShapes/btShapeHull.h"
 
 #include "LinearMath/btTransformUtil.h"
+#include "LinearMath/btAabbUtil2.h"
 
 
 #include "LinearMath/btIDebugDraw.h"
@@ -48,138 +50,20 @@ subject to the following restrictions:
 
 #include <stdio.h> //printf debugging
 
-//#define USE_DISPLAY_LISTS 1
-#ifdef USE_DISPLAY_LISTS
+///triangles per chunk of a retained concave mesh, the grid is sized for about this many
+static const int	sConcaveChunkTriangles=1024;
+///cells of the chunk grid along one axis at most
+static const int	sConcaveChunkCells=64;
 
-#include <map>
-
-using namespace std;
-
-//Set for storing Display list per trimesh
-struct TRIMESH_KEY
-{
-	btCollisionShape* m_shape;
-	GLuint m_dlist;//OpenGL display list	
-};
-
-typedef map<unsigned long,TRIMESH_KEY> TRIMESH_KEY_MAP;
-
-typedef pair<unsigned long,TRIMESH_KEY> TRIMESH_KEY_PAIR;
-
-TRIMESH_KEY_MAP g_display_lists;
-
-class GlDisplaylistDrawcallback : public btTriangleCallback
-{
-public:
-
-	virtual void processTriangle(btVector3* triangle,int partId, int triangleIndex)
-	{
-
-		btVector3 diff1 = triangle[1] - triangle[0];
-		btVector3 diff2 = triangle[2] - triangle[0];
-		btVector3 normal = diff1.cross(diff2);
-
-		normal.normalize();
-
-		glBegin(GL_TRIANGLES);
-		glColor3f(1, 1, 1);
-		glNormal3d(normal.getX(),normal.getY(),normal.getZ());
-		glVertex3d(triangle[0].getX(), triangle[0].getY(), triangle[0].getZ());
-
-		//glColor3f(0, 1, 0);
-		glNormal3d(normal.getX(),normal.getY(),normal.getZ());
-		glVertex3d(triangle[1].getX(), triangle[1].getY(), triangle[1].getZ());
-
-		//glColor3f(0, 1, 0);
-		glNormal3d(normal.getX(),normal.getY(),normal.getZ());
-		glVertex3d(triangle[2].getX(), triangle[2].getY(), triangle[2].getZ());
-		glEnd();
-
-		/*glBegin(GL_LINES);
-		glColor3f(1, 1, 0);
-		glNormal3d(normal.getX(),normal.getY(),normal.getZ());
-		glVertex3d(triangle[0].getX(), triangle[0].getY(), triangle[0].getZ());
-		glNormal3d(normal.getX(),normal.getY(),normal.getZ());
-		glVertex3d(triangle[1].getX(), triangle[1].getY(), triangle[1].getZ());
-		glColor3f(1, 1, 0);
-		glNormal3d(normal.getX(),normal.getY(),normal.getZ());
-		glVertex3d(triangle[2].getX(), triangle[2].getY(), triangle[2].getZ());
-		glNormal3d(normal.getX(),normal.getY(),normal.getZ());
-		glVertex3d(triangle[1].getX(), triangle[1].getY(), triangle[1].getZ());
-		glColor3f(1, 1, 0);
-		glNormal3d(normal.getX(),normal.getY(),normal.getZ());
-		glVertex3d(triangle[2].getX(), triangle[2].getY(), triangle[2].getZ());
-		glNormal3d(normal.getX(),normal.getY(),normal.getZ());
-		glVertex3d(triangle[0].getX(), triangle[0].getY(), triangle[0].getZ());
-		glEnd();*/
-
-
-	}
-};
-
-GLuint  OGL_get_displaylist_for_shape(btCollisionShape * shape)
+void OGL_displaylist_register_shape(btCollisionShape * shape)
 {
-	TRIMESH_KEY_MAP::iterator map_iter;
-
-	unsigned long key = (unsigned long)shape;
-	map_iter = g_display_lists.find(key);
-	if(map_iter!=g_display_lists.end())
-	{
-		return map_iter->second.m_dlist;
-	}
-
-	return 0;
+	(void)shape;
 }
 
 void OGL_displaylist_clean()
 {
-	TRIMESH_KEY_MAP::iterator map_iter,map_itend;
-
-	map_iter = g_display_lists.begin();
-
-	while(map_iter!=map_itend)
-	{
-		glDeleteLists(map_iter->second.m_dlist,1);		
-		map_iter++;
-	}
-
-	g_display_lists.clear();
 }
 
-
-void OGL_displaylist_register_shape(btCollisionShape * shape)
-{
-	btVector3 aabbMax(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
-	btVector3 aabbMin(-btScalar(BT_LARGE_FLOAT),-btScalar(BT_LARGE_FLOAT),-btScalar(BT_LARGE_FLOAT));
-	GlDisplaylistDrawcallback drawCallback;
-	TRIMESH_KEY dlist;
-
-	dlist.m_dlist = glGenLists(1);
-	dlist.m_shape = shape;
-
-	unsigned long key = (unsigned long)shape;
-
-	g_display_lists.insert(TRIMESH_KEY_PAIR(key,dlist));
-
-	glNewList(dlist.m_dlist,GL_COMPILE);
-
-//	glEnable(GL_CULL_FACE);
-
-	glCullFace(GL_BACK);
-
-	if (shape->isConcave())
-	{
-		btConcaveShape* concaveMesh = (btConcaveShape*) shape;			
-		//todo pass camera, for some culling		
-		concaveMesh->processAllTriangles(&drawCallback,aabbMin,aabbMax);
-	}
-
-//	glDisable(GL_CULL_FACE);	
-
-	glEndList();
-}
-#endif //USE_DISPLAY_LISTS
-
 void GL_ShapeDrawer::drawCoordSystem()  {
 	glBegin(GL_LINES);
 	glColor3f(1, 0, 0);
@@ -275,48 +159,29 @@ public:
 
 void GL_ShapeDrawer::drawSphere(btScalar radius, int lats, int longs) 
 {
-	int i, j;
-	for(i = 0; i <= lats; i++) {
-		btScalar lat0 = SIMD_PI * (-btScalar(0.5) + (btScalar) (i - 1) / lats);
-		btScalar z0  = radius*sin(lat0);
-		btScalar zr0 =  radius*cos(lat0);
-
-		btScalar lat1 = SIMD_PI * (-btScalar(0.5) + (btScalar) i / lats);
-		btScalar z1 = radius*sin(lat1);
-		btScalar zr1 = radius*cos(lat1);
-
-		glBegin(GL_QUAD_STRIP);
-		for(j = 0; j <= longs; j++) {
-			btScalar lng = 2 * SIMD_PI * (btScalar) (j - 1) / longs;
-			btScalar x = cos(lng);
-			btScalar y = sin(lng);
-			glNormal3f(x * zr1, y * zr1, z1);
-			glVertex3f(x * zr1, y * zr1, z1);
-			glNormal3f(x * zr0, y * zr0, z0);
-			glVertex3f(x * zr0, y * zr0, z0);
-		}
-		glEnd();
-	}
+	(void)longs;
+	///the level of detail follows the projected size of the object being drawn, lats is used without a view
+	const int	lod=GL_UnitShapes::selectLod(m_lodorigin,radius,GL_UnitShapes::getSphereLod(lats));
+	glPushMatrix();
+	glScalef(radius,radius,radius);
+	GL_UnitShapes::drawSphere(lod);
+	glPopMatrix();
 }
 
 void GL_ShapeDrawer::drawCylinder(float radius,float halfHeight, int upAxis)
 {
-
+	const int	lod=GL_UnitShapes::selectLod(m_lodorigin,btSqrt(radius*radius+halfHeight*halfHeight),2);
 
 	glPushMatrix();
 	switch (upAxis)
 	{
 	case 0:
 		glRotatef(-90.0, 0.0, 1.0, 0.0);
-		glTranslatef(0.0, 0.0, -halfHeight);
 		break;
 	case 1:
 		glRotatef(-90.0, 1.0, 0.0, 0.0);
-		glTranslatef(0.0, 0.0, -halfHeight);
 		break;
 	case 2:
-
-		glTranslatef(0.0, 0.0, -halfHeight);
 		break;
 	default:
 		{
@@ -325,67 +190,840 @@ void GL_ShapeDrawer::drawCylinder(float radius,float halfHeight, int upAxis)
 
 	}
 
-	GLUquadricObj *quadObj = gluNewQuadric();
+	//the unit cylinder is oriented along the z axis, centered at the origin
+	glScalef(radius,radius,halfHeight);
+	GL_UnitShapes::drawCylinder(lod);
 
-	//The gluCylinder subroutine draws a cylinder that is oriented along the z axis. 
-	//The base of the cylinder is placed at z = 0; the top of the cylinder is placed at z=height. 
-	//Like a sphere, the cylinder is subdivided around the z axis into slices and along the z axis into stacks.
+	glPopMatrix();
+}
 
-	gluQuadricDrawStyle(quadObj, (GLenum)GLU_FILL);
-	gluQuadricNormals(quadObj, (GLenum)GLU_SMOOTH);
+void GL_ShapeDrawer::drawCone(float radius,float height, int upAxis)
+{
+	const int	lod=GL_UnitShapes::selectLod(m_lodorigin,btSqrt(radius*radius+0.25f*height*height),2);
 
-	gluDisk(quadObj,0,radius,15, 10);
+	glPushMatrix();
+	switch (upAxis)
+	{
+	case 0:
+		glRotatef(90.0, 0.0, 1.0, 0.0);
+		break;
+	case 1:
+		glRotatef(-90.0, 1.0, 0.0, 0.0);
+		break;
+	case 2:
+		break;
+	default:
+		{
+			btAssert(0);
+		}
+	}
 
-	gluCylinder(quadObj, radius, radius, 2.f*halfHeight, 15, 10);
-	glTranslatef(0.0f, 0.0f, 2.f*halfHeight);
-	glRotatef(-180.0f, 0.0f, 1.0f, 0.0f);
-	gluDisk(quadObj,0.f,radius,15, 10);
+	//the unit cone has its base at z=0, centered like the cone shape
+	glTranslatef(0.0f, 0.0f, -0.5f*height);
+	glScalef(radius,radius,height);
+	GL_UnitShapes::drawCone(lod);
 
 	glPopMatrix();
-	gluDeleteQuadric(quadObj);
+}
+
+///one side of a triangle edge, a and b are sorted so both triangles of an edge produce the same key
+struct	HalfEdgeKey
+{
+	unsigned int	a;
+	unsigned int	b;
+	int				order;
+};
+
+struct	HalfEdgeKeySortPredicate
+{
+	bool operator() ( const HalfEdgeKey& x, const HalfEdgeKey& y ) const
+	{
+		if (x.a!=y.a) return(x.a<y.a);
+		if (x.b!=y.b) return(x.b<y.b);
+		return(x.order<y.order);
+	}
+};
+
+///buildEdges finds the edges of a triangle mesh and the normals of the triangles on both sides, in memory linear in
+///the number of indices: the half edges are sorted by vertex pair, so the two sides of an edge end up next to each other.
+///For an open edge the second normal is the flipped first one.
+void	GL_ShapeDrawer::buildEdges(const unsigned int* pi,int ni,const btVector3* pv,btAlignedObjectArray<ShapeCache::Edge>& edges)
+{
+	btAlignedObjectArray<HalfEdgeKey>	keys;
+	keys.resize(ni);
+	for(int i=0;i<ni;i+=3)
+	{
+		const unsigned int* ti=pi+i;
+		for(int j=2,k=0;k<3;j=k++)
+		{
+			HalfEdgeKey&	key=keys[i+k];
+			key.a=btMin(ti[j],ti[k]);
+			key.b=btMax(ti[j],ti[k]);
+			key.order=i+k;
+		}
+	}
+	keys.quickSort(HalfEdgeKeySortPredicate());
+
+	edges.resize(0);
+	edges.reserve(ni/2+1);
+	for(int i=0;i<ni;)
+	{
+		int	last=i+1;
+		while(last<ni && keys[last].a==keys[i].a && keys[last].b==keys[i].b)
+			++last;
+		///the first triangle in index order gives the direction of the edge and its first normal
+		const int			first=keys[i].order;
+		const unsigned int*	ti=pi+(first/3)*3;
+		const int			k=first%3;
+		const int			j=(k+2)%3;
+		const btVector3		nrm=btCross(pv[ti[1]]-pv[ti[0]],pv[ti[2]]-pv[ti[0]]).normalized();
+		edges.push_back(ShapeCache::Edge());
+		ShapeCache::Edge&	e=edges[edges.size()-1];
+		e.n[0]=nrm;e.n[1]=-nrm;
+		e.v[0]=ti[j];e.v[1]=ti[k];
+		if(last-i>1)
+		{
+			const unsigned int*	tl=pi+(keys[last-1].order/3)*3;
+			e.n[1]=btCross(pv[tl[1]]-pv[tl[0]],pv[tl[2]]-pv[tl[0]]).normalized();
+		}
+		i=last;
+	}
 }
 
 GL_ShapeDrawer::ShapeCache*		GL_ShapeDrawer::cache(btConvexShape* shape)
 {
-	ShapeCache*		sc=(ShapeCache*)shape->getUserPointer();
+	ShapeCache*		sc=(ShapeCache*)findCache(shape);
 	if(!sc)
 	{
 		sc=new(btAlignedAlloc(sizeof(ShapeCache),16)) ShapeCache(shape);
 		sc->m_shapehull.buildHull(shape->getMargin());
-		m_shapecaches.push_back(sc);
-		shape->setUserPointer(sc);
 		/* Build edges	*/ 
-		const int			ni=sc->m_shapehull.numIndices();
-		const int			nv=sc->m_shapehull.numVertices();
-		const unsigned int*	pi=sc->m_shapehull.getIndexPointer();
-		const btVector3*	pv=sc->m_shapehull.getVertexPointer();
-		btAlignedObjectArray<ShapeCache::Edge*>	edges;
-		sc->m_edges.reserve(ni);
-		edges.resize(nv*nv,0);
-		for(int i=0;i<ni;i+=3)
+		buildEdges(sc->m_shapehull.getIndexPointer(),sc->m_shapehull.numIndices(),sc->m_shapehull.getVertexPointer(),sc->m_edges);
+		addCache(sc);
+	}
+	return(sc);
+}
+
+size_t	GL_ShapeDrawer::ShapeCache::computeMemory() const
+{
+	size_t	memory=sizeof(ShapeCache)+
+		m_shapehull.numVertices()*sizeof(btVector3)+
+		m_shapehull.numIndices()*sizeof(unsigned int)+
+		m_edges.capacity()*sizeof(Edge)+
+		m_vertices.capacity()*sizeof(float)+
+		m_indices.capacity()*sizeof(unsigned int);
+	for(int i=0;i<m_silhouettes.size();++i)
+	{
+		memory+=sizeof(Silhouette)+(*m_silhouettes.getAtIndex(i))->m_quads.capacity()*sizeof(float);
+	}
+	return(memory);
+}
+
+void	GL_ShapeDrawer::ShapeCache::clearSilhouettes()
+{
+	for(int i=0;i<m_silhouettes.size();++i)
+	{
+		Silhouette*	sil=*m_silhouettes.getAtIndex(i);
+		sil->~Silhouette();
+		btAlignedFree(sil);
+	}
+	m_silhouettes.clear();
+	m_silhouettehead=0;
+	m_silhouettetail=0;
+}
+
+void	GL_ShapeDrawer::ShapeCache::touchSilhouette(Silhouette* sil,bool linked)
+{
+	if(sil==m_silhouettehead)
+		return;
+	if(linked)
+	{
+		sil->m_lruprev->m_lrunext=sil->m_lrunext;
+		if(sil->m_lrunext) sil->m_lrunext->m_lruprev=sil->m_lruprev;
+		else m_silhouettetail=sil->m_lruprev;
+	}
+	sil->m_lruprev=0;
+	sil->m_lrunext=m_silhouettehead;
+	if(m_silhouettehead) m_silhouettehead->m_lruprev=sil;
+	else m_silhouettetail=sil;
+	m_silhouettehead=sil;
+}
+
+void	GL_ShapeDrawer::ShapeCache::evictSilhouette()
+{
+	Silhouette*	oldest=m_silhouettetail;
+	if(!oldest)
+		return;
+	m_silhouettetail=oldest->m_lruprev;
+	if(m_silhouettetail) m_silhouettetail->m_lrunext=0;
+	else m_silhouettehead=0;
+	m_silhouettes.remove(oldest->m_key);
+	oldest->~Silhouette();
+	btAlignedFree(oldest);
+}
+
+///silhouette returns the shadow volume quads for a shape space extrusion. The silhouette edges are only searched
+///again when no cached silhouette is within the tolerance of the light direction, otherwise at most the
+///extruded vertices are moved. Both stencil passes draw the same volume, so the second one is always a hit.
+const GL_ShapeDrawer::Silhouette*	GL_ShapeDrawer::silhouette(ShapeCache* sc,const btVector3& extrusion)
+{
+	const btScalar		length=extrusion.length();
+	if(length<SIMD_EPSILON)
+		return(0);
+	const btVector3		direction=extrusion/length;
+	const btScalar		cell=btMax(m_silhouettetolerance,btScalar(0.0001));
+	SilhouetteKey		key;
+	for(int i=0;i<3;++i)
+	{
+		key.m_direction[i]=(int)floor(direction[i]/cell);
+	}
+	Silhouette**		found=sc->m_silhouettes.find(key);
+	Silhouette*			sil=found?*found:0;
+	if(sil)
+		sc->touchSilhouette(sil,true);
+	if(sil&&(btDot(sil->m_direction,direction)>=m_silhouettecos))
+	{
+		if(sil->m_extrusion!=extrusion)
 		{
-			const unsigned int* ti=pi+i;
-			const btVector3		nrm=btCross(pv[ti[1]]-pv[ti[0]],pv[ti[2]]-pv[ti[0]]).normalized();
-			for(int j=2,k=0;k<3;j=k++)
+			//same edges, only the far side of the quads moves
+			float*	q=sil->m_quads.size()?&sil->m_quads[0]:0;
+			for(int i=0;i<sil->m_quads.size();i+=12,q+=12)
 			{
-				const unsigned int	a=ti[j];
-				const unsigned int	b=ti[k];
-				ShapeCache::Edge*&	e=edges[btMin(a,b)*nv+btMax(a,b)];
-				if(!e)
-				{
-					sc->m_edges.push_back(ShapeCache::Edge());
-					e=&sc->m_edges[sc->m_edges.size()-1];
-					e->n[0]=nrm;e->n[1]=-nrm;
-					e->v[0]=a;e->v[1]=b;
-				}
-				else
-				{
-					e->n[1]=nrm;
-				}
+				q[6]=q[3]+float(extrusion[0]);q[7]=q[4]+float(extrusion[1]);q[8]=q[5]+float(extrusion[2]);
+				q[9]=q[0]+float(extrusion[0]);q[10]=q[1]+float(extrusion[1]);q[11]=q[2]+float(extrusion[2]);
 			}
+			sil->m_extrusion=extrusion;
 		}
+		return(sil);
 	}
-	return(sc);
+	if(!sil)
+	{
+		while(sc->m_silhouettes.size()>=m_maxsilhouettes)
+			sc->evictSilhouette();
+		sil=new(btAlignedAlloc(sizeof(Silhouette),16)) Silhouette();
+		sil->m_key=key;
+		sc->touchSilhouette(sil,false);
+		sc->m_silhouettes.insert(key,sil);
+	}
+	sil->m_direction=direction;
+	sil->m_extrusion=extrusion;
+	sil->m_quads.resize(0);
+	const btVector3*	pv=sc->m_shapehull.getVertexPointer();
+	for(int i=0;i<sc->m_edges.size();++i)
+	{
+		const btScalar		d=btDot(sc->m_edges[i].n[0],extrusion);
+		if((d*btDot(sc->m_edges[i].n[1],extrusion))<0)
+		{
+			const int			q=	d<0?1:0;
+			const btVector3&	a=	pv[sc->m_edges[i].v[q]];
+			const btVector3&	b=	pv[sc->m_edges[i].v[1-q]];
+			const btVector3		c=	b+extrusion;
+			const btVector3		e=	a+extrusion;
+			const btVector3*	quad[4]={&a,&b,&c,&e};
+			for(int j=0;j<4;++j)
+			{
+				sil->m_quads.push_back(float(quad[j]->getX()));
+				sil->m_quads.push_back(float(quad[j]->getY()));
+				sil->m_quads.push_back(float(quad[j]->getZ()));
+			}
+		}
+	}
+	updateCacheMemory(sc);
+	return(sil);
+}
+
+///findCache returns the entry of a shape and marks it as most recently used
+GL_ShapeDrawer::CacheEntry*	GL_ShapeDrawer::findCache(const btCollisionShape* shape)
+{
+	CacheEntry**	found=m_caches.find(btHashPtr(shape));
+	if(!found)
+		return(0);
+	CacheEntry*		entry=*found;
+	if(entry!=m_lruhead)
+	{
+		//unlink, then insert at the front
+		entry->m_lruprev->m_lrunext=entry->m_lrunext;
+		if(entry->m_lrunext) entry->m_lrunext->m_lruprev=entry->m_lruprev;
+		else m_lrutail=entry->m_lruprev;
+		entry->m_lruprev=0;
+		entry->m_lrunext=m_lruhead;
+		m_lruhead->m_lruprev=entry;
+		m_lruhead=entry;
+	}
+	return(entry);
+}
+
+void	GL_ShapeDrawer::addCache(CacheEntry* entry)
+{
+	m_caches.insert(btHashPtr(entry->m_shape),entry);
+	entry->m_lruprev=0;
+	entry->m_lrunext=m_lruhead;
+	if(m_lruhead) m_lruhead->m_lruprev=entry;
+	else m_lrutail=entry;
+	m_lruhead=entry;
+	updateCacheMemory(entry);
+}
+
+void	GL_ShapeDrawer::removeCache(CacheEntry* entry)
+{
+	m_caches.remove(btHashPtr(entry->m_shape));
+	if(entry->m_lruprev) entry->m_lruprev->m_lrunext=entry->m_lrunext;
+	else m_lruhead=entry->m_lrunext;
+	if(entry->m_lrunext) entry->m_lrunext->m_lruprev=entry->m_lruprev;
+	else m_lrutail=entry->m_lruprev;
+	m_cachememory-=entry->m_memory;
+	entry->~CacheEntry();
+	btAlignedFree(entry);
+}
+
+///updateCacheMemory accounts for an entry that grew, and evicts the least recently used entries over the budget.
+///The most recently used entry is never evicted, it is the one that is being drawn.
+void	GL_ShapeDrawer::updateCacheMemory(CacheEntry* entry)
+{
+	const size_t	memory=entry->computeMemory();
+	m_cachememory=m_cachememory-entry->m_memory+memory;
+	entry->m_memory=memory;
+	while(m_cachebudget && m_cachememory>m_cachebudget && m_lrutail && m_lrutail!=m_lruhead)
+	{
+		removeCache(m_lrutail);
+	}
+}
+
+void	GL_ShapeDrawer::invalidateShape(const btCollisionShape* shape)
+{
+	CacheEntry**	found=m_caches.find(btHashPtr(shape));
+	if(found)
+		removeCache(*found);
+}
+
+void	GL_ShapeDrawer::setSilhouetteTolerance(btScalar angle)
+{
+	m_silhouettetolerance=btMax(angle,btScalar(0.));
+	m_silhouettecos=btCos(m_silhouettetolerance);
+}
+
+void	GL_ShapeDrawer::setCacheMemoryBudget(size_t bytes)
+{
+	m_cachebudget=bytes;
+	if(m_lruhead)
+		updateCacheMemory(m_lruhead);
+}
+
+int		GL_ShapeDrawer::ShapeCache::addVertex(const btVector3& n,const btVector3& v)
+{
+	const int	index=m_vertices.size()/6;
+	m_vertices.push_back(float(n.getX()));
+	m_vertices.push_back(float(n.getY()));
+	m_vertices.push_back(float(n.getZ()));
+	m_vertices.push_back(float(v.getX()));
+	m_vertices.push_back(float(v.getY()));
+	m_vertices.push_back(float(v.getZ()));
+	return(index);
+}
+
+///buildMesh produces the same triangles and normals as the immediate mode paths of drawOpenGL
+void	GL_ShapeDrawer::buildMesh(ShapeCache* sc,const btConvexShape* shape)
+{
+	sc->m_meshbuilt=true;
+	sc->m_vertices.resize(0);
+	sc->m_indices.resize(0);
+
+	if(shape->getShapeType()==BOX_SHAPE_PROXYTYPE)
+	{
+		const btBoxShape* boxShape = static_cast<const btBoxShape*>(shape);
+		btVector3 halfExtent = boxShape->getHalfExtentsWithMargin();
+		static const int indices[36] = {
+			0,1,2,
+			3,2,1,
+			4,0,6,
+			6,0,2,
+			5,1,4,
+			4,1,0,
+			7,3,1,
+			7,1,5,
+			5,4,7,
+			7,4,6,
+			7,2,3,
+			7,6,2};
+		const btVector3 vertices[8]={
+			btVector3(halfExtent[0],halfExtent[1],halfExtent[2]),
+			btVector3(-halfExtent[0],halfExtent[1],halfExtent[2]),
+			btVector3(halfExtent[0],-halfExtent[1],halfExtent[2]),
+			btVector3(-halfExtent[0],-halfExtent[1],halfExtent[2]),
+			btVector3(halfExtent[0],halfExtent[1],-halfExtent[2]),
+			btVector3(-halfExtent[0],halfExtent[1],-halfExtent[2]),
+			btVector3(halfExtent[0],-halfExtent[1],-halfExtent[2]),
+			btVector3(-halfExtent[0],-halfExtent[1],-halfExtent[2])};
+		for (int i=0;i<36;i+=3)
+		{
+			const btVector3& v1 = vertices[indices[i]];
+			const btVector3& v2 = vertices[indices[i+1]];
+			const btVector3& v3 = vertices[indices[i+2]];
+			const btVector3 normal = (v3-v1).cross(v2-v1).normalized();
+			sc->m_indices.push_back(sc->addVertex(normal,v1));
+			sc->m_indices.push_back(sc->addVertex(normal,v2));
+			sc->m_indices.push_back(sc->addVertex(normal,v3));
+		}
+		return;
+	}
+
+	const btConvexPolyhedron* poly = shape->isPolyhedral() ? ((btPolyhedralConvexShape*) shape)->getConvexPolyhedron() : 0;
+	if (poly)
+	{
+		///the vertices of a face share its normal, so they are stored once per face and fanned by index
+		for (int i=0;i<poly->m_faces.size();i++)
+		{
+			const btAlignedObjectArray<int>& face = poly->m_faces[i].m_indices;
+			if (face.size()<3)
+				continue;
+			const btVector3& v1 = poly->m_vertices[face[0]];
+			const btVector3 normal = (poly->m_vertices[face[2]]-v1).cross(poly->m_vertices[face[1]]-v1).normalized();
+			const int	first=sc->m_vertices.size()/6;
+			for (int v=0;v<face.size();v++)
+			{
+				sc->addVertex(normal,poly->m_vertices[face[v]]);
+			}
+			for (int v=0;v<face.size()-2;v++)
+			{
+				sc->m_indices.push_back(first);
+				sc->m_indices.push_back(first+v+1);
+				sc->m_indices.push_back(first+v+2);
+			}
+		}
+		return;
+	}
+
+	const btShapeHull*		hull=&sc->m_shapehull;
+	const unsigned int*		idx=hull->getIndexPointer();
+	const btVector3*		vtx=hull->getVertexPointer();
+	for (int i=0;i<hull->numTriangles();i++)
+	{
+		const btVector3& v1 = vtx[idx[i*3]];
+		const btVector3& v2 = vtx[idx[i*3+1]];
+		const btVector3& v3 = vtx[idx[i*3+2]];
+		const btVector3 normal = (v3-v1).cross(v2-v1).normalized();
+		sc->m_indices.push_back(sc->addVertex(normal,v1));
+		sc->m_indices.push_back(sc->addVertex(normal,v2));
+		sc->m_indices.push_back(sc->addVertex(normal,v3));
+	}
+}
+
+void	GL_ShapeDrawer::drawMesh(const ShapeCache* sc)
+{
+	if(sc->m_indices.size()==0)
+		return;
+	glInterleavedArrays(GL_N3F_V3F,0,&sc->m_vertices[0]);
+	glDrawElements(GL_TRIANGLES,sc->m_indices.size(),GL_UNSIGNED_INT,&sc->m_indices[0]);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+///only meshes whose triangles don't change are retained, deformable GIMPACT and soft body meshes are drawn as before
+///spheres, cylinders and cones are drawn from the GL_UnitShapes tables instead of a retained mesh,
+///so their level of detail follows the projected size
+bool	GL_ShapeDrawer::isUnitShape(int shapetype)
+{
+	switch (shapetype)
+	{
+	case SPHERE_SHAPE_PROXYTYPE:
+	case MULTI_SPHERE_SHAPE_PROXYTYPE:
+	case CYLINDER_SHAPE_PROXYTYPE:
+	case CONE_SHAPE_PROXYTYPE:
+		return(true);
+	default:
+		return(false);
+	}
+}
+
+bool	GL_ShapeDrawer::canRetainConcave(const btCollisionShape* shape)
+{
+	switch (shape->getShapeType())
+	{
+	case TRIANGLE_MESH_SHAPE_PROXYTYPE:
+	case SCALED_TRIANGLE_MESH_SHAPE_PROXYTYPE:
+	case MULTIMATERIAL_TRIANGLE_MESH_PROXYTYPE:
+	case TERRAIN_SHAPE_PROXYTYPE:
+		return(true);
+	default:
+		return(false);
+	}
+}
+
+///collects the triangles of a concave shape, once when its cache is built
+class ConcaveChunkCallback : public btTriangleCallback
+{
+public:
+	btAlignedObjectArray<btVector3>	m_triangles;
+
+	virtual void processTriangle(btVector3* triangle,int partId, int triangleIndex)
+	{
+		(void)partId;
+		(void)triangleIndex;
+		m_triangles.push_back(triangle[0]);
+		m_triangles.push_back(triangle[1]);
+		m_triangles.push_back(triangle[2]);
+	}
+};
+
+size_t	GL_ShapeDrawer::ConcaveCache::computeMemory() const
+{
+	return(sizeof(ConcaveCache)+
+		m_vertices.capacity()*sizeof(float)+
+		m_chunks.capacity()*sizeof(MeshChunk));
+}
+
+///concaveCache sorts the triangles into a uniform grid over the shape bounds, sized for sConcaveChunkTriangles
+///per cell along the axes that have an extent. Each non empty cell becomes a chunk with the bounds of its triangles.
+GL_ShapeDrawer::ConcaveCache*	GL_ShapeDrawer::concaveCache(const btConcaveShape* shape)
+{
+	ConcaveCache*	cc=(ConcaveCache*)findCache(shape);
+	if(cc)
+		return(cc);
+	cc=new(btAlignedAlloc(sizeof(ConcaveCache),16)) ConcaveCache(shape);
+
+	const btVector3	aabbMax(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+	ConcaveChunkCallback	collector;
+	shape->processAllTriangles(&collector,-aabbMax,aabbMax);
+	const int	numTriangles=collector.m_triangles.size()/3;
+
+	btVector3	meshMin(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+	btVector3	meshMax=-meshMin;
+	for(int i=0;i<collector.m_triangles.size();++i)
+	{
+		meshMin.setMin(collector.m_triangles[i]);
+		meshMax.setMax(collector.m_triangles[i]);
+	}
+
+	int	cells[3]={1,1,1};
+	if(numTriangles>sConcaveChunkTriangles)
+	{
+		const btVector3	extent=meshMax-meshMin;
+		const btScalar	minExtent=extent[extent.maxAxis()]*btScalar(0.01);
+		btScalar		volume=1.f;
+		int				numAxes=0;
+		for(int a=0;a<3;++a)
+		{
+			if(extent[a]>minExtent)
+			{
+				volume*=extent[a];
+				numAxes++;
+			}
+		}
+		const btScalar	numCells=btScalar(numTriangles)/btScalar(sConcaveChunkTriangles);
+		const btScalar	cellSize=btPow(volume/numCells,btScalar(1.)/btScalar(numAxes));
+		for(int a=0;a<3;++a)
+		{
+			if(extent[a]>minExtent)
+				cells[a]=btMin(sConcaveChunkCells,btMax(1,(int)btCeil(extent[a]/cellSize)));
+		}
+	}
+
+	//counting sort of the triangles by the cell of their centroid
+	const int	numCells=cells[0]*cells[1]*cells[2];
+	btAlignedObjectArray<int>	cellOf;
+	btAlignedObjectArray<int>	cellStart;
+	cellOf.resize(numTriangles);
+	cellStart.resize(numCells+1,0);
+	const btVector3	extent=meshMax-meshMin;
+	for(int t=0;t<numTriangles;++t)
+	{
+		const btVector3	centroid=(collector.m_triangles[t*3]+collector.m_triangles[t*3+1]+collector.m_triangles[t*3+2])/btScalar(3.);
+		int	cell=0;
+		for(int a=2;a>=0;--a)
+		{
+			int	c=0;
+			if(extent[a]>btScalar(0.))
+				c=btMin(cells[a]-1,btMax(0,(int)((centroid[a]-meshMin[a])/extent[a]*btScalar(cells[a]))));
+			cell=cell*cells[a]+c;
+		}
+		cellOf[t]=cell;
+		cellStart[cell+1]++;
+	}
+	for(int c=0;c<numCells;++c)
+		cellStart[c+1]+=cellStart[c];
+	btAlignedObjectArray<int>	order;
+	order.resize(numTriangles);
+	{
+		btAlignedObjectArray<int>	next;
+		next.resize(numCells);
+		for(int c=0;c<numCells;++c)
+			next[c]=cellStart[c];
+		for(int t=0;t<numTriangles;++t)
+			order[next[cellOf[t]]++]=t;
+	}
+
+	cc->m_vertices.resize(numTriangles*18);
+	float*	pv=numTriangles ? &cc->m_vertices[0] : 0;
+	for(int c=0;c<numCells;++c)
+	{
+		if(cellStart[c]==cellStart[c+1])
+			continue;
+		MeshChunk&	chunk=cc->m_chunks.expand();
+		chunk.m_firstvertex=cellStart[c]*3;
+		chunk.m_numvertices=(cellStart[c+1]-cellStart[c])*3;
+		chunk.m_aabbMin.setValue(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+		chunk.m_aabbMax=-chunk.m_aabbMin;
+		for(int i=cellStart[c];i<cellStart[c+1];++i)
+		{
+			const btVector3*	tri=&collector.m_triangles[order[i]*3];
+			btVector3			normal=btCross(tri[1]-tri[0],tri[2]-tri[0]);
+			if(normal.length2()>SIMD_EPSILON)
+				normal.normalize();
+			for(int v=0;v<3;++v)
+			{
+				const btVector3&	p=tri[v];
+				pv[0]=float(normal.getX());pv[1]=float(normal.getY());pv[2]=float(normal.getZ());
+				pv[3]=float(p.getX());pv[4]=float(p.getY());pv[5]=float(p.getZ());
+				pv+=6;
+				chunk.m_aabbMin.setMin(p);
+				chunk.m_aabbMax.setMax(p);
+			}
+		}
+	}
+	addCache(cc);
+	return(cc);
+}
+
+///drawConcaveChunks draws the chunks that overlap the bounds, neighbouring chunks in the array share a draw call.
+///Without face culling and with two sided lighting, each triangle is drawn once from either side, like both windings
+///in the lit pass, and once per shadow volume pass.
+void	GL_ShapeDrawer::drawConcaveChunks(const ConcaveCache* cc,const btVector3& boundsMin,const btVector3& boundsMax)
+{
+	if(cc->m_chunks.size()==0)
+		return;
+	applyTwoSided(true);
+	glInterleavedArrays(GL_N3F_V3F,0,&cc->m_vertices[0]);
+	int	first=0;
+	int	count=0;
+	for(int i=0;i<cc->m_chunks.size();++i)
+	{
+		const MeshChunk&	chunk=cc->m_chunks[i];
+		if(!TestAabbAgainstAabb2(chunk.m_aabbMin,chunk.m_aabbMax,boundsMin,boundsMax))
+			continue;
+		if(count&&(first+count==chunk.m_firstvertex))
+		{
+			count+=chunk.m_numvertices;
+			continue;
+		}
+		if(count)
+		{
+			glDrawArrays(GL_TRIANGLES,first,count);
+			m_numdrawcalls++;
+		}
+		first=chunk.m_firstvertex;
+		count=chunk.m_numvertices;
+	}
+	if(count)
+	{
+		glDrawArrays(GL_TRIANGLES,first,count);
+		m_numdrawcalls++;
+	}
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+///prepareTexturing sets up the checker texture with object linear texture coordinates, and color material
+void	GL_ShapeDrawer::prepareTexturing()
+{
+	if(m_textureenabled&&(!m_textureinitialized))
+	{
+		GLubyte*	image=new GLubyte[256*256*3];
+		for(int y=0;y<256;++y)
+		{
+			const int	t=y>>4;
+			GLubyte*	pi=image+y*256*3;
+			for(int x=0;x<256;++x)
+			{
+				const int		s=x>>4;
+				const GLubyte	b=180;					
+				GLubyte			c=b+((s+t&1)&1)*(255-b);
+				pi[0]=pi[1]=pi[2]=c;pi+=3;
+			}
+		}
+
+		glGenTextures(1,(GLuint*)&m_texturehandle);
+		glBindTexture(GL_TEXTURE_2D,m_texturehandle);
+		glTexEnvf(GL_TEXTURE_ENV,GL_TEXTURE_ENV_MODE,GL_MODULATE);
+		glTexParameterf(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameterf(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameterf(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_REPEAT);
+		glTexParameterf(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_REPEAT);
+		gluBuild2DMipmaps(GL_TEXTURE_2D,3,256,256,GL_RGB,GL_UNSIGNED_BYTE,image);
+		delete[] image;
+	}
+
+	//nothing to do while the state of the previous draw is still set
+	if(m_statevalid&&(m_appliedtexture==m_textureenabled))
+		return;
+	m_statevalid=true;
+	m_appliedtexture=m_textureenabled;
+	m_numstatechanges++;
+
+	glMatrixMode(GL_TEXTURE);
+	glLoadIdentity();
+	glScalef(0.025f,0.025f,0.025f);
+	glMatrixMode(GL_MODELVIEW);
+
+	static const GLfloat	planex[]={1,0,0,0};
+	//static const GLfloat	planey[]={0,1,0,0};
+	static const GLfloat	planez[]={0,0,1,0};
+	glTexGenfv(GL_S,GL_OBJECT_PLANE,planex);
+	glTexGenfv(GL_T,GL_OBJECT_PLANE,planez);
+	glTexGeni(GL_S,GL_TEXTURE_GEN_MODE,GL_OBJECT_LINEAR);
+	glTexGeni(GL_T,GL_TEXTURE_GEN_MODE,GL_OBJECT_LINEAR);
+	glEnable(GL_TEXTURE_GEN_S);
+	glEnable(GL_TEXTURE_GEN_T);
+	glEnable(GL_TEXTURE_GEN_R);
+	m_textureinitialized=true;
+
+	glEnable(GL_COLOR_MATERIAL);
+	if(m_textureenabled) 
+	{
+		glEnable(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D,m_texturehandle);
+	} else
+	{
+		glDisable(GL_TEXTURE_2D);
+	}
+}
+
+void	GL_ShapeDrawer::applyColor(const btVector3& color)
+{
+	if(m_colorvalid&&(m_appliedcolor==color))
+		return;
+	glColor3f(color.x(),color.y(),color.z());
+	m_appliedcolor=color;
+	m_colorvalid=true;
+	m_numstatechanges++;
+}
+
+///applyTwoSided switches culling off and two sided lighting on for the concave chunks, and back for the other shapes.
+///The replaced values are read when it switches on, that is once per run of concave shapes in the sorted order.
+void	GL_ShapeDrawer::applyTwoSided(bool twosided)
+{
+	if(m_twosided==twosided)
+		return;
+	if(twosided)
+	{
+		m_cullface=glIsEnabled(GL_CULL_FACE)!=0;
+		glGetIntegerv(GL_LIGHT_MODEL_TWO_SIDE,&m_lighttwoside);
+		glDisable(GL_CULL_FACE);
+		glLightModeli(GL_LIGHT_MODEL_TWO_SIDE,GL_TRUE);
+	} else
+	{
+		glLightModeli(GL_LIGHT_MODEL_TWO_SIDE,m_lighttwoside);
+		if(m_cullface)
+			glEnable(GL_CULL_FACE);
+	}
+	m_twosided=twosided;
+	m_numstatechanges++;
+}
+
+unsigned int	GL_ShapeDrawer::getStateKey(const btCollisionShape* shape,int debugMode) const
+{
+	const int		shapetype=shape->getShapeType();
+	unsigned int	path=2;
+	if(canDrawInstanced(shape,debugMode))
+		path=0;
+	else if(m_retainedmeshes&&shape->isConvex()&&!isUnitShape(shapetype))
+		path=1;
+	else if(m_retainedmeshes&&canRetainConcave(shape)&&(debugMode&btIDebugDraw::DBG_DrawWireframe)==0)
+		path=1;
+	return((path<<8)|(unsigned int)(shapetype&0xff));
+}
+
+bool	GL_ShapeDrawer::canDrawInstanced(const btCollisionShape* shape,int debugMode) const
+{
+	if (!m_retainedmeshes || !shape->isConvex())
+		return(false);
+	if (debugMode & (btIDebugDraw::DBG_DrawWireframe|btIDebugDraw::DBG_DrawFeaturesText))
+		return(false);
+	switch (shape->getShapeType())
+	{
+	case BOX_SHAPE_PROXYTYPE:
+		return((debugMode & btIDebugDraw::DBG_FastWireframe)==0);
+	case SPHERE_SHAPE_PROXYTYPE:
+	case MULTI_SPHERE_SHAPE_PROXYTYPE:
+	case CYLINDER_SHAPE_PROXYTYPE:
+	case CONE_SHAPE_PROXYTYPE:
+	case UNIFORM_SCALING_SHAPE_PROXYTYPE:
+	case CUSTOM_CONVEX_SHAPE_TYPE:
+		return(false);
+	default:
+		return(true);
+	}
+}
+
+void	GL_ShapeDrawer::drawInstances(const ShapeInstance* instances,int numInstances)
+{
+	if (numInstances<=0)
+		return;
+
+	const btConvexShape*	shape=(const btConvexShape*)instances[0].m_shape;
+	ShapeCache*				sc=cache((btConvexShape*)shape);
+	if (!sc->m_meshbuilt)
+	{
+		buildMesh(sc,shape);
+		updateCacheMemory(sc);
+	}
+	const int		numVertices=sc->m_vertices.size()/6;
+	const int		numIndices=sc->m_indices.size();
+	if (!numIndices)
+		return;
+
+	m_batchvertices.resize(numVertices*numInstances*12);
+	m_batchindices.resize(numIndices*numInstances);
+	float*			dst=&m_batchvertices[0];
+	for (int j=0;j<numInstances;j++)
+	{
+		const btScalar*		m=instances[j].m_transform;
+		const btVector3&	color=instances[j].m_color;
+		const float*		src=&sc->m_vertices[0];
+		for (int i=0;i<numVertices;i++,src+=6,dst+=12)
+		{
+			///texture coordinates from the local position, like the object linear texgen of drawOpenGL
+			dst[0]=src[3];
+			dst[1]=src[5];
+			dst[2]=float(color.getX());
+			dst[3]=float(color.getY());
+			dst[4]=float(color.getZ());
+			dst[5]=1.f;
+			dst[6]=float(m[0]*src[0]+m[4]*src[1]+m[8]*src[2]);
+			dst[7]=float(m[1]*src[0]+m[5]*src[1]+m[9]*src[2]);
+			dst[8]=float(m[2]*src[0]+m[6]*src[1]+m[10]*src[2]);
+			dst[9]=float(m[0]*src[3]+m[4]*src[4]+m[8]*src[5]+m[12]);
+			dst[10]=float(m[1]*src[3]+m[5]*src[4]+m[9]*src[5]+m[13]);
+			dst[11]=float(m[2]*src[3]+m[6]*src[4]+m[10]*src[5]+m[14]);
+		}
+		const unsigned int	offset=j*numVertices;
+		unsigned int*		idx=&m_batchindices[j*numIndices];
+		for (int i=0;i<numIndices;i++)
+		{
+			idx[i]=sc->m_indices[i]+offset;
+		}
+	}
+
+	prepareTexturing();
+	applyTwoSided(false);
+	glDisable(GL_TEXTURE_GEN_S);
+	glDisable(GL_TEXTURE_GEN_T);
+	glDisable(GL_TEXTURE_GEN_R);
+
+	glInterleavedArrays(GL_T2F_C4F_N3F_V3F,0,&m_batchvertices[0]);
+	glDrawElements(GL_TRIANGLES,m_batchindices.size(),GL_UNSIGNED_INT,&m_batchindices[0]);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	glEnable(GL_TEXTURE_GEN_S);
+	glEnable(GL_TEXTURE_GEN_T);
+	glEnable(GL_TEXTURE_GEN_R);
+	glNormal3f(0,1,0);
+	//the color array leaves the current color undefined
+	m_colorvalid=false;
+	m_numdrawcalls++;
+	m_numstatechanges++;
 }
 
 void renderSquareA(float x, float y, float z)
@@ -403,6 +1041,9 @@ inline void glDrawVector(const btVector3& v) { glVertex3d(v[0], v[1], v[2]); }
 
 void GL_ShapeDrawer::drawOpenGL(btScalar* m, const btCollisionShape* shape, const btVector3& color,int	debugMode,const btVector3& worldBoundsMin,const btVector3& worldBoundsMax)
 {
+	//children of compound and scaled shapes use the position of the object for the level of detail
+	if (m_drawdepth==0)
+		m_lodorigin.setValue(m[12],m[13],m[14]);
 	
 	if (shape->getShapeType() == CUSTOM_CONVEX_SHAPE_TYPE)
 	{
@@ -418,6 +1059,8 @@ void GL_ShapeDrawer::drawOpenGL(btScalar* m, const btCollisionShape* shape, cons
 		glColor3f(1,1,1);
 		glDisable(GL_LIGHTING);
 		glLineWidth(2);
+		m_colorvalid=false;
+		m_numdrawcalls++;
 
 		glBegin(GL_LINE_LOOP);
 		glDrawVector(org - dx - dy);
@@ -458,6 +1101,7 @@ void GL_ShapeDrawer::drawOpenGL(btScalar* m, const btCollisionShape* shape, cons
 		glDrawVector(org - dx - dy + dz);
 		glDrawVector(org - dx + dy + dz);
 		glEnd();
+		m_numdrawcalls++;
 		return;
 	}
 
@@ -476,7 +1120,9 @@ void GL_ShapeDrawer::drawOpenGL(btScalar* m, const btCollisionShape* shape, cons
 			{0,0,scalingFactor,0},
 			{0,0,0,1}};
 
+			m_drawdepth++;
 			drawOpenGL( (btScalar*)tmpScaling,convexShape,color,debugMode,worldBoundsMin,worldBoundsMax);
+			m_drawdepth--;
 		}
 		glPopMatrix();
 		return;
@@ -491,75 +1137,21 @@ void GL_ShapeDrawer::drawOpenGL(btScalar* m, const btCollisionShape* shape, cons
 			const btCollisionShape* colShape = compoundShape->getChildShape(i);
 			ATTRIBUTE_ALIGNED16(btScalar) childMat[16];
 			childTrans.getOpenGLMatrix(childMat);
+			m_drawdepth++;
 			drawOpenGL(childMat,colShape,color,debugMode,worldBoundsMin,worldBoundsMax);
+			m_drawdepth--;
 		}
 
 	} else
 	{
-		if(m_textureenabled&&(!m_textureinitialized))
-		{
-			GLubyte*	image=new GLubyte[256*256*3];
-			for(int y=0;y<256;++y)
-			{
-				const int	t=y>>4;
-				GLubyte*	pi=image+y*256*3;
-				for(int x=0;x<256;++x)
-				{
-					const int		s=x>>4;
-					const GLubyte	b=180;					
-					GLubyte			c=b+((s+t&1)&1)*(255-b);
-					pi[0]=pi[1]=pi[2]=c;pi+=3;
-				}
-			}
-
-			glGenTextures(1,(GLuint*)&m_texturehandle);
-			glBindTexture(GL_TEXTURE_2D,m_texturehandle);
-			glTexEnvf(GL_TEXTURE_ENV,GL_TEXTURE_ENV_MODE,GL_MODULATE);
-			glTexParameterf(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR_MIPMAP_LINEAR);
-			glTexParameterf(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR_MIPMAP_LINEAR);
-			glTexParameterf(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_REPEAT);
-			glTexParameterf(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_REPEAT);
-			gluBuild2DMipmaps(GL_TEXTURE_2D,3,256,256,GL_RGB,GL_UNSIGNED_BYTE,image);
-			delete[] image;
-	
-			
-		}
+		prepareTexturing();
+		//the concave chunks switch to two sided drawing themselves
+		if (!shape->isConcave())
+			applyTwoSided(false);
 
-		glMatrixMode(GL_TEXTURE);
-		glLoadIdentity();
-		glScalef(0.025f,0.025f,0.025f);
-		glMatrixMode(GL_MODELVIEW);
-
-		static const GLfloat	planex[]={1,0,0,0};
-		//	static const GLfloat	planey[]={0,1,0,0};
-			static const GLfloat	planez[]={0,0,1,0};
-			glTexGenfv(GL_S,GL_OBJECT_PLANE,planex);
-			glTexGenfv(GL_T,GL_OBJECT_PLANE,planez);
-			glTexGeni(GL_S,GL_TEXTURE_GEN_MODE,GL_OBJECT_LINEAR);
-			glTexGeni(GL_T,GL_TEXTURE_GEN_MODE,GL_OBJECT_LINEAR);
-			glEnable(GL_TEXTURE_GEN_S);
-			glEnable(GL_TEXTURE_GEN_T);
-			glEnable(GL_TEXTURE_GEN_R);
-			m_textureinitialized=true;
-
-		
-			
 
-		//drawCoordSystem();
-
-		//glPushMatrix();
-		glEnable(GL_COLOR_MATERIAL);
-		if(m_textureenabled) 
-		{
-			glEnable(GL_TEXTURE_2D);
-			glBindTexture(GL_TEXTURE_2D,m_texturehandle);
-		} else
-		{
-			glDisable(GL_TEXTURE_2D);
-		}
-
-
-		glColor3f(color.x(),color.y(), color.z());		
+		applyColor(color);
+		m_numdrawcalls++;
 
 		bool useWireframeFallback = true;
 
@@ -570,6 +1162,19 @@ void GL_ShapeDrawer::drawOpenGL(btScalar* m, const btCollisionShape* shape, cons
 			///the benefit of 'default' is that it approximates the actual collision shape including collision margin
 			//int shapetype=m_textureenabled?MAX_BROADPHASE_COLLISION_TYPES:shape->getShapeType();
 			int shapetype=shape->getShapeType();
+			if (m_retainedmeshes && shape->isConvex() && !isUnitShape(shapetype))
+			{
+				ShapeCache*	sc=cache((btConvexShape*)shape);
+				if (!sc->m_meshbuilt)
+				{
+					buildMesh(sc,(const btConvexShape*)shape);
+					updateCacheMemory(sc);
+				}
+				drawMesh(sc);
+				useWireframeFallback = false;
+				//skip the immediate mode cases below
+				shapetype=MAX_BROADPHASE_COLLISION_TYPES;
+			}
 			switch (shapetype)
 			{
 
@@ -635,36 +1240,17 @@ void GL_ShapeDrawer::drawOpenGL(btScalar* m, const btCollisionShape* shape, cons
 
 
 
-#if 0
-			
 			case CONE_SHAPE_PROXYTYPE:
 				{
 					const btConeShape* coneShape = static_cast<const btConeShape*>(shape);
 					int upIndex = coneShape->getConeUpIndex();
 					float radius = coneShape->getRadius();//+coneShape->getMargin();
 					float height = coneShape->getHeight();//+coneShape->getMargin();
-					switch (upIndex)
-					{
-					case 0:
-						glRotatef(90.0, 0.0, 1.0, 0.0);
-						break;
-					case 1:
-						glRotatef(-90.0, 1.0, 0.0, 0.0);
-						break;
-					case 2:
-						break;
-					default:
-						{
-						}
-					};
-
-					glTranslatef(0.0, 0.0, -0.5*height);
-					glutSolidCone(radius,height,10,10);
+					drawCone(radius,height,upIndex);
 					useWireframeFallback = false;
 					break;
 
 				}
-#endif
 
 			case STATIC_PLANE_PROXYTYPE:
 				{
@@ -691,7 +1277,6 @@ void GL_ShapeDrawer::drawOpenGL(btScalar* m, const btCollisionShape* shape, cons
 
 				}
 
-/*
 			case CYLINDER_SHAPE_PROXYTYPE:
 				{
 					const btCylinderShape* cylinder = static_cast<const btCylinderShape*>(shape);
@@ -702,10 +1287,13 @@ void GL_ShapeDrawer::drawOpenGL(btScalar* m, const btCollisionShape* shape, cons
 					float halfHeight = cylinder->getHalfExtentsWithMargin()[upAxis];
 
 					drawCylinder(radius,halfHeight,upAxis);
-
+					useWireframeFallback = false;
 					break;
 				}
-*/
+
+			case MAX_BROADPHASE_COLLISION_TYPES:
+				///already drawn from the retained mesh
+				break;
 
 			case MULTI_SPHERE_SHAPE_PROXYTYPE:
 			{
@@ -721,7 +1309,9 @@ void GL_ShapeDrawer::drawOpenGL(btScalar* m, const btCollisionShape* shape, cons
 					childTransform.setOrigin(multiSphereShape->getSpherePosition(i));
 					ATTRIBUTE_ALIGNED16(btScalar) childMat[16];
 					childTransform.getOpenGLMatrix(childMat);
+					m_drawdepth++;
 					drawOpenGL(childMat,&sc,color,debugMode,worldBoundsMin,worldBoundsMax);
+					m_drawdepth--;
 				}
 
 				break;
@@ -848,36 +1438,27 @@ void GL_ShapeDrawer::drawOpenGL(btScalar* m, const btCollisionShape* shape, cons
 		}
 
 
-#ifdef USE_DISPLAY_LISTS
-
-		if (shape->getShapeType() == TRIANGLE_MESH_SHAPE_PROXYTYPE||shape->getShapeType() == GIMPACT_SHAPE_PROXYTYPE)
-		{
-			GLuint dlist =   OGL_get_displaylist_for_shape((btCollisionShape * )shape);
-			if (dlist)
-			{
-				glCallList(dlist);
-			}
-			else
-			{
-#else		
 		if (shape->isConcave() && !shape->isInfinite())
 		{
 			btConcaveShape* concaveMesh = (btConcaveShape*) shape;
 
-			GlDrawcallback drawCallback;
-			drawCallback.m_wireframe = (debugMode & btIDebugDraw::DBG_DrawWireframe)!=0;
-
-			concaveMesh->processAllTriangles(&drawCallback,worldBoundsMin,worldBoundsMax);
+			if (m_retainedmeshes && canRetainConcave(shape) && (debugMode & btIDebugDraw::DBG_DrawWireframe)==0)
+			{
+				drawConcaveChunks(concaveCache(concaveMesh),worldBoundsMin,worldBoundsMax);
+			} else
+			{
+				applyTwoSided(false);
+				GlDrawcallback drawCallback;
+				drawCallback.m_wireframe = (debugMode & btIDebugDraw::DBG_DrawWireframe)!=0;
 
+				concaveMesh->processAllTriangles(&drawCallback,worldBoundsMin,worldBoundsMax);
+				m_numdrawcalls++;
+			}
 		}
-#endif
-
-#ifdef USE_DISPLAY_LISTS
-	}
-}
-#endif
-
 
+		//triangle meshes and feature text set their own colors
+		if (shape->isConcave() || debugMode==btIDebugDraw::DBG_DrawFeaturesText)
+			m_colorvalid=false;
 
 
 
@@ -922,23 +1503,15 @@ void		GL_ShapeDrawer::drawShadow(btScalar* m,const btVector3& extrusion,const bt
 		if (shape->isConvex())
 		{
 			ShapeCache*	sc=cache((btConvexShape*)shape);
-			btShapeHull* hull =&sc->m_shapehull;
-			glBegin(GL_QUADS);
-			for(int i=0;i<sc->m_edges.size();++i)
-			{			
-				const btScalar		d=btDot(sc->m_edges[i].n[0],extrusion);
-				if((d*btDot(sc->m_edges[i].n[1],extrusion))<0)
-				{
-					const int			q=	d<0?1:0;
-					const btVector3&	a=	hull->getVertexPointer()[sc->m_edges[i].v[q]];
-					const btVector3&	b=	hull->getVertexPointer()[sc->m_edges[i].v[1-q]];
-					glVertex3f(a[0],a[1],a[2]);
-					glVertex3f(b[0],b[1],b[2]);
-					glVertex3f(b[0]+extrusion[0],b[1]+extrusion[1],b[2]+extrusion[2]);
-					glVertex3f(a[0]+extrusion[0],a[1]+extrusion[1],a[2]+extrusion[2]);
-				}
+			const Silhouette*	sil=silhouette(sc,extrusion);
+			if(sil&&sil->m_quads.size())
+			{
+				applyTwoSided(false);
+				glInterleavedArrays(GL_V3F,0,&sil->m_quads[0]);
+				glDrawArrays(GL_QUADS,0,sil->m_quads.size()/3);
+				glDisableClientState(GL_VERTEX_ARRAY);
+				m_numdrawcalls++;
 			}
-			glEnd();
 		}
 
 	}
@@ -951,10 +1524,18 @@ void		GL_ShapeDrawer::drawShadow(btScalar* m,const btVector3& extrusion,const bt
 	{
 		btConcaveShape* concaveMesh = (btConcaveShape*) shape;
 
-		GlDrawcallback drawCallback;
-		drawCallback.m_wireframe = false;
+		if (m_retainedmeshes && canRetainConcave(shape))
+		{
+			drawConcaveChunks(concaveCache(concaveMesh),worldBoundsMin,worldBoundsMax);
+		} else
+		{
+			applyTwoSided(false);
+			GlDrawcallback drawCallback;
+			drawCallback.m_wireframe = false;
 
-		concaveMesh->processAllTriangles(&drawCallback,worldBoundsMin,worldBoundsMax);
+			concaveMesh->processAllTriangles(&drawCallback,worldBoundsMin,worldBoundsMax);
+			m_numdrawcalls++;
+		}
 
 	}
 	glPopMatrix();
@@ -967,17 +1548,32 @@ GL_ShapeDrawer::GL_ShapeDrawer()
 	m_texturehandle			=	0;
 	m_textureenabled		=	false;
 	m_textureinitialized	=	false;
+	m_retainedmeshes		=	true;
+	m_drawdepth				=	0;
+	m_lodorigin.setValue(0,0,0);
+	m_statevalid			=	false;
+	m_appliedtexture		=	false;
+	m_colorvalid			=	false;
+	m_appliedcolor.setValue(0,0,0);
+	m_twosided				=	false;
+	m_cullface				=	false;
+	m_lighttwoside			=	0;
+	m_numdrawcalls			=	0;
+	m_numstatechanges		=	0;
+	setSilhouetteTolerance(btScalar(0.01));
+	m_maxsilhouettes		=	1024;
+	m_lruhead				=	0;
+	m_lrutail				=	0;
+	m_cachememory			=	0;
+	m_cachebudget			=	32*1024*1024;
 }
 
 GL_ShapeDrawer::~GL_ShapeDrawer()
 {
-	int i;
-	for (i=0;i<m_shapecaches.size();i++)
+	while (m_caches.size())
 	{
-		m_shapecaches[i]->~ShapeCache();
-		btAlignedFree(m_shapecaches[i]);
+		removeCache(*m_caches.getAtIndex(0));
 	}
-	m_shapecaches.clear();
 	if(m_textureinitialized)
 	{
 		glDeleteTextures(1,(const GLuint*) &m_texturehandle);
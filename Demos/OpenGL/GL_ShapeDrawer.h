@@ -16,8 +16,10 @@ subject to the following restrictions:
 #define GL_SHAPE_DRAWER_H
 
 class btCollisionShape;
+class btConcaveShape;
 class btShapeHull;
 #include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btHashMap.h"
 #include "LinearMath/btVector3.h"
 
 #include "BulletCollision/CollisionShapes/btShapeHull.h"
@@ -26,29 +28,152 @@ class btShapeHull;
 class GL_ShapeDrawer
 {
 protected:
-	struct ShapeCache
+	///render data kept per collision shape, in a side table with least recently used order
+	struct CacheEntry
+	{
+	CacheEntry(const btCollisionShape* s) : m_shape(s),m_lruprev(0),m_lrunext(0),m_memory(0) {}
+	virtual ~CacheEntry() {}
+	///bytes used by the entry, including its arrays
+	virtual size_t			computeMemory() const=0;
+	const btCollisionShape*	m_shape;
+	CacheEntry*				m_lruprev;
+	CacheEntry*				m_lrunext;
+	size_t					m_memory;
+	};
+	///light direction in shape space, quantized to the silhouette tolerance
+	struct SilhouetteKey
+	{
+	int		m_direction[3];
+	unsigned int	getHash() const
+	{
+		//unsigned, the components are negative for half the directions and the products overflow
+		return((unsigned int)m_direction[0]*73856093u^(unsigned int)m_direction[1]*19349663u^(unsigned int)m_direction[2]*83492791u);
+	}
+	bool	equals(const SilhouetteKey& other) const
+	{
+		return(m_direction[0]==other.m_direction[0]&&m_direction[1]==other.m_direction[1]&&m_direction[2]==other.m_direction[2]);
+	}
+	};
+	///shadow volume quads of the hull silhouette for one light direction (GL_V3F)
+	struct Silhouette
+	{
+	SilhouetteKey				m_key;
+	Silhouette*					m_lruprev;
+	Silhouette*					m_lrunext;
+	btVector3					m_direction;
+	btVector3					m_extrusion;
+	btAlignedObjectArray<float>	m_quads;
+	};
+	struct ShapeCache : public CacheEntry
 	{
 	struct Edge { btVector3 n[2];int v[2]; };
-	ShapeCache(btConvexShape* s) : m_shapehull(s) {}
+	ShapeCache(btConvexShape* s) : CacheEntry(s),m_shapehull(s),m_silhouettehead(0),m_silhouettetail(0),m_meshbuilt(false) {}
+	virtual ~ShapeCache() { clearSilhouettes(); }
 	btShapeHull					m_shapehull;
 	btAlignedObjectArray<Edge>	m_edges;
+	///silhouettes of recently seen light directions, objects that share the shape see it from different sides
+	btHashMap<SilhouetteKey,Silhouette*>	m_silhouettes;
+	//most recently drawn first
+	Silhouette*							m_silhouettehead;
+	Silhouette*							m_silhouettetail;
+	void	clearSilhouettes();
+	///move a silhouette to the front of the drawn order, or insert a new one there
+	void	touchSilhouette(Silhouette* sil,bool linked);
+	///drop the least recently drawn silhouette
+	void	evictSilhouette();
+	///retained triangle mesh, interleaved normal and position (GL_N3F_V3F), built on first draw
+	btAlignedObjectArray<float>			m_vertices;
+	btAlignedObjectArray<unsigned int>	m_indices;
+	bool								m_meshbuilt;
+	int		addVertex(const btVector3& n,const btVector3& v);
+	virtual size_t	computeMemory() const;
 	};
-	//clean-up memory of dynamically created shape hulls
-	btAlignedObjectArray<ShapeCache*>	m_shapecaches;
+	///triangles of a static concave mesh, sorted into a grid of chunks with their own bounds
+	struct MeshChunk
+	{
+	btVector3	m_aabbMin;
+	btVector3	m_aabbMax;
+	int			m_firstvertex;
+	int			m_numvertices;
+	};
+	struct ConcaveCache : public CacheEntry
+	{
+	ConcaveCache(const btConcaveShape* s) : CacheEntry(s) {}
+	///every triangle once with its face normal (GL_N3F_V3F), chunk after chunk. Drawn two sided.
+	btAlignedObjectArray<float>			m_vertices;
+	btAlignedObjectArray<MeshChunk>		m_chunks;
+	virtual size_t	computeMemory() const;
+	};
+	//side table of the cache entries, the collision shapes are not touched
+	btHashMap<btHashPtr,CacheEntry*>	m_caches;
+	//most recently used first
+	CacheEntry*							m_lruhead;
+	CacheEntry*							m_lrutail;
+	size_t								m_cachememory;
+	size_t								m_cachebudget;
 	unsigned int						m_texturehandle;
 	bool								m_textureenabled;
 	bool								m_textureinitialized;
+	bool								m_retainedmeshes;
+	///nesting of drawOpenGL calls, and the position of the outermost object for the level of detail
+	int									m_drawdepth;
+	btVector3							m_lodorigin;
+	///GL state set by prepareTexturing and the last color, valid until invalidateState
+	bool								m_statevalid;
+	bool								m_appliedtexture;
+	bool								m_colorvalid;
+	btVector3							m_appliedcolor;
+	///culling off and two sided lighting for the concave chunks, with the values they replaced
+	bool								m_twosided;
+	bool								m_cullface;
+	int									m_lighttwoside;
+	int									m_numdrawcalls;
+	int									m_numstatechanges;
+	///cosine of the largest angle between light directions that share a silhouette
+	btScalar							m_silhouettecos;
+	btScalar							m_silhouettetolerance;
+	int									m_maxsilhouettes;
+	///scratch arrays of drawInstances, interleaved texture coordinate, color, normal and position (GL_T2F_C4F_N3F_V3F)
+	btAlignedObjectArray<float>			m_batchvertices;
+	btAlignedObjectArray<unsigned int>	m_batchindices;
 	
 
 	ShapeCache*							cache(btConvexShape*);
+	CacheEntry*							findCache(const btCollisionShape* shape);
+	void								addCache(CacheEntry* entry);
+	void								removeCache(CacheEntry* entry);
+	void								updateCacheMemory(CacheEntry* entry);
+	static void							buildEdges(const unsigned int* indices,int numIndices,const btVector3* vertices,btAlignedObjectArray<ShapeCache::Edge>& edges);
+	const Silhouette*					silhouette(ShapeCache* sc,const btVector3& extrusion);
+	void								buildMesh(ShapeCache* sc,const btConvexShape* shape);
+	void								drawMesh(const ShapeCache* sc);
+	static bool							isUnitShape(int shapetype);
+	static bool							canRetainConcave(const btCollisionShape* shape);
+	ConcaveCache*						concaveCache(const btConcaveShape* shape);
+	void								drawConcaveChunks(const ConcaveCache* cc,const btVector3& boundsMin,const btVector3& boundsMax);
+	void								prepareTexturing();
+	void								applyColor(const btVector3& color);
+	void								applyTwoSided(bool twosided);
 
 public:
+		///one object of a drawInstances batch, m_transform is an OpenGL matrix like the one passed to drawOpenGL
+		struct ShapeInstance
+		{
+			btScalar				m_transform[16];
+			btVector3				m_color;
+			const btCollisionShape*	m_shape;
+		};
+
 		GL_ShapeDrawer();
 
 		virtual ~GL_ShapeDrawer();
 
-		///drawOpenGL might allocate temporary memoty, stores pointer in shape userpointer
+		///drawOpenGL caches render data per shape in a side table, see invalidateShape
 		virtual void		drawOpenGL(btScalar* m, const btCollisionShape* shape, const btVector3& color,int	debugMode,const btVector3& worldBoundsMin,const btVector3& worldBoundsMax);
+		///canDrawInstanced returns true for the shapes that drawInstances supports for the given debug mode
+		bool				canDrawInstanced(const btCollisionShape* shape,int debugMode) const;
+		///drawInstances draws objects that share one collision shape with a single call, vertices are transformed on the CPU
+		virtual void		drawInstances(const ShapeInstance* instances,int numInstances);
 		virtual void		drawShadow(btScalar* m, const btVector3& extrusion,const btCollisionShape* shape,const btVector3& worldBoundsMin,const btVector3& worldBoundsMax);
 		
 		bool		enableTexture(bool enable) { bool p=m_textureenabled;m_textureenabled=enable;return(p); }
@@ -56,13 +181,92 @@ public:
 		{
 			return m_textureenabled;
 		}
+		///retained meshes draw box, polyhedral and hull shapes from cached vertex arrays with a single call,
+		///instead of emitting every triangle in immediate mode. Static triangle meshes and heightfields are
+		///cached in spatial chunks, and only the chunks that overlap the draw bounds are drawn.
+		bool		enableRetainedMeshes(bool enable) { bool p=m_retainedmeshes;m_retainedmeshes=enable;return(p); }
+		bool		hasRetainedMeshesEnabled() const
+		{
+			return m_retainedmeshes;
+		}
 		
-		static void		drawCylinder(float radius,float halfHeight, int upAxis);
+		///drawShadow reuses the silhouette of a shape while the light direction in shape space changes less
+		///than this angle (in radians), the volume is still extruded along the current direction
+		void			setSilhouetteTolerance(btScalar angle);
+		btScalar		getSilhouetteTolerance() const
+		{
+			return m_silhouettetolerance;
+		}
+		///silhouettes kept per shape, the least recently drawn one is replaced when they are all in use.
+		///Keep it above the number of visible objects that share a shape, or their silhouettes replace each other.
+		void			setMaxSilhouettesPerShape(int count)
+		{
+			m_maxsilhouettes=btMax(count,1);
+		}
+		int				getMaxSilhouettesPerShape() const
+		{
+			return m_maxsilhouettes;
+		}
+
+		///getStateKey groups shapes that are drawn with the same GL state, for sorting draw submissions.
+		///Instanced batches come first, then retained meshes, then the immediate mode shapes by shape type.
+		unsigned int	getStateKey(const btCollisionShape* shape,int debugMode) const;
+		///the GL state can't be trusted anymore, for example after other code has drawn. It is reapplied on the next draw.
+		void			invalidateState()
+		{
+			m_statevalid=false;
+			m_colorvalid=false;
+			m_twosided=false;
+		}
+		///puts back the culling and light model that the concave chunks changed, before other code draws
+		void			restoreState()
+		{
+			applyTwoSided(false);
+		}
+		///draw calls and state changes since the last resetStatistics
+		int				getNumDrawCalls() const
+		{
+			return m_numdrawcalls;
+		}
+		int				getNumStateChanges() const
+		{
+			return m_numstatechanges;
+		}
+		void			resetStatistics()
+		{
+			m_numdrawcalls=0;
+			m_numstatechanges=0;
+		}
+
+		///forget the cached render data of a shape, call it before the shape is deleted
+		void			invalidateShape(const btCollisionShape* shape);
+		///cached render data is evicted in least recently used order once it uses more than this, 0 means no limit.
+		///Evicted entries are rebuilt when their shape is drawn again.
+		void			setCacheMemoryBudget(size_t bytes);
+		size_t			getCacheMemoryBudget() const
+		{
+			return m_cachebudget;
+		}
+		size_t			getCacheMemoryUsage() const
+		{
+			return m_cachememory;
+		}
+		int				getNumCachedShapes() const
+		{
+			return m_caches.size();
+		}
+
+		///drawCylinder and drawCone scale the unit shapes, with the level of detail of their bounding sphere
+		void			drawCylinder(float radius,float halfHeight, int upAxis);
+		///cone centered at the origin, like btConeShape
+		void			drawCone(float radius,float height, int upAxis);
+		///drawSphere draws a scaled unit sphere, see GL_UnitShapes for the level of detail
 		void			drawSphere(btScalar r, int lats, int longs);
 		static void		drawCoordSystem();
 		
 };
 
+///deprecated, triangle meshes are retained by GL_ShapeDrawer itself. These do nothing.
 void OGL_displaylist_register_shape(btCollisionShape * shape);
 void OGL_displaylist_clean();
 
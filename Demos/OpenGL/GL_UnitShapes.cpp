@@ -0,0 +1,209 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifdef _WIN32 //needed for glut.h
+#include <windows.h>
+#endif
+#include "GlutStuff.h"
+#include "GL_UnitShapes.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+///interleaved normal and position (GL_N3F_V3F) and triangle indices
+struct UnitMesh
+{
+	btAlignedObjectArray<float>			m_vertices;
+	btAlignedObjectArray<unsigned int>	m_indices;
+
+	unsigned int	addVertex(const btVector3& n,const btVector3& v)
+	{
+		const unsigned int index = m_vertices.size()/6;
+		m_vertices.push_back(float(n.getX()));
+		m_vertices.push_back(float(n.getY()));
+		m_vertices.push_back(float(n.getZ()));
+		m_vertices.push_back(float(v.getX()));
+		m_vertices.push_back(float(v.getY()));
+		m_vertices.push_back(float(v.getZ()));
+		return index;
+	}
+
+	void	addTriangle(unsigned int a,unsigned int b,unsigned int c)
+	{
+		m_indices.push_back(a);
+		m_indices.push_back(b);
+		m_indices.push_back(c);
+	}
+
+	void	draw() const
+	{
+		if (!m_indices.size())
+			return;
+		glInterleavedArrays(GL_N3F_V3F,0,&m_vertices[0]);
+		glDrawElements(GL_TRIANGLES,m_indices.size(),GL_UNSIGNED_INT,&m_indices[0]);
+		glDisableClientState(GL_NORMAL_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+	}
+};
+
+///latitude bands and slices of each level of detail
+static const int	sLodLats[GL_UnitShapes::NUM_LODS] = {4,6,10,16};
+static const int	sLodSlices[GL_UnitShapes::NUM_LODS] = {6,10,16,28};
+///a shape moves to the next level once its projected radius reaches this many pixels
+static const float	sLodPixels[GL_UnitShapes::NUM_LODS-1] = {6.f,20.f,60.f};
+
+static UnitMesh		sSpheres[GL_UnitShapes::NUM_LODS];
+static UnitMesh		sCylinders[GL_UnitShapes::NUM_LODS];
+static UnitMesh		sCones[GL_UnitShapes::NUM_LODS];
+
+static btVector3	sViewEye(0,0,0);
+static btScalar		sViewPixelsPerUnit = 0.f;
+static bool			sViewPerspective = true;
+
+static int	clampLod(int lod)
+{
+	return lod<0 ? 0 : (lod>=GL_UnitShapes::NUM_LODS ? GL_UnitShapes::NUM_LODS-1 : lod);
+}
+
+static void	buildSphere(UnitMesh& mesh,int lats,int longs)
+{
+	for (int i=0;i<=lats;i++)
+	{
+		const btScalar lat = SIMD_PI*(btScalar(-0.5)+btScalar(i)/btScalar(lats));
+		const btScalar z = btSin(lat);
+		const btScalar r = btCos(lat);
+		for (int j=0;j<=longs;j++)
+		{
+			const btScalar lng = SIMD_2_PI*btScalar(j)/btScalar(longs);
+			const btVector3 v(r*btCos(lng),r*btSin(lng),z);
+			mesh.addVertex(v,v);
+		}
+	}
+	const unsigned int row = longs+1;
+	for (int i=0;i<lats;i++)
+	{
+		for (int j=0;j<longs;j++)
+		{
+			const unsigned int a = i*row+j;
+			mesh.addTriangle(a,a+1,a+row);
+			mesh.addTriangle(a+row,a+1,a+row+1);
+		}
+	}
+}
+
+static void	buildCylinder(UnitMesh& mesh,int slices)
+{
+	const btVector3 up(0,0,1);
+	const unsigned int topCenter = mesh.addVertex(up,up);
+	const unsigned int bottomCenter = mesh.addVertex(-up,-up);
+	for (int j=0;j<slices;j++)
+	{
+		const btScalar a0 = SIMD_2_PI*btScalar(j)/btScalar(slices);
+		const btScalar a1 = SIMD_2_PI*btScalar(j+1)/btScalar(slices);
+		const btVector3 n0(btCos(a0),btSin(a0),0);
+		const btVector3 n1(btCos(a1),btSin(a1),0);
+
+		const unsigned int b0 = mesh.addVertex(n0,n0-up);
+		const unsigned int b1 = mesh.addVertex(n1,n1-up);
+		const unsigned int t0 = mesh.addVertex(n0,n0+up);
+		const unsigned int t1 = mesh.addVertex(n1,n1+up);
+		mesh.addTriangle(b0,b1,t0);
+		mesh.addTriangle(t0,b1,t1);
+
+		mesh.addTriangle(topCenter,mesh.addVertex(up,n0+up),mesh.addVertex(up,n1+up));
+		mesh.addTriangle(bottomCenter,mesh.addVertex(-up,n1-up),mesh.addVertex(-up,n0-up));
+	}
+}
+
+static void	buildCone(UnitMesh& mesh,int slices)
+{
+	const btVector3 up(0,0,1);
+	const unsigned int baseCenter = mesh.addVertex(-up,btVector3(0,0,0));
+	for (int j=0;j<slices;j++)
+	{
+		const btScalar a0 = SIMD_2_PI*btScalar(j)/btScalar(slices);
+		const btScalar a1 = SIMD_2_PI*btScalar(j+1)/btScalar(slices);
+		const btScalar am = (a0+a1)*btScalar(0.5);
+		const btVector3 p0(btCos(a0),btSin(a0),0);
+		const btVector3 p1(btCos(a1),btSin(a1),0);
+		///radius and height are 1, so the side normals lean 45 degrees up
+		const btVector3 n0 = (p0+up).normalized();
+		const btVector3 n1 = (p1+up).normalized();
+		const btVector3 nm = (btVector3(btCos(am),btSin(am),0)+up).normalized();
+
+		mesh.addTriangle(mesh.addVertex(n0,p0),mesh.addVertex(n1,p1),mesh.addVertex(nm,up));
+		mesh.addTriangle(baseCenter,mesh.addVertex(-up,p1),mesh.addVertex(-up,p0));
+	}
+}
+
+void	GL_UnitShapes::drawSphere(int lod)
+{
+	lod = clampLod(lod);
+	UnitMesh& mesh = sSpheres[lod];
+	if (!mesh.m_indices.size())
+		buildSphere(mesh,sLodLats[lod],sLodSlices[lod]);
+	mesh.draw();
+}
+
+void	GL_UnitShapes::drawCylinder(int lod)
+{
+	lod = clampLod(lod);
+	UnitMesh& mesh = sCylinders[lod];
+	if (!mesh.m_indices.size())
+		buildCylinder(mesh,sLodSlices[lod]);
+	mesh.draw();
+}
+
+void	GL_UnitShapes::drawCone(int lod)
+{
+	lod = clampLod(lod);
+	UnitMesh& mesh = sCones[lod];
+	if (!mesh.m_indices.size())
+		buildCone(mesh,sLodSlices[lod]);
+	mesh.draw();
+}
+
+void	GL_UnitShapes::setView(const btVector3& eye,btScalar pixelsPerUnit,bool perspective)
+{
+	sViewEye = eye;
+	sViewPixelsPerUnit = pixelsPerUnit;
+	sViewPerspective = perspective;
+}
+
+int	GL_UnitShapes::selectLod(const btVector3& center,btScalar radius,int defaultLod)
+{
+	if (sViewPixelsPerUnit <= btScalar(0.))
+		return clampLod(defaultLod);
+
+	btScalar pixels = radius*sViewPixelsPerUnit;
+	if (sViewPerspective)
+	{
+		const btScalar distance = (center-sViewEye).length();
+		///the eye is inside the shape
+		if (distance <= radius)
+			return NUM_LODS-1;
+		pixels /= distance;
+	}
+	int lod = 0;
+	while (lod < NUM_LODS-1 && pixels >= sLodPixels[lod])
+		lod++;
+	return lod;
+}
+
+int	GL_UnitShapes::getSphereLod(int lats)
+{
+	int lod = 0;
+	while (lod < NUM_LODS-1 && sLodLats[lod] < lats)
+		lod++;
+	return lod;
+}
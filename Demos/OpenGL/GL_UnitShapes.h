@@ -0,0 +1,50 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef GL_UNIT_SHAPES_H
+#define GL_UNIT_SHAPES_H
+
+#include "LinearMath/btVector3.h"
+
+///GL_UnitShapes draws a unit sphere, cylinder and cone from vertex arrays that are tessellated once, at
+///NUM_LODS levels of detail. The caller scales them with the modelview matrix, GL_NORMALIZE keeps the
+///lighting right. The level of detail follows the projected size of the shape, from the view of the frame.
+class GL_UnitShapes
+{
+public:
+
+	enum
+	{
+		NUM_LODS = 4
+	};
+
+	///sphere of radius 1 around the origin
+	static void	drawSphere(int lod);
+	///cylinder of radius 1 along the z axis, from z=-1 to z=1, with caps
+	static void	drawCylinder(int lod);
+	///cone of radius 1 along the z axis, base at z=0 and apex at z=1 (like glutSolidCone)
+	static void	drawCone(int lod);
+
+	///set once per frame. pixelsPerUnit is the projected size in pixels of one unit at distance 1 (perspective)
+	///or at any distance (orthographic). 0 disables the selection from the projected size.
+	static void	setView(const btVector3& eye,btScalar pixelsPerUnit,bool perspective);
+
+	///level of detail for a shape with the given bounding radius at center, or defaultLod without a view
+	static int	selectLod(const btVector3& center,btScalar radius,int defaultLod);
+
+	///the level whose sphere is closest to lats latitude bands
+	static int	getSphereLod(int lats);
+};
+
+#endif //GL_UNIT_SHAPES_H
@@ -4,6 +4,8 @@
 #include "GlutDemoApplication.h"
 
 #include "GlutStuff.h"
+#include "GLDebugFont.h"
+#include "ProjectilePool.h"
 
 #include "BulletDynamics/Dynamics/btDiscreteDynamicsWorld.h"
 #include "BulletDynamics/Dynamics/btRigidBody.h"
@@ -48,6 +50,8 @@ void GlutDemoApplication::specialKeyboard(int key, int x, int y)
 			{
 				btCollisionObject* obj = getDynamicsWorld()->getCollisionObjectArray()[numObj-1];
 
+				if (getProjectilePool())
+					getProjectilePool()->removeBody(obj);
 				getDynamicsWorld()->removeCollisionObject(obj);
 				btRigidBody* body = btRigidBody::upcast(obj);
 				if (body && body->getMotionState())
@@ -78,6 +82,9 @@ void GlutDemoApplication::specialKeyboard(int key, int x, int y)
 
 void GlutDemoApplication::swapBuffers()
 {
+	//text queued after the profile display, like the dialog and replay status lines
+	GLDebugFlushStrings();
+	captureFrame();
 	glutSwapBuffers();
 
 }
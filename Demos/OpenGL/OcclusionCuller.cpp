@@ -0,0 +1,318 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "OcclusionCuller.h"
+#include "FrustumCuller.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+#include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.h"
+#include "BulletCollision/CollisionShapes/btBoxShape.h"
+#include "LinearMath/btQuickprof.h"
+
+///points closer to the eye than this (in clip space w) can't be projected
+static const btScalar	sMinClipW = btScalar(0.0001);
+
+///candidate occluder, sorted by projected size
+struct OccluderCandidate
+{
+	const btCollisionObject*	m_object;
+	btScalar					m_pixels;
+};
+
+struct OccluderCandidateSortPredicate
+{
+	bool operator() ( const OccluderCandidate& a, const OccluderCandidate& b ) const
+	{
+		return a.m_pixels > b.m_pixels;
+	}
+};
+
+///descends into the tree nodes that are not hidden, and adds the client objects of the leaves
+struct OcclusionCullCallback : public btDbvt::ICollide
+{
+	OcclusionCuller*			m_culler;
+	btHashMap<btHashPtr,int>&	m_visible;
+
+	OcclusionCullCallback(OcclusionCuller* culler,btHashMap<btHashPtr,int>& visible)
+		:m_culler(culler),
+		m_visible(visible)
+	{
+	}
+
+	virtual bool	Descent(const btDbvtNode* node)
+	{
+		return !m_culler->isAabbOccluded(node->volume.Mins(),node->volume.Maxs());
+	}
+
+	virtual void	Process(const btDbvtNode* leaf)
+	{
+		const btDbvtProxy* proxy = (const btDbvtProxy*)leaf->data;
+		m_visible.insert(btHashPtr(proxy->m_clientObject),1);
+	}
+};
+
+OcclusionCuller::OcclusionCuller(int width,int height)
+:m_width(width),
+m_height(height),
+m_minOccluderPixels(btScalar(16.)),
+m_maxOccluders(32),
+m_dbvtBroadphase(0),
+m_valid(false),
+m_numOccluders(0),
+m_numNodeTests(0)
+{
+	m_depth.resize(width*height);
+	for (int i=0;i<16;i++)
+		m_clip[i] = btScalar(0.);
+}
+
+bool	OcclusionCuller::project(const btVector3& point,btScalar& x,btScalar& y,btScalar& z) const
+{
+	const btScalar* c = m_clip;
+	const btScalar w = c[3]*point.getX()+c[7]*point.getY()+c[11]*point.getZ()+c[15];
+	if (w < sMinClipW)
+		return false;
+	const btScalar invW = btScalar(1.)/w;
+	x = ((c[0]*point.getX()+c[4]*point.getY()+c[8]*point.getZ()+c[12])*invW*btScalar(0.5)+btScalar(0.5))*btScalar(m_width);
+	y = ((c[1]*point.getX()+c[5]*point.getY()+c[9]*point.getZ()+c[13])*invW*btScalar(0.5)+btScalar(0.5))*btScalar(m_height);
+	z = (c[2]*point.getX()+c[6]*point.getY()+c[10]*point.getZ()+c[14])*invW;
+	return true;
+}
+
+///rasterizeQuad writes the texels that the convex quad covers completely, with the farthest depth of each texel
+void	OcclusionCuller::rasterizeQuad(const btScalar* x,const btScalar* y,const btScalar* z)
+{
+	btScalar area = 0.f;
+	for (int i=0;i<4;i++)
+	{
+		const int j = (i+1)&3;
+		area += x[i]*y[j]-x[j]*y[i];
+	}
+	if (btFabs(area) < btScalar(0.0001))
+		return;
+	const btScalar sign = area > 0.f ? btScalar(1.) : btScalar(-1.);
+
+	///depth plane z = z0 + a*(x-x0) + b*(y-y0), from the larger of the two triangles at vertex 0
+	int i1 = 1,i2 = 2;
+	btScalar det = (x[1]-x[0])*(y[2]-y[0])-(x[2]-x[0])*(y[1]-y[0]);
+	const btScalar det2 = (x[2]-x[0])*(y[3]-y[0])-(x[3]-x[0])*(y[2]-y[0]);
+	if (btFabs(det2) > btFabs(det))
+	{
+		i1 = 2;i2 = 3;det = det2;
+	}
+	if (btFabs(det) < btScalar(0.0001))
+		return;
+	const btScalar a = ((z[i1]-z[0])*(y[i2]-y[0])-(z[i2]-z[0])*(y[i1]-y[0]))/det;
+	const btScalar b = ((x[i1]-x[0])*(z[i2]-z[0])-(x[i2]-x[0])*(z[i1]-z[0]))/det;
+
+	btScalar minX = x[0],maxX = x[0],minY = y[0],maxY = y[0];
+	for (int i=1;i<4;i++)
+	{
+		minX = btMin(minX,x[i]);maxX = btMax(maxX,x[i]);
+		minY = btMin(minY,y[i]);maxY = btMax(maxY,y[i]);
+	}
+	///texel corners are at integer coordinates
+	const int gx0 = btMax(0,(int)btCeil(minX)),gx1 = btMin(m_width,(int)floor(maxX));
+	const int gy0 = btMax(0,(int)btCeil(minY)),gy1 = btMin(m_height,(int)floor(maxY));
+	if (gx1-gx0 < 1 || gy1-gy0 < 1)
+		return;
+
+	const int gridWidth = gx1-gx0+1;
+	m_cornerInside.resize(gridWidth*(gy1-gy0+1));
+	for (int gy=gy0;gy<=gy1;gy++)
+	{
+		for (int gx=gx0;gx<=gx1;gx++)
+		{
+			bool inside = true;
+			for (int i=0;i<4 && inside;i++)
+			{
+				const int j = (i+1)&3;
+				const btScalar edge = (x[j]-x[i])*(btScalar(gy)-y[i])-(y[j]-y[i])*(btScalar(gx)-x[i]);
+				inside = edge*sign >= btScalar(0.);
+			}
+			m_cornerInside[(gy-gy0)*gridWidth+gx-gx0] = inside ? 1 : 0;
+		}
+	}
+
+	for (int ty=gy0;ty<gy1;ty++)
+	{
+		const unsigned char* row0 = &m_cornerInside[(ty-gy0)*gridWidth-gx0];
+		const unsigned char* row1 = row0+gridWidth;
+		for (int tx=gx0;tx<gx1;tx++)
+		{
+			if (!(row0[tx] && row0[tx+1] && row1[tx] && row1[tx+1]))
+				continue;
+			///the plane is linear, so the farthest depth of the texel is at one of its corners
+			const btScalar z00 = z[0]+a*(btScalar(tx)-x[0])+b*(btScalar(ty)-y[0]);
+			const btScalar depth = z00+btMax(a,btScalar(0.))+btMax(b,btScalar(0.));
+			float& texel = m_depth[ty*m_width+tx];
+			if (depth < texel)
+				texel = float(depth);
+		}
+	}
+}
+
+void	OcclusionCuller::rasterizeBox(const btCollisionObject* colObj)
+{
+	const btBoxShape* box = (const btBoxShape*)colObj->getCollisionShape();
+	const btVector3 halfExtents = box->getHalfExtentsWithMargin();
+	const btTransform& trans = colObj->getWorldTransform();
+
+	btScalar cornerX[8],cornerY[8],cornerZ[8];
+	bool projected[8];
+	for (int i=0;i<8;i++)
+	{
+		const btVector3 local((i&1) ? halfExtents.getX() : -halfExtents.getX(),
+			(i&2) ? halfExtents.getY() : -halfExtents.getY(),
+			(i&4) ? halfExtents.getZ() : -halfExtents.getZ());
+		projected[i] = project(trans(local),cornerX[i],cornerY[i],cornerZ[i]);
+	}
+
+	///corner numbers use bit 0 for x, bit 1 for y and bit 2 for z
+	static const int faces[6][4] = {{0,2,6,4},{1,3,7,5},{0,1,5,4},{2,3,7,6},{0,1,3,2},{4,5,7,6}};
+	for (int f=0;f<6;f++)
+	{
+		btScalar x[4],y[4],z[4];
+		bool valid = true;
+		for (int i=0;i<4;i++)
+		{
+			const int c = faces[f][i];
+			valid = valid && projected[c];
+			x[i] = cornerX[c];y[i] = cornerY[c];z[i] = cornerZ[c];
+		}
+		///faces crossing the near plane are left out, that only makes the occluder smaller
+		if (valid)
+			rasterizeQuad(x,y,z);
+	}
+}
+
+bool	OcclusionCuller::isAabbOccluded(const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	if (!m_numOccluders)
+		return false;
+	m_numNodeTests++;
+
+	btScalar minX = BT_LARGE_FLOAT,maxX = -BT_LARGE_FLOAT,minY = BT_LARGE_FLOAT,maxY = -BT_LARGE_FLOAT,minZ = BT_LARGE_FLOAT;
+	for (int i=0;i<8;i++)
+	{
+		const btVector3 corner((i&1) ? aabbMax.getX() : aabbMin.getX(),
+			(i&2) ? aabbMax.getY() : aabbMin.getY(),
+			(i&4) ? aabbMax.getZ() : aabbMin.getZ());
+		btScalar x,y,z;
+		if (!project(corner,x,y,z))
+			return false;
+		minX = btMin(minX,x);maxX = btMax(maxX,x);
+		minY = btMin(minY,y);maxY = btMax(maxY,y);
+		minZ = btMin(minZ,z);
+	}
+
+	const int x0 = btMax(0,(int)floor(minX)),x1 = btMin(m_width,(int)btCeil(maxX));
+	const int y0 = btMax(0,(int)floor(minY)),y1 = btMin(m_height,(int)btCeil(maxY));
+	///outside of the view, that is for the frustum culling to decide
+	if (x0 >= x1 || y0 >= y1)
+		return false;
+
+	for (int ty=y0;ty<y1;ty++)
+	{
+		const float* row = &m_depth[ty*m_width];
+		for (int tx=x0;tx<x1;tx++)
+		{
+			if (row[tx] >= minZ)
+				return false;
+		}
+	}
+	return true;
+}
+
+void	OcclusionCuller::cullObjects(btCollisionWorld* world,const FrustumCuller& frustum,const btScalar* projectionMatrix,const btScalar* modelviewMatrix)
+{
+	BT_PROFILE("occlusionCull");
+	m_visibleObjects.clear();
+	m_numOccluders = 0;
+	m_numNodeTests = 0;
+	m_valid = true;
+
+	///clip = projection*modelview, both column major
+	for (int column=0;column<4;column++)
+	{
+		for (int row=0;row<4;row++)
+		{
+			btScalar sum = 0.f;
+			for (int k=0;k<4;k++)
+				sum += projectionMatrix[k*4+row]*modelviewMatrix[column*4+k];
+			m_clip[column*4+row] = sum;
+		}
+	}
+	for (int i=0;i<m_depth.size();i++)
+		m_depth[i] = 1.f;
+
+	///the largest static boxes in view are the occluders
+	btAlignedObjectArray<OccluderCandidate> candidates;
+	for (int i=0;i<world->getNumCollisionObjects();i++)
+	{
+		const btCollisionObject* colObj = world->getCollisionObjectArray()[i];
+		if (!colObj->isStaticObject() || colObj->getCollisionShape()->getShapeType() != BOX_SHAPE_PROXYTYPE || !frustum.isVisible(colObj))
+			continue;
+		const btVector3& center = colObj->getWorldTransform().getOrigin();
+		const btScalar w = m_clip[3]*center.getX()+m_clip[7]*center.getY()+m_clip[11]*center.getZ()+m_clip[15];
+		if (w < sMinClipW)
+			continue;
+		const btScalar radius = ((const btBoxShape*)colObj->getCollisionShape())->getHalfExtentsWithMargin().length();
+		const btScalar pixels = radius*btFabs(projectionMatrix[5])/w*btScalar(0.5)*btScalar(m_height);
+		if (pixels < m_minOccluderPixels)
+			continue;
+		OccluderCandidate& candidate = candidates.expand();
+		candidate.m_object = colObj;
+		candidate.m_pixels = pixels;
+	}
+	candidates.quickSort(OccluderCandidateSortPredicate());
+	for (int i=0;i<candidates.size() && i<m_maxOccluders;i++)
+	{
+		rasterizeBox(candidates[i].m_object);
+		m_numOccluders++;
+	}
+
+	const btVector3* normals = frustum.getPlaneNormals();
+	const btScalar* offsets = frustum.getPlaneOffsets();
+	if (m_dbvtBroadphase && (btBroadphaseInterface*)m_dbvtBroadphase == world->getBroadphase())
+	{
+		///front to back along the view direction, the eye looks along -z in eye space
+		const btVector3 viewDirection(-modelviewMatrix[2],-modelviewMatrix[6],-modelviewMatrix[10]);
+		OcclusionCullCallback callback(this,m_visibleObjects);
+		for (int i=0;i<2;i++)
+		{
+			if (m_dbvtBroadphase->m_sets[i].m_root)
+				btDbvt::collideOCL(m_dbvtBroadphase->m_sets[i].m_root,normals,offsets,viewDirection,6,callback);
+		}
+		return;
+	}
+
+	for (int i=0;i<world->getNumCollisionObjects();i++)
+	{
+		btCollisionObject* colObj = world->getCollisionObjectArray()[i];
+		if (!frustum.isVisible(colObj))
+			continue;
+		btVector3 aabbMin,aabbMax;
+		if (colObj->getBroadphaseHandle())
+		{
+			aabbMin = colObj->getBroadphaseHandle()->m_aabbMin;
+			aabbMax = colObj->getBroadphaseHandle()->m_aabbMax;
+		} else
+		{
+			colObj->getCollisionShape()->getAabb(colObj->getWorldTransform(),aabbMin,aabbMax);
+		}
+		if (!isAabbOccluded(aabbMin,aabbMax))
+			m_visibleObjects.insert(btHashPtr(colObj),1);
+	}
+}
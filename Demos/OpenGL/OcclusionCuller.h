@@ -0,0 +1,119 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btHashMap.h"
+#include "LinearMath/btVector3.h"
+
+class btCollisionObject;
+class btCollisionWorld;
+class btDbvtBroadphase;
+class FrustumCuller;
+
+///OcclusionCuller rejects objects that are hidden behind large static boxes, entirely on the CPU.
+///The front faces of the biggest static box shapes in view are rasterized into a small depth buffer. Then the
+///btDbvtBroadphase trees are walked front to back with btDbvt::collideOCL, and a subtree is skipped as soon as
+///the screen rectangle of its AABB is covered by occluders that are all closer than its nearest corner.
+///Only texels that an occluder face covers completely are written, with the farthest depth of the texel,
+///so an object is never culled by mistake; at worst some hidden objects are drawn.
+class OcclusionCuller
+{
+	int		m_width;
+	int		m_height;
+	///normalized device depth per texel, 1 is the far plane
+	btAlignedObjectArray<float>			m_depth;
+	///scratch inside flags of the texel corners of one face
+	btAlignedObjectArray<unsigned char>	m_cornerInside;
+	btScalar	m_clip[16];
+
+	btScalar	m_minOccluderPixels;
+	int			m_maxOccluders;
+	btDbvtBroadphase*	m_dbvtBroadphase;
+	bool		m_valid;
+
+	btHashMap<btHashPtr,int>	m_visibleObjects;
+	int		m_numOccluders;
+	int		m_numNodeTests;
+
+	///transform to screen (texels) and normalized depth, returns false for points at or behind the eye
+	bool	project(const btVector3& point,btScalar& x,btScalar& y,btScalar& z) const;
+	void	rasterizeQuad(const btScalar* x,const btScalar* y,const btScalar* z);
+	void	rasterizeBox(const btCollisionObject* colObj);
+
+public:
+
+	OcclusionCuller(int width=128,int height=64);
+
+	void	setDbvtBroadphase(btDbvtBroadphase* broadphase)
+	{
+		m_dbvtBroadphase = broadphase;
+	}
+
+	///rasterize the occluders and find the visible objects. The frustum culler must have been set up for the
+	///same projection and modelview matrices.
+	void	cullObjects(btCollisionWorld* world,const FrustumCuller& frustum,const btScalar* projectionMatrix,const btScalar* modelviewMatrix);
+
+	///is the AABB hidden by the occluders rasterized in the last cullObjects
+	bool	isAabbOccluded(const btVector3& aabbMin,const btVector3& aabbMax);
+
+	void	invalidate()
+	{
+		m_valid = false;
+		m_visibleObjects.clear();
+		m_numOccluders = 0;
+		m_numNodeTests = 0;
+	}
+
+	///objects in the frustum that are not visible according to the last cullObjects are occluded
+	bool	isVisible(const btCollisionObject* obj) const
+	{
+		return !m_valid || m_visibleObjects.find(btHashPtr(obj))!=0;
+	}
+
+	///static boxes whose projected bounding sphere radius is smaller than this many pixels are not rasterized
+	void	setMinOccluderSize(btScalar pixels)
+	{
+		m_minOccluderPixels = pixels;
+	}
+	void	setMaxOccluders(int maxOccluders)
+	{
+		m_maxOccluders = maxOccluders;
+	}
+
+	int		getNumOccluders() const
+	{
+		return m_numOccluders;
+	}
+	int		getNumNodeTests() const
+	{
+		return m_numNodeTests;
+	}
+	int		getWidth() const
+	{
+		return m_width;
+	}
+	int		getHeight() const
+	{
+		return m_height;
+	}
+	const float*	getDepthBuffer() const
+	{
+		return &m_depth[0];
+	}
+};
+
+#endif //OCCLUSION_CULLER_H
@@ -0,0 +1,274 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "ProfileHud.h"
+#include "GlutStuff.h"
+#include "GLDebugFont.h"
+#include "LinearMath/btScalar.h"
+#include <stdio.h>
+#include <string.h>
+
+///the text starts right of the sparklines, which are one pixel per sample wide
+static const int	sGraphSpacing = 8;
+///height of a sparkline inside its text line
+static const int	sGraphHeight = 12;
+
+ProfileHud::ProfileHud(int historySize)
+:m_historySize(historySize > 1 ? historySize : 2),
+m_head(0),
+m_numSamples(0),
+m_sampleRate(btScalar(10.)),
+m_dirty(true),
+m_lastParentTime(0.),
+m_lastFrameCount(0),
+m_lastTimeSinceReset(0.),
+m_pendingMin(0.f),
+m_pendingMax(0.f),
+m_pendingSum(0.f),
+m_pendingFrames(0),
+m_windowMin(0.f),
+m_windowAvg(0.f),
+m_windowMax(0.f),
+m_graphYIncr(0)
+{
+	m_frameMin.resize(m_historySize,0.f);
+	m_frameMax.resize(m_historySize,0.f);
+	m_frameSum.resize(m_historySize,0.f);
+	m_frameCount.resize(m_historySize,0);
+	m_headerText[0] = 0;
+	m_unaccountedText[0] = 0;
+	m_frameText[0] = 0;
+}
+
+void	ProfileHud::setSampleRate(btScalar samplesPerSecond)
+{
+	m_sampleRate = btMax(samplesPerSecond,btScalar(0.1));
+}
+
+void	ProfileHud::update(CProfileIterator* iterator,bool idle)
+{
+	if (idle)
+	{
+		m_frameClock.reset();
+	} else
+	{
+		const float frameTime = float(m_frameClock.getTimeMicroseconds())*0.001f;
+		m_frameClock.reset();
+		if (!m_pendingFrames)
+		{
+			m_pendingMin = frameTime;
+			m_pendingMax = frameTime;
+		}
+		m_pendingMin = btMin(m_pendingMin,frameTime);
+		m_pendingMax = btMax(m_pendingMax,frameTime);
+		m_pendingSum += frameTime;
+		m_pendingFrames++;
+	}
+
+	const double elapsed = double(m_sampleClock.getTimeMicroseconds())*0.001;
+	if (m_dirty || (!idle && elapsed >= 1000./double(m_sampleRate)))
+	{
+		m_sampleClock.reset();
+		sample(iterator,elapsed);
+	}
+}
+
+void	ProfileHud::sample(CProfileIterator* iterator,double elapsed)
+{
+#ifndef BT_NO_PROFILE
+	iterator->First();
+
+	if (m_dirty)
+	{
+		m_phases.clear();
+		m_head = 0;
+		m_numSamples = 0;
+	}
+
+	const double timeSinceReset = double(CProfileManager::Get_Time_Since_Reset());
+	const double parentTime = iterator->Is_Root() ? timeSinceReset : double(iterator->Get_Current_Parent_Total_Time());
+	const int frameCount = CProfileManager::Get_Frame_Count_Since_Reset();
+	///without a CProfileManager::Reset the time since reset grew by the elapsed time (1 ms of slack for the
+	///two clocks). stepSimulation resets the profiler, then the totals are those of the last step.
+	const bool restart = m_dirty || frameCount < m_lastFrameCount || timeSinceReset < m_lastTimeSinceReset+elapsed-1.;
+	if (restart)
+	{
+		m_lastParentTime = 0.;
+		m_lastFrameCount = 0;
+	}
+	m_lastTimeSinceReset = timeSinceReset;
+	m_dirty = false;
+
+	const double deltaParent = parentTime-m_lastParentTime;
+	const int deltaFrames = frameCount-m_lastFrameCount;
+	const double perFrame = deltaFrames > 0 ? 1./double(deltaFrames) : 0.;
+	m_lastParentTime = parentTime;
+	m_lastFrameCount = frameCount;
+
+	const int slot = m_head;
+	m_head = (m_head+1)%m_historySize;
+	m_numSamples = btMin(m_numSamples+1,m_historySize);
+
+	sprintf(m_headerText,"--- Profiling: %s (%.3f ms / frame, %d frames in %.0f ms) ---",
+		iterator->Get_Current_Parent_Name(),deltaParent*perFrame,deltaFrames,deltaParent);
+
+	double accumulatedTime = 0.;
+	int numPhases = 0;
+	for (; !iterator->Is_Done(); iterator->Next(),numPhases++)
+	{
+		const char* name = iterator->Get_Current_Name();
+		if (numPhases >= m_phases.size() || strcmp(m_phases[numPhases].m_name,name))
+		{
+			//a new child node, its history starts empty
+			if (numPhases >= m_phases.size())
+				m_phases.expand();
+			Phase& phase = m_phases[numPhases];
+			phase.m_name = name;
+			phase.m_lastTotalTime = 0.;
+			phase.m_lastTotalCalls = 0;
+			phase.m_history.resize(0);
+			phase.m_history.resize(m_historySize,0.f);
+		}
+		Phase& phase = m_phases[numPhases];
+		const double totalTime = iterator->Get_Current_Total_Time();
+		const int totalCalls = iterator->Get_Current_Total_Calls();
+		if (restart || totalTime < phase.m_lastTotalTime)
+		{
+			phase.m_lastTotalTime = 0.;
+			phase.m_lastTotalCalls = 0;
+		}
+		const double deltaTime = totalTime-phase.m_lastTotalTime;
+		const int deltaCalls = totalCalls-phase.m_lastTotalCalls;
+		phase.m_lastTotalTime = totalTime;
+		phase.m_lastTotalCalls = totalCalls;
+		accumulatedTime += deltaTime;
+
+		phase.m_history[slot] = float(deltaTime*perFrame);
+		const double fraction = deltaParent > SIMD_EPSILON ? (deltaTime/deltaParent)*100. : 0.;
+		sprintf(phase.m_text,"%d -- %s (%.2f %%) :: %.3f ms / frame (%d calls)",
+			numPhases+1,name,fraction,deltaTime*perFrame,deltaCalls);
+	}
+	m_phases.resize(numPhases);
+
+	sprintf(m_unaccountedText,"%s (%.3f %%) :: %.3f ms / frame","Unaccounted",
+		deltaParent > SIMD_EPSILON ? ((deltaParent-accumulatedTime)/deltaParent)*100. : 0.,(deltaParent-accumulatedTime)*perFrame);
+
+	m_frameMin[slot] = m_pendingMin;
+	m_frameMax[slot] = m_pendingMax;
+	m_frameSum[slot] = m_pendingSum;
+	m_frameCount[slot] = m_pendingFrames;
+	m_pendingFrames = 0;
+	m_pendingSum = 0.f;
+
+	float windowMin = 0.f;
+	float windowMax = 0.f;
+	float windowSum = 0.f;
+	int windowFrames = 0;
+	for (int i=0;i<m_numSamples;i++)
+	{
+		if (!m_frameCount[i])
+			continue;
+		windowMin = windowFrames ? btMin(windowMin,m_frameMin[i]) : m_frameMin[i];
+		windowMax = windowFrames ? btMax(windowMax,m_frameMax[i]) : m_frameMax[i];
+		windowSum += m_frameSum[i];
+		windowFrames += m_frameCount[i];
+	}
+	m_windowMin = windowMin;
+	m_windowMax = windowMax;
+	m_windowAvg = windowFrames ? windowSum/float(windowFrames) : 0.f;
+	sprintf(m_frameText,"frame time: min %.2f / avg %.2f / max %.2f ms over %.1f s",
+		m_windowMin,m_windowAvg,m_windowMax,float(m_numSamples)/float(m_sampleRate));
+
+	//the sparklines follow the new sample
+	m_graphYIncr = 0;
+#else
+	(void)iterator;
+	(void)elapsed;
+#endif //BT_NO_PROFILE
+}
+
+///one line segment per pair of consecutive samples, oldest on the left, scaled to the largest value in the history
+void	ProfileHud::addSparkline(const btAlignedObjectArray<float>& history,int row)
+{
+	if (m_numSamples < 2)
+		return;
+	const int oldest = (m_head-m_numSamples+m_historySize)%m_historySize;
+	float largest = 0.f;
+	for (int i=0;i<m_numSamples;i++)
+	{
+		largest = btMax(largest,history[(oldest+i)%m_historySize]);
+	}
+	const float scale = largest > 0.f ? float(sGraphHeight)/largest : 0.f;
+	//text coordinates grow downwards, the baseline of row 0 is at y=0
+	const float baseline = float(row*m_graphYIncr-2);
+	const float x0 = float(m_historySize-m_numSamples);
+	for (int i=1;i<m_numSamples;i++)
+	{
+		const float a = history[(oldest+i-1)%m_historySize];
+		const float b = history[(oldest+i)%m_historySize];
+		m_graphLines.push_back(x0+float(i-1));
+		m_graphLines.push_back(baseline-a*scale);
+		m_graphLines.push_back(0.f);
+		m_graphLines.push_back(x0+float(i));
+		m_graphLines.push_back(baseline-b*scale);
+		m_graphLines.push_back(0.f);
+	}
+}
+
+void	ProfileHud::buildGraphs(int yIncr)
+{
+	m_graphYIncr = yIncr;
+	m_graphLines.resize(0);
+	for (int i=0;i<m_phases.size();i++)
+	{
+		addSparkline(m_phases[i].m_history,2+i);
+	}
+	addSparkline(m_frameMax,m_phases.size()+3);
+}
+
+void	ProfileHud::draw(int xOffset,int& yStart,int yIncr)
+{
+	if (m_graphYIncr != yIncr)
+		buildGraphs(yIncr);
+
+	if (m_graphLines.size())
+	{
+		glPushMatrix();
+		glTranslatef(btScalar(xOffset),btScalar(yStart),btScalar(0));
+		glDisable(GL_TEXTURE_2D);
+		glColor3f(0.4f,0.8f,1.f);
+		glInterleavedArrays(GL_V3F,0,&m_graphLines[0]);
+		glDrawArrays(GL_LINES,0,m_graphLines.size()/3);
+		glDisableClientState(GL_VERTEX_ARRAY);
+		glPopMatrix();
+	}
+
+	const int textOffset = xOffset+m_historySize+sGraphSpacing;
+	GLDebugDrawString(textOffset,yStart,m_headerText);
+	yStart += yIncr;
+	GLDebugDrawString(textOffset,yStart,"press (1,2...) to display child timings, or 0 for parent");
+	yStart += yIncr;
+	for (int i=0;i<m_phases.size();i++)
+	{
+		GLDebugDrawString(textOffset,yStart,m_phases[i].m_text);
+		yStart += yIncr;
+	}
+	GLDebugDrawString(textOffset,yStart,m_unaccountedText);
+	yStart += yIncr;
+	GLDebugDrawString(textOffset,yStart,m_frameText);
+	yStart += yIncr;
+	GLDebugDrawString(textOffset,yStart,"-------------------------------------------------");
+	yStart += yIncr;
+}
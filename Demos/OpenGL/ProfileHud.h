@@ -0,0 +1,126 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef PROFILE_HUD_H
+#define PROFILE_HUD_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btQuickprof.h"
+
+class CProfileIterator;
+
+///ProfileHud is the profile overlay of DemoApplication. The children of the current CProfileIterator node are
+///sampled a few times per second instead of every frame. Each sample holds the time per frame of every phase
+///since the previous sample, or of the last step when stepSimulation reset the profiler in between, and is kept
+///in a fixed size history ring that is drawn as one sparkline per phase.
+///The text lines are only formatted when a sample is taken, so drawing the overlay costs almost nothing and
+///does not disturb the timings it shows. The frame time is measured between update calls, the window shows
+///its minimum, average and maximum over the history.
+class ProfileHud
+{
+	struct Phase
+	{
+		const char*	m_name;
+		double		m_lastTotalTime;
+		int			m_lastTotalCalls;
+		///milliseconds per frame of each sample, ring indexed like the frame history
+		btAlignedObjectArray<float>	m_history;
+		char		m_text[128];
+	};
+
+	int			m_historySize;
+	///next ring slot and number of valid samples
+	int			m_head;
+	int			m_numSamples;
+	btScalar	m_sampleRate;
+	///the phases or their parent changed, the history starts over
+	bool		m_dirty;
+
+	btAlignedObjectArray<Phase>	m_phases;
+	double		m_lastParentTime;
+	int			m_lastFrameCount;
+	double		m_lastTimeSinceReset;
+
+	///frame time between two update calls, in milliseconds
+	btClock		m_frameClock;
+	btClock		m_sampleClock;
+	float		m_pendingMin;
+	float		m_pendingMax;
+	float		m_pendingSum;
+	int			m_pendingFrames;
+	btAlignedObjectArray<float>	m_frameMin;
+	btAlignedObjectArray<float>	m_frameMax;
+	btAlignedObjectArray<float>	m_frameSum;
+	btAlignedObjectArray<int>	m_frameCount;
+	float		m_windowMin;
+	float		m_windowAvg;
+	float		m_windowMax;
+
+	char		m_headerText[128];
+	char		m_unaccountedText[128];
+	char		m_frameText[128];
+
+	///sparklines in GL_V3F, relative to the first text line
+	btAlignedObjectArray<float>	m_graphLines;
+	int			m_graphYIncr;
+
+	///elapsed is the time since the previous sample in milliseconds
+	void	sample(CProfileIterator* iterator,double elapsed);
+	void	addSparkline(const btAlignedObjectArray<float>& history,int row);
+	void	buildGraphs(int yIncr);
+
+public:
+
+	ProfileHud(int historySize=120);
+
+	///samples per second, the history covers historySize/sampleRate seconds
+	void	setSampleRate(btScalar samplesPerSecond);
+	btScalar	getSampleRate() const
+	{
+		return m_sampleRate;
+	}
+
+	///the iterator moved to another node, start a new history with the next update
+	void	invalidate()
+	{
+		m_dirty = true;
+	}
+
+	///measure the frame time, and sample the iterator when the sample interval passed. While idle no time is
+	///accumulated, so a paused simulation does not show up as one long frame.
+	void	update(CProfileIterator* iterator,bool idle);
+
+	///draw the cached text lines and sparklines, in the orthographic projection of the HUD
+	void	draw(int xOffset,int& yStart,int yIncr);
+
+	int		getNumSamples() const
+	{
+		return m_numSamples;
+	}
+	///frame time statistics in milliseconds, over the samples in the history
+	float	getMinFrameTime() const
+	{
+		return m_windowMin;
+	}
+	float	getAvgFrameTime() const
+	{
+		return m_windowAvg;
+	}
+	float	getMaxFrameTime() const
+	{
+		return m_windowMax;
+	}
+};
+
+#endif //PROFILE_HUD_H
@@ -0,0 +1,117 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "ProjectilePool.h"
+#include "BulletDynamics/Dynamics/btDynamicsWorld.h"
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+#include "BulletCollision/BroadphaseCollision/btBroadphaseInterface.h"
+#include "BulletCollision/BroadphaseCollision/btOverlappingPairCache.h"
+#include "LinearMath/btDefaultMotionState.h"
+
+ProjectilePool::ProjectilePool(int capacity)
+:m_capacity(capacity),
+m_nextCandidate(0),
+m_numRecycled(0),
+m_worldBoundsMin(-1000,-1000,-1000),
+m_worldBoundsMax(1000,1000,1000)
+{
+	m_bodies.reserve(capacity);
+}
+
+bool	ProjectilePool::isRecyclable(const btRigidBody* body) const
+{
+	if (body->getActivationState() == ISLAND_SLEEPING)
+		return true;
+
+	const btVector3& pos = body->getWorldTransform().getOrigin();
+	for (int i=0;i<3;i++)
+	{
+		if (pos[i] < m_worldBoundsMin[i] || pos[i] > m_worldBoundsMax[i])
+			return true;
+	}
+	return false;
+}
+
+btRigidBody*	ProjectilePool::acquireRecycledBody(btDynamicsWorld* world,const btTransform& startTransform)
+{
+	if (m_bodies.size() < m_capacity || !m_bodies.size())
+		return 0;
+
+	///bodies are visited round-robin, so the first candidate is the one re-armed longest ago
+	int index = m_nextCandidate % m_bodies.size();
+	for (int i=0;i<m_bodies.size();i++)
+	{
+		int candidate = (m_nextCandidate+i) % m_bodies.size();
+		if (isRecyclable(m_bodies[candidate]))
+		{
+			index = candidate;
+			break;
+		}
+	}
+	m_nextCandidate = index+1;
+	m_numRecycled++;
+
+	btRigidBody* body = m_bodies[index];
+
+	///drop the cached contact points, the proxy itself stays in the broadphase
+	btBroadphaseProxy* proxy = body->getBroadphaseHandle();
+	if (proxy && world->getBroadphase()->getOverlappingPairCache())
+		world->getBroadphase()->getOverlappingPairCache()->cleanProxyFromPairs(proxy,world->getDispatcher());
+
+	body->setCenterOfMassTransform(startTransform);
+	body->setLinearVelocity(btVector3(0,0,0));
+	body->setAngularVelocity(btVector3(0,0,0));
+	body->clearForces();
+	body->forceActivationState(ACTIVE_TAG);
+	body->setDeactivationTime(0.f);
+
+	btDefaultMotionState* motionState = (btDefaultMotionState*)body->getMotionState();
+	if (motionState)
+	{
+		motionState->m_startWorldTrans = startTransform;
+		motionState->m_graphicsWorldTrans = startTransform;
+	}
+
+	if (proxy)
+		world->updateSingleAabb(body);
+
+	return body;
+}
+
+void	ProjectilePool::addBody(btRigidBody* body)
+{
+	btAssert(m_bodies.size() < m_capacity);
+	m_bodies.push_back(body);
+}
+
+void	ProjectilePool::removeBody(const btCollisionObject* obj)
+{
+	for (int i=0;i<m_bodies.size();i++)
+	{
+		if (m_bodies[i] == obj)
+		{
+			m_bodies.swap(i,m_bodies.size()-1);
+			m_bodies.pop_back();
+			return;
+		}
+	}
+}
+
+void	ProjectilePool::clear()
+{
+	m_bodies.clear();
+	m_nextCandidate = 0;
+	m_numRecycled = 0;
+}
@@ -0,0 +1,78 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef PROJECTILE_POOL_H
+#define PROJECTILE_POOL_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btTransform.h"
+
+class btRigidBody;
+class btCollisionObject;
+class btDynamicsWorld;
+
+///ProjectilePool keeps a fixed number of projectile rigid bodies alive in the world.
+///Once the pool is full, bodies that fell asleep or left the world bounds are re-armed in place:
+///they keep their motion state and broadphase proxy, so no allocation and no re-insertion takes place.
+///The bodies are owned by the dynamics world, the pool only keeps track of them.
+class ProjectilePool
+{
+	btAlignedObjectArray<btRigidBody*>	m_bodies;
+	int			m_capacity;
+	int			m_nextCandidate;
+	int			m_numRecycled;
+	btVector3	m_worldBoundsMin;
+	btVector3	m_worldBoundsMax;
+
+	bool	isRecyclable(const btRigidBody* body) const;
+
+public:
+
+	ProjectilePool(int capacity);
+
+	int		getCapacity() const
+	{
+		return m_capacity;
+	}
+	int		getNumBodies() const
+	{
+		return m_bodies.size();
+	}
+	int		getNumRecycled() const
+	{
+		return m_numRecycled;
+	}
+
+	///bodies whose center leaves these bounds can be recycled even while they are still active
+	void	setWorldBounds(const btVector3& worldBoundsMin,const btVector3& worldBoundsMax)
+	{
+		m_worldBoundsMin = worldBoundsMin;
+		m_worldBoundsMax = worldBoundsMax;
+	}
+
+	///acquireRecycledBody returns 0 while the pool has room for a new body (register it with addBody).
+	///Otherwise it returns a sleeping or out-of-bounds body, or the oldest one if all are in use,
+	///already re-armed at startTransform with zero velocity.
+	btRigidBody*	acquireRecycledBody(btDynamicsWorld* world,const btTransform& startTransform);
+
+	void	addBody(btRigidBody* body);
+
+	///call this before an object of the pool is removed from the world and deleted
+	void	removeBody(const btCollisionObject* obj);
+
+	///forget all bodies, when the world deletes them (for example in exitPhysics)
+	void	clear();
+};
+
+#endif //PROJECTILE_POOL_H
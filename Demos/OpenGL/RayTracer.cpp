@@ -0,0 +1,524 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "RayTracer.h"
+#include "RenderTexture.h"
+#include "TaskPool.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+#include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.h"
+#include "BulletCollision/CollisionShapes/btCollisionShape.h"
+#include "LinearMath/btAabbUtil2.h"
+#include "LinearMath/btQuickprof.h"
+#include <string.h>
+
+///light that reaches the faces turned away from the sun, like SoftwareRasterizer
+static const btScalar	sAmbient = btScalar(0.25);
+///shadow rays start this far above the hit, outside of the collision margin of the hit object
+static const btScalar	sShadowBias = btScalar(0.05);
+
+struct PacketHit
+{
+	btVector3	m_point;
+	btVector3	m_normal;
+	btVector3	m_color;
+	///lambert term, negative when the ray hits nothing
+	btScalar	m_diffuse;
+};
+
+struct RayTracer::ThreadData
+{
+	btAlignedObjectArray<int>	m_candidates;
+	btAlignedObjectArray<int>	m_shadowCandidates;
+	btAlignedObjectArray<PacketHit>	m_hits;
+	///4 floats per pixel for one row of packets
+	btAlignedObjectArray<float>	m_pixels;
+
+	int		m_numPrimaryRays;
+	int		m_numShadowRays;
+	int		m_numObjectTests;
+};
+
+///adds the objects of the leaves that collideKDOP reports
+struct RayTracerCandidateCollector : public btDbvt::ICollide
+{
+	const btHashMap<btHashPtr,int>&	m_objectIndices;
+	btAlignedObjectArray<int>&	m_candidates;
+
+	RayTracerCandidateCollector(const btHashMap<btHashPtr,int>& objectIndices,btAlignedObjectArray<int>& candidates)
+		:m_objectIndices(objectIndices),
+		m_candidates(candidates)
+	{
+	}
+
+	virtual void	Process(const btDbvtNode* leaf)
+	{
+		const btDbvtProxy* proxy = (const btDbvtProxy*)leaf->data;
+		const int* index = m_objectIndices.find(btHashPtr(proxy->m_clientObject));
+		if (index)
+			m_candidates.push_back(*index);
+	}
+};
+
+///any hit is enough for a shadow, the fraction 0 stops the remaining tests of the object
+struct ShadowRayCallback : public btCollisionWorld::RayResultCallback
+{
+	virtual	btScalar	addSingleResult(btCollisionWorld::LocalRayResult& rayResult,bool normalInWorldSpace)
+	{
+		(void)normalInWorldSpace;
+		m_collisionObject = rayResult.m_collisionObject;
+		m_closestHitFraction = btScalar(0.);
+		return btScalar(0.);
+	}
+};
+
+struct BandTask : public TaskPool::Task
+{
+	RayTracer*	m_rayTracer;
+
+	virtual void	run(int index,int threadIndex)
+	{
+		m_rayTracer->traceBand(index,threadIndex);
+	}
+};
+
+RayTracer::RayTracer(int width,int height,int numThreads)
+:m_width(width),
+m_height(height),
+m_dbvtBroadphase(0),
+m_world(0),
+m_eye(0,0,0),
+m_forward(0,0,-1),
+m_right(1,0,0),
+m_up(0,1,0),
+m_maxDistance(btScalar(1000.)),
+m_lightDirection(btVector3(1,-2,1).normalized()),
+m_clearColor(btScalar(0.7),btScalar(0.7),btScalar(0.7),btScalar(1.)),
+m_shadows(true),
+m_useWorldRayTest(false),
+m_renderTime(0.),
+m_numPrimaryRays(0),
+m_numShadowRays(0),
+m_numObjectTests(0)
+{
+	m_texture = new renderTexture(width,height);
+	m_taskPool = new TaskPool(numThreads);
+	for (int i=0;i<m_taskPool->getNumThreads();i++)
+	{
+		m_threadData.push_back(new ThreadData);
+	}
+	setCamera(btVector3(0,0,0),btVector3(0,0,-1),btVector3(0,1,0));
+}
+
+RayTracer::~RayTracer()
+{
+	for (int i=0;i<m_threadData.size();i++)
+	{
+		delete m_threadData[i];
+	}
+	delete m_taskPool;
+	delete m_texture;
+}
+
+int	RayTracer::getNumThreads() const
+{
+	return m_useWorldRayTest ? 1 : m_taskPool->getNumThreads();
+}
+
+void	RayTracer::setCamera(const btVector3& eye,const btVector3& target,const btVector3& up,btScalar fovY)
+{
+	btVector3 forward = target-eye;
+	if (forward.length2() < SIMD_EPSILON)
+		forward.setValue(0,0,-1);
+	forward.normalize();
+	btVector3 right = forward.cross(up);
+	if (right.length2() < SIMD_EPSILON)
+	{
+		btVector3 unused;
+		btPlaneSpace1(forward,right,unused);
+	}
+	right.normalize();
+
+	const btScalar tanHalfFovY = btTan(fovY*SIMD_RADS_PER_DEG*btScalar(0.5));
+	const btScalar aspect = btScalar(m_width)/btScalar(btMax(m_height,1));
+	m_eye = eye;
+	m_forward = forward;
+	m_right = right*(tanHalfFovY*aspect);
+	m_up = right.cross(forward)*tanHalfFovY;
+}
+
+void	RayTracer::setLightDirection(const btVector3& direction)
+{
+	if (direction.length2() > SIMD_EPSILON)
+		m_lightDirection = direction.normalized();
+}
+
+btVector3	RayTracer::getRayDirection(btScalar x,btScalar y) const
+{
+	return m_forward + m_right*(btScalar(2.)*x/btScalar(m_width)-btScalar(1.)) + m_up*(btScalar(1.)-btScalar(2.)*y/btScalar(m_height));
+}
+
+void	RayTracer::collectCandidates(const btVector3* normals,const btScalar* offsets,int numPlanes,btAlignedObjectArray<int>& candidates) const
+{
+	candidates.resize(0);
+	if (m_dbvtBroadphase && (const btBroadphaseInterface*)m_dbvtBroadphase == m_world->getBroadphase())
+	{
+		RayTracerCandidateCollector collector(m_objectIndices,candidates);
+		for (int i=0;i<2;i++)
+		{
+			if (m_dbvtBroadphase->m_sets[i].m_root)
+				btDbvt::collideKDOP(m_dbvtBroadphase->m_sets[i].m_root,normals,offsets,numPlanes,collector);
+		}
+		return;
+	}
+
+	for (int i=0;i<m_objects.size();i++)
+	{
+		const ObjectInfo& info = m_objects[i];
+		bool inside = true;
+		for (int j=0;j<numPlanes && inside;j++)
+		{
+			///the corner furthest along the plane normal
+			btVector3 corner(normals[j].getX()>=0.f ? info.m_aabbMax.getX() : info.m_aabbMin.getX(),
+				normals[j].getY()>=0.f ? info.m_aabbMax.getY() : info.m_aabbMin.getY(),
+				normals[j].getZ()>=0.f ? info.m_aabbMax.getZ() : info.m_aabbMin.getZ());
+			inside = normals[j].dot(corner)+offsets[j] >= btScalar(0.);
+		}
+		if (inside)
+			candidates.push_back(i);
+	}
+}
+
+int	RayTracer::tracePrimary(ThreadData& data,const btVector3& from,const btVector3& to,btVector3& hitPoint,btVector3& hitNormal) const
+{
+	btCollisionWorld::ClosestRayResultCallback callback(from,to);
+	int hitIndex = -1;
+	if (m_useWorldRayTest)
+	{
+		m_world->rayTest(from,to,callback);
+		if (callback.hasHit())
+		{
+			const int* index = m_objectIndices.find(btHashPtr(callback.m_collisionObject));
+			hitIndex = index ? *index : -1;
+		}
+	} else
+	{
+		btTransform rayFromTrans,rayToTrans;
+		rayFromTrans.setIdentity();
+		rayFromTrans.setOrigin(from);
+		rayToTrans.setIdentity();
+		rayToTrans.setOrigin(to);
+		const btVector3 rayDirection = to-from;
+		btVector3 rayInvDirection;
+		unsigned int raySigns[3];
+		for (int i=0;i<3;i++)
+		{
+			rayInvDirection[i] = rayDirection[i]==btScalar(0.) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.)/rayDirection[i];
+			raySigns[i] = rayInvDirection[i] < btScalar(0.);
+		}
+
+		for (int i=0;i<data.m_candidates.size();i++)
+		{
+			const ObjectInfo& info = m_objects[data.m_candidates[i]];
+			const btVector3 bounds[2] = {info.m_aabbMin,info.m_aabbMax};
+			btScalar tmin;
+			if (!btRayAabb2(from,rayInvDirection,raySigns,bounds,tmin,btScalar(0.),callback.m_closestHitFraction))
+				continue;
+			if (info.m_object->getBroadphaseHandle() && !callback.needsCollision(info.m_object->getBroadphaseHandle()))
+				continue;
+			data.m_numObjectTests++;
+			btCollisionWorld::rayTestSingle(rayFromTrans,rayToTrans,info.m_object,info.m_object->getCollisionShape(),
+				info.m_object->getWorldTransform(),callback);
+			if (callback.m_collisionObject == info.m_object)
+				hitIndex = data.m_candidates[i];
+		}
+	}
+	if (hitIndex >= 0)
+	{
+		hitPoint = callback.m_hitPointWorld;
+		hitNormal = callback.m_hitNormalWorld;
+		if (hitNormal.length2() > SIMD_EPSILON)
+			hitNormal.normalize();
+	}
+	return hitIndex;
+}
+
+bool	RayTracer::traceShadow(ThreadData& data,const btVector3& from,const btVector3& to) const
+{
+	ShadowRayCallback callback;
+	if (m_useWorldRayTest)
+	{
+		m_world->rayTest(from,to,callback);
+		return callback.hasHit();
+	}
+
+	btTransform rayFromTrans,rayToTrans;
+	rayFromTrans.setIdentity();
+	rayFromTrans.setOrigin(from);
+	rayToTrans.setIdentity();
+	rayToTrans.setOrigin(to);
+	const btVector3 rayDirection = to-from;
+	btVector3 rayInvDirection;
+	unsigned int raySigns[3];
+	for (int i=0;i<3;i++)
+	{
+		rayInvDirection[i] = rayDirection[i]==btScalar(0.) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.)/rayDirection[i];
+		raySigns[i] = rayInvDirection[i] < btScalar(0.);
+	}
+
+	for (int i=0;i<data.m_shadowCandidates.size() && !callback.hasHit();i++)
+	{
+		const ObjectInfo& info = m_objects[data.m_shadowCandidates[i]];
+		const btVector3 bounds[2] = {info.m_aabbMin,info.m_aabbMax};
+		btScalar tmin;
+		if (!btRayAabb2(from,rayInvDirection,raySigns,bounds,tmin,btScalar(0.),btScalar(1.)))
+			continue;
+		if (info.m_object->getBroadphaseHandle() && !callback.needsCollision(info.m_object->getBroadphaseHandle()))
+			continue;
+		data.m_numObjectTests++;
+		btCollisionWorld::rayTestSingle(rayFromTrans,rayToTrans,info.m_object,info.m_object->getCollisionShape(),
+			info.m_object->getWorldTransform(),callback);
+	}
+	return callback.hasHit();
+}
+
+void	RayTracer::tracePacket(ThreadData& data,int x0,int y0,int x1,int y1)
+{
+	const int packetWidth = x1-x0;
+	if (!m_useWorldRayTest)
+	{
+		///four planes through the eye and the pixel borders of the packet, then near and far
+		const btVector3 topLeft = getRayDirection(btScalar(x0),btScalar(y0));
+		const btVector3 topRight = getRayDirection(btScalar(x1),btScalar(y0));
+		const btVector3 bottomLeft = getRayDirection(btScalar(x0),btScalar(y1));
+		const btVector3 bottomRight = getRayDirection(btScalar(x1),btScalar(y1));
+		const btVector3 center = getRayDirection(btScalar(x0+x1)*btScalar(0.5),btScalar(y0+y1)*btScalar(0.5));
+		btVector3 normals[6] = {topLeft.cross(bottomLeft),bottomRight.cross(topRight),topRight.cross(topLeft),bottomLeft.cross(bottomRight),
+			m_forward,-m_forward};
+		btScalar offsets[6];
+		for (int i=0;i<4;i++)
+		{
+			if (normals[i].dot(center) < btScalar(0.))
+				normals[i] = -normals[i];
+			normals[i].normalize();
+			offsets[i] = -normals[i].dot(m_eye);
+		}
+		offsets[4] = -m_forward.dot(m_eye);
+		offsets[5] = m_forward.dot(m_eye)+m_maxDistance;
+		collectCandidates(normals,offsets,6,data.m_candidates);
+	}
+
+	data.m_hits.resize(packetWidth*(y1-y0));
+	btVector3 litMin(BT_LARGE_FLOAT,BT_LARGE_FLOAT,BT_LARGE_FLOAT);
+	btVector3 litMax(-BT_LARGE_FLOAT,-BT_LARGE_FLOAT,-BT_LARGE_FLOAT);
+	int numLit = 0;
+	for (int y=y0;y<y1;y++)
+	{
+		for (int x=x0;x<x1;x++)
+		{
+			PacketHit& hit = data.m_hits[(y-y0)*packetWidth+x-x0];
+			const btVector3 direction = getRayDirection(btScalar(x)+btScalar(0.5),btScalar(y)+btScalar(0.5)).normalized();
+			btVector3 point,normal;
+			const int index = tracePrimary(data,m_eye,m_eye+direction*m_maxDistance,point,normal);
+			data.m_numPrimaryRays++;
+			if (index < 0)
+			{
+				hit.m_diffuse = btScalar(-1.);
+				continue;
+			}
+			if (normal.dot(direction) > btScalar(0.))
+				normal = -normal;
+			hit.m_point = point;
+			hit.m_normal = normal;
+			hit.m_color = m_objects[index].m_color;
+			hit.m_diffuse = btMax(btScalar(0.),-normal.dot(m_lightDirection));
+			if (m_shadows && hit.m_diffuse > btScalar(0.))
+			{
+				litMin.setMin(point);
+				litMax.setMax(point);
+				numLit++;
+			}
+		}
+	}
+
+	if (numLit)
+	{
+		const btVector3 towardsLight = -m_lightDirection;
+		if (!m_useWorldRayTest)
+		{
+			///the box around the shadow ray origins, swept towards the light. A side of the box is left out
+			///when the sweep crosses it, the two caps are perpendicular to the light.
+			const btVector3 boxMin = litMin-btVector3(sShadowBias,sShadowBias,sShadowBias);
+			const btVector3 boxMax = litMax+btVector3(sShadowBias,sShadowBias,sShadowBias);
+			btVector3 normals[8];
+			btScalar offsets[8];
+			int numPlanes = 0;
+			for (int axis=0;axis<3;axis++)
+			{
+				btVector3 normal(0,0,0);
+				normal[axis] = btScalar(1.);
+				if (towardsLight[axis] >= btScalar(0.))
+				{
+					normals[numPlanes] = normal;
+					offsets[numPlanes++] = -boxMin[axis];
+				}
+				if (towardsLight[axis] <= btScalar(0.))
+				{
+					normals[numPlanes] = -normal;
+					offsets[numPlanes++] = boxMax[axis];
+				}
+			}
+			const btVector3 nearCorner(towardsLight.getX()>=0.f ? boxMin.getX() : boxMax.getX(),
+				towardsLight.getY()>=0.f ? boxMin.getY() : boxMax.getY(),
+				towardsLight.getZ()>=0.f ? boxMin.getZ() : boxMax.getZ());
+			const btVector3 farCorner(towardsLight.getX()>=0.f ? boxMax.getX() : boxMin.getX(),
+				towardsLight.getY()>=0.f ? boxMax.getY() : boxMin.getY(),
+				towardsLight.getZ()>=0.f ? boxMax.getZ() : boxMin.getZ());
+			normals[numPlanes] = towardsLight;
+			offsets[numPlanes++] = -towardsLight.dot(nearCorner);
+			normals[numPlanes] = -towardsLight;
+			offsets[numPlanes++] = towardsLight.dot(farCorner)+m_maxDistance;
+			collectCandidates(normals,offsets,numPlanes,data.m_shadowCandidates);
+		}
+
+		for (int i=0;i<data.m_hits.size();i++)
+		{
+			PacketHit& hit = data.m_hits[i];
+			if (hit.m_diffuse <= btScalar(0.))
+				continue;
+			const btVector3 from = hit.m_point+hit.m_normal*sShadowBias;
+			data.m_numShadowRays++;
+			if (traceShadow(data,from,from+towardsLight*m_maxDistance))
+				hit.m_diffuse = btScalar(0.);
+		}
+	}
+
+	for (int y=y0;y<y1;y++)
+	{
+		for (int x=x0;x<x1;x++)
+		{
+			const PacketHit& hit = data.m_hits[(y-y0)*packetWidth+x-x0];
+			float* pixel = &data.m_pixels[((y-y0)*m_width+x)*4];
+			if (hit.m_diffuse < btScalar(0.))
+			{
+				for (int c=0;c<4;c++)
+				{
+					pixel[c] = float(m_clearColor[c]);
+				}
+				continue;
+			}
+			const btVector3 color = hit.m_color*(sAmbient+(btScalar(1.)-sAmbient)*hit.m_diffuse);
+			pixel[0] = float(color.getX());
+			pixel[1] = float(color.getY());
+			pixel[2] = float(color.getZ());
+			pixel[3] = 1.f;
+		}
+	}
+}
+
+void	RayTracer::traceBand(int band,int threadIndex)
+{
+	ThreadData& data = *m_threadData[threadIndex];
+	const int y0 = band*PACKET_SIZE;
+	const int y1 = btMin(y0+PACKET_SIZE,m_height);
+	data.m_pixels.resize(m_width*PACKET_SIZE*4);
+	for (int x0=0;x0<m_width;x0+=PACKET_SIZE)
+	{
+		tracePacket(data,x0,y0,btMin(x0+PACKET_SIZE,m_width),y1);
+	}
+	for (int y=y0;y<y1;y++)
+	{
+		m_texture->setSpan(0,y,m_width,&data.m_pixels[(y-y0)*m_width*4]);
+	}
+}
+
+void	RayTracer::renderWorld(const btCollisionWorld* world)
+{
+	BT_PROFILE("RayTracer::renderWorld");
+	btClock clock;
+	m_world = world;
+
+	m_objects.resize(0);
+	m_objectIndices.clear();
+	const btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	for (int i=0;i<objects.size();i++)
+	{
+		ObjectInfo info;
+		info.m_object = objects[i];
+		if (info.m_object->getBroadphaseHandle())
+		{
+			info.m_aabbMin = info.m_object->getBroadphaseHandle()->m_aabbMin;
+			info.m_aabbMax = info.m_object->getBroadphaseHandle()->m_aabbMax;
+		} else
+		{
+			info.m_object->getCollisionShape()->getAabb(info.m_object->getWorldTransform(),info.m_aabbMin,info.m_aabbMax);
+		}
+
+		///the colors of DemoApplication::renderscene
+		info.m_color.setValue(1.f,1.0f,0.5f);
+		if (i&1)
+			info.m_color.setValue(0.f,0.0f,1.f);
+		if (info.m_object->getActivationState() == ACTIVE_TAG)
+		{
+			info.m_color += (i&1) ? btVector3(1.f,0.f,0.f) : btVector3(.5f,0.f,0.f);
+		}
+		if (info.m_object->getActivationState() == ISLAND_SLEEPING)
+		{
+			info.m_color += (i&1) ? btVector3(0.f,1.f,0.f) : btVector3(0.f,0.5f,0.f);
+		}
+		m_objectIndices.insert(btHashPtr(info.m_object),m_objects.size());
+		m_objects.push_back(info);
+	}
+
+	for (int i=0;i<m_threadData.size();i++)
+	{
+		m_threadData[i]->m_numPrimaryRays = 0;
+		m_threadData[i]->m_numShadowRays = 0;
+		m_threadData[i]->m_numObjectTests = 0;
+	}
+
+	const int numBands = (m_height+PACKET_SIZE-1)/PACKET_SIZE;
+	if (m_useWorldRayTest)
+	{
+		for (int i=0;i<numBands;i++)
+		{
+			traceBand(i,0);
+		}
+	} else
+	{
+		BandTask task;
+		task.m_rayTracer = this;
+		m_taskPool->parallelFor(numBands,task);
+	}
+
+	m_numPrimaryRays = 0;
+	m_numShadowRays = 0;
+	m_numObjectTests = 0;
+	for (int i=0;i<m_threadData.size();i++)
+	{
+		m_numPrimaryRays += m_threadData[i]->m_numPrimaryRays;
+		m_numShadowRays += m_threadData[i]->m_numShadowRays;
+		m_numObjectTests += m_threadData[i]->m_numObjectTests;
+	}
+	m_world = 0;
+	m_renderTime = double(clock.getTimeMicroseconds())*0.001;
+}
+
+bool	RayTracer::writeImage(const char* fileName) const
+{
+	const size_t length = strlen(fileName);
+	if (length >= 4 && (!strcmp(fileName+length-4,".png") || !strcmp(fileName+length-4,".PNG")))
+		return m_texture->writePNG(fileName);
+	return m_texture->writePPM(fileName);
+}
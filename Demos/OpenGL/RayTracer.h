@@ -0,0 +1,178 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef RAY_TRACER_H
+#define RAY_TRACER_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btHashMap.h"
+#include "LinearMath/btVector3.h"
+
+class btCollisionObject;
+class btCollisionWorld;
+class btDbvtBroadphase;
+class renderTexture;
+class TaskPool;
+
+///RayTracer renders a collision world by casting one ray per pixel, and a shadow ray towards the light from
+///every lit hit, into a renderTexture. It is also a benchmark of ray queries against a real scene.
+///The pixels are traced in packets of 8x8 rays. Each packet collects the objects inside its frustum once, by
+///walking the trees of the btDbvtBroadphase given to setDbvtBroadphase with btDbvt::collideKDOP (or by testing
+///every object AABB with other broadphases). Its rays then only test these candidates, with an AABB test
+///and btCollisionWorld::rayTestSingle, the same narrowphase as btCollisionWorld::rayTest.
+///Rows of packets are traced in parallel on a TaskPool. btCollisionWorld::rayTest itself cannot be called
+///from several threads, the btDbvt ray traversal keeps its stack in the tree. setUseWorldRayTest traces every
+///ray with btCollisionWorld::rayTest on the calling thread instead, to check and compare the packets.
+///The collision transforms are used, not the interpolated motion state transforms.
+class RayTracer
+{
+public:
+
+	enum
+	{
+		PACKET_SIZE = 8
+	};
+
+	struct ObjectInfo
+	{
+		btCollisionObject*	m_object;
+		btVector3	m_aabbMin;
+		btVector3	m_aabbMax;
+		btVector3	m_color;
+	};
+
+	///candidates, ray hits and a row of pixels per thread, only RayTracer.cpp knows it
+	struct ThreadData;
+
+private:
+
+	int		m_width;
+	int		m_height;
+	renderTexture*	m_texture;
+	TaskPool*	m_taskPool;
+	btDbvtBroadphase*	m_dbvtBroadphase;
+	const btCollisionWorld*	m_world;
+
+	btVector3	m_eye;
+	btVector3	m_forward;
+	///camera right and up, scaled to the half width and half height of the image at distance 1
+	btVector3	m_right;
+	btVector3	m_up;
+	btScalar	m_maxDistance;
+	btVector3	m_lightDirection;
+	btVector4	m_clearColor;
+	bool		m_shadows;
+	bool		m_useWorldRayTest;
+
+	btAlignedObjectArray<ObjectInfo>	m_objects;
+	btHashMap<btHashPtr,int>	m_objectIndices;
+	btAlignedObjectArray<ThreadData*>	m_threadData;
+
+	double	m_renderTime;
+	int		m_numPrimaryRays;
+	int		m_numShadowRays;
+	int		m_numObjectTests;
+
+	btVector3	getRayDirection(btScalar x,btScalar y) const;
+	void	collectCandidates(const btVector3* normals,const btScalar* offsets,int numPlanes,btAlignedObjectArray<int>& candidates) const;
+	///closest hit of the ray among the candidates, the index into m_objects or -1
+	int		tracePrimary(ThreadData& data,const btVector3& from,const btVector3& to,btVector3& hitPoint,btVector3& hitNormal) const;
+	bool	traceShadow(ThreadData& data,const btVector3& from,const btVector3& to) const;
+	void	tracePacket(ThreadData& data,int x0,int y0,int x1,int y1);
+
+public:
+
+	///numThreads 0 uses one thread per processor
+	RayTracer(int width,int height,int numThreads=0);
+	~RayTracer();
+
+	///perspective camera, fovY in degrees. The demos use a 90 degree frustum.
+	void	setCamera(const btVector3& eye,const btVector3& target,const btVector3& up,btScalar fovY=btScalar(90.));
+	///rays end after this distance
+	void	setMaxDistance(btScalar distance)
+	{
+		m_maxDistance = distance;
+	}
+	///direction the light travels in, like DemoApplication::m_sundirection
+	void	setLightDirection(const btVector3& direction);
+	void	setShadows(bool shadows)
+	{
+		m_shadows = shadows;
+	}
+	void	setClearColor(const btVector4& rgba)
+	{
+		m_clearColor = rgba;
+	}
+	///the broadphase of the rendered world, if it is a btDbvtBroadphase. Reset it before the broadphase is deleted.
+	void	setDbvtBroadphase(btDbvtBroadphase* broadphase)
+	{
+		m_dbvtBroadphase = broadphase;
+	}
+	///one btCollisionWorld::rayTest per ray on the calling thread, instead of the packets
+	void	setUseWorldRayTest(bool useWorldRayTest)
+	{
+		m_useWorldRayTest = useWorldRayTest;
+	}
+	bool	getUseWorldRayTest() const
+	{
+		return m_useWorldRayTest;
+	}
+
+	void	renderWorld(const btCollisionWorld* world);
+
+	renderTexture*	getRenderTexture()
+	{
+		return m_texture;
+	}
+	int		getWidth() const
+	{
+		return m_width;
+	}
+	int		getHeight() const
+	{
+		return m_height;
+	}
+	int		getNumThreads() const;
+
+	///statistics of the last renderWorld, the time in milliseconds
+	double	getRenderTime() const
+	{
+		return m_renderTime;
+	}
+	int		getNumPrimaryRays() const
+	{
+		return m_numPrimaryRays;
+	}
+	int		getNumShadowRays() const
+	{
+		return m_numShadowRays;
+	}
+	///rayTestSingle calls, the candidates whose AABB the ray hits
+	int		getNumObjectTests() const
+	{
+		return m_numObjectTests;
+	}
+	double	getRaysPerSecond() const
+	{
+		return m_renderTime > 0. ? double(m_numPrimaryRays+m_numShadowRays)*1000./m_renderTime : 0.;
+	}
+
+	///PNG when the name ends with .png, PPM otherwise
+	bool	writeImage(const char* fileName) const;
+
+	///trace one row of packets, called by the task pool
+	void	traceBand(int band,int threadIndex);
+};
+
+#endif //RAY_TRACER_H
@@ -0,0 +1,112 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "RenderQueue.h"
+#include "LinearMath/btQuickprof.h"
+
+///8 bits per channel, so nearly equal colors share a material
+static unsigned int	quantizeColor(const btVector3& color)
+{
+	unsigned int key = 0;
+	for (int i=0;i<3;i++)
+	{
+		btScalar c = btMax(btScalar(0.),btMin(btScalar(1.),color[i]));
+		key = (key<<8) | (unsigned int)(c*btScalar(255.)+btScalar(0.5));
+	}
+	return key;
+}
+
+///shapes that were not drawn for this many frames lose their slot, it is checked as often
+static const unsigned int	sStaleShapeFrames = 64;
+
+RenderQueue::RenderQueue()
+:m_frame(0),
+m_numShapes(0)
+{
+}
+
+void	RenderQueue::clear()
+{
+	m_items.resize(0);
+	m_keys.resize(0);
+	///the shape numbers of the previous frame become stale, without touching the map
+	m_frame++;
+	m_numShapes = 0;
+	if ((m_frame % sStaleShapeFrames) == 0)
+		removeStaleShapes();
+}
+
+///removeStaleShapes rebuilds the slot table with the shapes drawn in the last sStaleShapeFrames frames
+void	RenderQueue::removeStaleShapes()
+{
+	btAlignedObjectArray<btHashPtr>		shapes;
+	btAlignedObjectArray<ShapeNumber>	numbers;
+	for (int i=0;i<m_shapeSlots.size();i++)
+	{
+		const ShapeNumber& shapeNumber = m_shapeNumbers[*m_shapeSlots.getAtIndex(i)];
+		if ((m_frame - shapeNumber.m_frame) <= sStaleShapeFrames)
+		{
+			shapes.push_back(m_shapeSlots.getKeyAtIndex(i));
+			numbers.push_back(shapeNumber);
+		}
+	}
+	if (shapes.size() == m_shapeSlots.size())
+		return;
+	m_shapeSlots.clear();
+	m_shapeNumbers.resize(0);
+	for (int i=0;i<shapes.size();i++)
+	{
+		m_shapeSlots.insert(shapes[i],m_shapeNumbers.size());
+		m_shapeNumbers.push_back(numbers[i]);
+	}
+}
+
+RenderQueue::RenderItem&	RenderQueue::addItem(const btCollisionShape* shape,unsigned int stateKey,const btVector3& color)
+{
+	int* slot = m_shapeSlots.find(btHashPtr(shape));
+	ShapeNumber* shapeNumber;
+	if (slot)
+	{
+		shapeNumber = &m_shapeNumbers[*slot];
+	} else
+	{
+		m_shapeSlots.insert(btHashPtr(shape),m_shapeNumbers.size());
+		shapeNumber = &m_shapeNumbers.expand();
+		shapeNumber->m_frame = m_frame-1;
+	}
+	if (shapeNumber->m_frame != m_frame)
+	{
+		shapeNumber->m_frame = m_frame;
+		shapeNumber->m_number = m_numShapes++;
+	}
+
+	SortKey& key = m_keys.expand();
+	key.m_stateKey = stateKey;
+	key.m_shapeKey = (unsigned int)shapeNumber->m_number;
+	key.m_materialKey = quantizeColor(color);
+	key.m_item = m_items.size();
+
+	RenderItem& item = m_items.expand();
+	item.m_shape = shape;
+	item.m_color = color;
+	item.m_passMask = 0;
+	return item;
+}
+
+void	RenderQueue::sort()
+{
+	BT_PROFILE("sortRenderQueue");
+	m_keys.quickSort(SortKeyPredicate());
+}
@@ -0,0 +1,117 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btHashMap.h"
+#include "LinearMath/btVector3.h"
+
+class btCollisionShape;
+
+///RenderQueue collects the draw items of one frame, so they can be submitted in state order instead of
+///collision object order. Items are sorted by a state key (how the shape is drawn and its shape type),
+///then by shape, then by material (the color). Every item carries a mask of the passes it takes part in,
+///and each pass walks the same sorted order, drawing only its own items.
+class RenderQueue
+{
+public:
+
+	enum RenderPass
+	{
+		PASS_SCENE = 1,
+		PASS_SHADOW = 2
+	};
+
+	struct RenderItem
+	{
+		///OpenGL matrix of the rendered (interpolated) transform
+		btScalar				m_transform[16];
+		btVector3				m_color;
+		///light extrusion in shape space, for the shadow volume pass
+		btVector3				m_shadowExtrusion;
+		///bounds passed to processAllTriangles of concave shapes
+		btVector3				m_boundsMin;
+		btVector3				m_boundsMax;
+		const btCollisionShape*	m_shape;
+		int						m_passMask;
+	};
+
+protected:
+
+	struct SortKey
+	{
+		unsigned int	m_stateKey;
+		unsigned int	m_shapeKey;
+		unsigned int	m_materialKey;
+		int				m_item;
+	};
+
+	struct SortKeyPredicate
+	{
+		bool operator() ( const SortKey& a, const SortKey& b ) const
+		{
+			if (a.m_stateKey != b.m_stateKey)
+				return a.m_stateKey < b.m_stateKey;
+			if (a.m_shapeKey != b.m_shapeKey)
+				return a.m_shapeKey < b.m_shapeKey;
+			if (a.m_materialKey != b.m_materialKey)
+				return a.m_materialKey < b.m_materialKey;
+			return a.m_item < b.m_item;
+		}
+	};
+
+	btAlignedObjectArray<RenderItem>	m_items;
+	btAlignedObjectArray<SortKey>		m_keys;
+	///number of a shape in order of first use in the frame m_frame, so the order doesn't depend on addresses
+	struct ShapeNumber
+	{
+		unsigned int	m_frame;
+		int				m_number;
+	};
+	///shape -> index into m_shapeNumbers. Both persist across frames, only shapes never seen before allocate.
+	///Entries of shapes that were not drawn for a while, deleted shapes among them, are removed by removeStaleShapes.
+	btHashMap<btHashPtr,int>			m_shapeSlots;
+	btAlignedObjectArray<ShapeNumber>	m_shapeNumbers;
+	unsigned int	m_frame;
+	int				m_numShapes;
+
+	void	removeStaleShapes();
+
+public:
+
+	RenderQueue();
+
+	///clear keeps the allocated memory for the next frame
+	void	clear();
+
+	///add an item, stateKey is the part of the sort key that describes the GL state (see GL_ShapeDrawer::getStateKey)
+	RenderItem&	addItem(const btCollisionShape* shape,unsigned int stateKey,const btVector3& color);
+
+	void	sort();
+
+	int		size() const
+	{
+		return m_items.size();
+	}
+
+	///the i-th item in sorted order
+	const RenderItem&	getSortedItem(int i) const
+	{
+		return m_items[m_keys[i].m_item];
+	}
+};
+
+#endif //RENDER_QUEUE_H
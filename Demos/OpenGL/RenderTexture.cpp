@@ -14,7 +14,18 @@ subject to the following restrictions:
 */
 
 #include "RenderTexture.h"
+#include "LinearMath/btAlignedObjectArray.h"
 #include <memory.h>
+#include <stdio.h>
+
+#if defined(__AVX2__)
+#define RENDER_TEXTURE_AVX2
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RENDER_TEXTURE_SSE2
+#include <emmintrin.h>
+#endif
 
 
 renderTexture::renderTexture(int width,int height)
@@ -82,5 +93,607 @@ renderTexture::~renderTexture()
 	delete [] m_buffer;
 }
 
+///clamp like _mm_min_ps(_mm_max_ps(value,0),1), which turns NaN into 0
+static inline unsigned char	toByte(float value)
+{
+	const float clamped = value > 0.f ? (value < 1.f ? value : 1.f) : 0.f;
+	return (unsigned char)(clamped*255.f);
+}
 
+///the four bytes of a color in memory order, alpha 0 for the saturating add
+static unsigned int	packColor(const btVector4& rgba,bool keepAlpha)
+{
+	unsigned char bytes[4];
+	for (int i=0;i<4;i++)
+	{
+		bytes[i] = toByte(float(rgba[i]));
+	}
+	if (!keepAlpha)
+		bytes[3] = 0;
+	unsigned int packed;
+	memcpy(&packed,bytes,4);
+	return packed;
+}
 
+static void	fillPixels(unsigned char* dst,int count,unsigned int packed)
+{
+	int i = 0;
+#ifdef RENDER_TEXTURE_AVX2
+	const __m256i color8 = _mm256_set1_epi32(int(packed));
+	for (;i+8<=count;i+=8)
+	{
+		_mm256_storeu_si256((__m256i*)(dst+i*4),color8);
+	}
+#endif
+#ifdef RENDER_TEXTURE_SSE2
+	const __m128i color4 = _mm_set1_epi32(int(packed));
+	for (;i+4<=count;i+=4)
+	{
+		_mm_storeu_si128((__m128i*)(dst+i*4),color4);
+	}
+#endif
+	for (;i<count;i++)
+	{
+		memcpy(dst+i*4,&packed,4);
+	}
+}
+
+static inline void	addBytes(unsigned char* dst,const unsigned char* addend)
+{
+	for (int c=0;c<3;c++)
+	{
+		const int sum = dst[c]+addend[c];
+		dst[c] = (unsigned char)(sum < 255 ? sum : 255);
+	}
+}
+
+static void	addPixels(unsigned char* dst,int count,unsigned int packed)
+{
+	int i = 0;
+#ifdef RENDER_TEXTURE_AVX2
+	const __m256i color8 = _mm256_set1_epi32(int(packed));
+	for (;i+8<=count;i+=8)
+	{
+		__m256i* pixels = (__m256i*)(dst+i*4);
+		_mm256_storeu_si256(pixels,_mm256_adds_epu8(_mm256_loadu_si256(pixels),color8));
+	}
+#endif
+#ifdef RENDER_TEXTURE_SSE2
+	const __m128i color4 = _mm_set1_epi32(int(packed));
+	for (;i+4<=count;i+=4)
+	{
+		__m128i* pixels = (__m128i*)(dst+i*4);
+		_mm_storeu_si128(pixels,_mm_adds_epu8(_mm_loadu_si128(pixels),color4));
+	}
+#endif
+	unsigned char addend[4];
+	memcpy(addend,&packed,4);
+	for (;i<count;i++)
+	{
+		addBytes(dst+i*4,addend);
+	}
+}
+
+#ifdef RENDER_TEXTURE_SSE2
+///4 RGBA float pixels to 16 bytes
+static inline __m128i	convert4(const float* src)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 scale = _mm_set1_ps(255.f);
+	const __m128i p0 = _mm_cvttps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src),zero),one),scale));
+	const __m128i p1 = _mm_cvttps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src+4),zero),one),scale));
+	const __m128i p2 = _mm_cvttps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src+8),zero),one),scale));
+	const __m128i p3 = _mm_cvttps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src+12),zero),one),scale));
+	return _mm_packus_epi16(_mm_packs_epi32(p0,p1),_mm_packs_epi32(p2,p3));
+}
+#endif
+
+#ifdef RENDER_TEXTURE_AVX2
+///8 RGBA float pixels to 32 bytes. The packs work per 128 bit lane, the permute puts the pixels back in order.
+static inline __m256i	convert8(const float* src)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.f);
+	const __m256 scale = _mm256_set1_ps(255.f);
+	const __m256i p0 = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src),zero),one),scale));
+	const __m256i p1 = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src+8),zero),one),scale));
+	const __m256i p2 = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src+16),zero),one),scale));
+	const __m256i p3 = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src+24),zero),one),scale));
+	const __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(p0,p1),_mm256_packs_epi32(p2,p3));
+	return _mm256_permutevar8x32_epi32(packed,_mm256_setr_epi32(0,4,1,5,2,6,3,7));
+}
+#endif
+
+static void	convertPixels(unsigned char* dst,const float* src,int count)
+{
+	int i = 0;
+#ifdef RENDER_TEXTURE_AVX2
+	for (;i+8<=count;i+=8)
+	{
+		_mm256_storeu_si256((__m256i*)(dst+i*4),convert8(src+i*4));
+	}
+#endif
+#ifdef RENDER_TEXTURE_SSE2
+	for (;i+4<=count;i+=4)
+	{
+		_mm_storeu_si128((__m128i*)(dst+i*4),convert4(src+i*4));
+	}
+#endif
+	for (i*=4;i<count*4;i++)
+	{
+		dst[i] = toByte(src[i]);
+	}
+}
+
+static void	addConvertedPixels(unsigned char* dst,const float* src,int count)
+{
+	int i = 0;
+#ifdef RENDER_TEXTURE_AVX2
+	const __m256i noAlpha8 = _mm256_set1_epi32(0x00ffffff);
+	for (;i+8<=count;i+=8)
+	{
+		__m256i* pixels = (__m256i*)(dst+i*4);
+		const __m256i addend = _mm256_and_si256(convert8(src+i*4),noAlpha8);
+		_mm256_storeu_si256(pixels,_mm256_adds_epu8(_mm256_loadu_si256(pixels),addend));
+	}
+#endif
+#ifdef RENDER_TEXTURE_SSE2
+	const __m128i noAlpha4 = _mm_set1_epi32(0x00ffffff);
+	for (;i+4<=count;i+=4)
+	{
+		__m128i* pixels = (__m128i*)(dst+i*4);
+		const __m128i addend = _mm_and_si128(convert4(src+i*4),noAlpha4);
+		_mm_storeu_si128(pixels,_mm_adds_epu8(_mm_loadu_si128(pixels),addend));
+	}
+#endif
+	for (;i<count;i++)
+	{
+		const unsigned char addend[3] = {toByte(src[i*4]),toByte(src[i*4+1]),toByte(src[i*4+2])};
+		addBytes(dst+i*4,addend);
+	}
+}
+
+static void	expandPixels(float* dst,const unsigned char* src,int count)
+{
+	int i = 0;
+#ifdef RENDER_TEXTURE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 scale = _mm_set1_ps(255.f);
+	for (;i+4<=count;i+=4)
+	{
+		const __m128i bytes = _mm_loadu_si128((const __m128i*)(src+i*4));
+		const __m128i low = _mm_unpacklo_epi8(bytes,zero);
+		const __m128i high = _mm_unpackhi_epi8(bytes,zero);
+		float* out = dst+i*4;
+		_mm_storeu_ps(out,_mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low,zero)),scale));
+		_mm_storeu_ps(out+4,_mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low,zero)),scale));
+		_mm_storeu_ps(out+8,_mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high,zero)),scale));
+		_mm_storeu_ps(out+12,_mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high,zero)),scale));
+	}
+#endif
+	for (i*=4;i<count*4;i++)
+	{
+		dst[i] = src[i]*1.f/255.f;
+	}
+}
+
+///clip the span to the texture, skip is the number of pixels cut off at the left
+static bool	clipSpan(int width,int height,int& x,int y,int& count,int& skip)
+{
+	skip = 0;
+	if (y < 0 || y >= height || count <= 0)
+		return false;
+	if (x < 0)
+	{
+		skip = -x;
+		count += x;
+		x = 0;
+	}
+	if (x+count > width)
+		count = width-x;
+	return count > 0;
+}
+
+void	renderTexture::clear(const btVector4& rgba)
+{
+	fillRect(0,0,m_width,m_height,rgba);
+}
+
+void	renderTexture::fillSpan(int x,int y,int count,const btVector4& rgba)
+{
+	fillRect(x,y,count,1,rgba);
+}
+
+void	renderTexture::fillRect(int x,int y,int width,int height,const btVector4& rgba)
+{
+	const unsigned int packed = packColor(rgba,true);
+	for (int row=btMax(y,0);row<btMin(y+height,m_height);row++)
+	{
+		int startX = x;
+		int count = width;
+		int skip;
+		if (clipSpan(m_width,m_height,startX,row,count,skip))
+			fillPixels(&m_buffer[(startX+row*m_width)*4],count,packed);
+	}
+}
+
+void	renderTexture::addColorSpan(int x,int y,int count,const btVector4& rgba)
+{
+	addColorRect(x,y,count,1,rgba);
+}
+
+void	renderTexture::addColorRect(int x,int y,int width,int height,const btVector4& rgba)
+{
+	const unsigned int packed = packColor(rgba,false);
+	for (int row=btMax(y,0);row<btMin(y+height,m_height);row++)
+	{
+		int startX = x;
+		int count = width;
+		int skip;
+		if (clipSpan(m_width,m_height,startX,row,count,skip))
+			addPixels(&m_buffer[(startX+row*m_width)*4],count,packed);
+	}
+}
+
+void	renderTexture::setSpan(int x,int y,int count,const float* rgba)
+{
+	int skip;
+	if (clipSpan(m_width,m_height,x,y,count,skip))
+		convertPixels(&m_buffer[(x+y*m_width)*4],rgba+skip*4,count);
+}
+
+void	renderTexture::addSpan(int x,int y,int count,const float* rgba)
+{
+	int skip;
+	if (clipSpan(m_width,m_height,x,y,count,skip))
+		addConvertedPixels(&m_buffer[(x+y*m_width)*4],rgba+skip*4,count);
+}
+
+void	renderTexture::getSpan(int x,int y,int count,float* rgba) const
+{
+	int skip;
+	if (clipSpan(m_width,m_height,x,y,count,skip))
+		expandPixels(rgba+skip*4,&m_buffer[(x+y*m_width)*4],count);
+}
+
+bool	renderTexture::writePPM(const char* fileName) const
+{
+	FILE* file = fopen(fileName,"wb");
+	if (!file)
+		return false;
+	fprintf(file,"P6\n%d %d\n255\n",m_width,m_height);
+	btAlignedObjectArray<unsigned char> row;
+	row.resize(m_width*3);
+	bool ok = true;
+	for (int y=0;y<m_height && ok;y++)
+	{
+		const unsigned char* pixel = &m_buffer[y*m_width*4];
+		for (int x=0;x<m_width;x++)
+		{
+			row[x*3] = pixel[x*4];
+			row[x*3+1] = pixel[x*4+1];
+			row[x*3+2] = pixel[x*4+2];
+		}
+		ok = fwrite(&row[0],1,row.size(),file)==size_t(row.size());
+	}
+	fclose(file);
+	return ok;
+}
+
+static unsigned int	sCrcTable[256];
+
+static bool	initCrcTable()
+{
+	for (unsigned int n=0;n<256;n++)
+	{
+		unsigned int c = n;
+		for (int k=0;k<8;k++)
+		{
+			c = (c&1) ? 0xedb88320u^(c>>1) : c>>1;
+		}
+		sCrcTable[n] = c;
+	}
+	return true;
+}
+
+///filled before main, so images can be written from several threads
+static const bool	sCrcTableInitialized = initCrcTable();
+
+static unsigned int	updateCrc(unsigned int crc,const unsigned char* data,int length)
+{
+	btAssert(sCrcTableInitialized);
+	for (int i=0;i<length;i++)
+	{
+		crc = sCrcTable[(crc^data[i])&0xff]^(crc>>8);
+	}
+	return crc;
+}
+
+static void	appendBigEndian(btAlignedObjectArray<unsigned char>& data,unsigned int value)
+{
+	data.push_back((unsigned char)(value>>24));
+	data.push_back((unsigned char)(value>>16));
+	data.push_back((unsigned char)(value>>8));
+	data.push_back((unsigned char)value);
+}
+
+///length, type, data and the CRC of type and data
+static bool	writePngChunk(FILE* file,const char* type,const btAlignedObjectArray<unsigned char>& data)
+{
+	btAlignedObjectArray<unsigned char> chunk;
+	appendBigEndian(chunk,(unsigned int)data.size());
+	for (int i=0;i<4;i++)
+	{
+		chunk.push_back((unsigned char)type[i]);
+	}
+	for (int i=0;i<data.size();i++)
+	{
+		chunk.push_back(data[i]);
+	}
+	const unsigned int crc = updateCrc(0xffffffffu,&chunk[4],chunk.size()-4)^0xffffffffu;
+	appendBigEndian(chunk,crc);
+	return fwrite(&chunk[0],1,chunk.size(),file)==size_t(chunk.size());
+}
+
+///the scanlines of the image, each with its PNG filter type in front. Compressed images take the filter of
+///None, Sub and Up with the smallest sum of absolute differences per row, the usual heuristic.
+static void	filterScanlines(const unsigned char* pixels,int width,int height,bool chooseFilter,btAlignedObjectArray<unsigned char>& raw)
+{
+	const int stride = width*4;
+	raw.resize((stride+1)*height);
+	for (int y=0;y<height;y++)
+	{
+		const unsigned char* row = pixels+y*stride;
+		const unsigned char* prior = y>0 ? row-stride : 0;
+		unsigned char* dst = &raw[y*(stride+1)];
+		int filter = 0;
+		if (chooseFilter)
+		{
+			int sums[3] = {0,0,0};
+			for (int i=0;i<stride;i++)
+			{
+				sums[0] += btMin(int(row[i]),256-int(row[i]));
+				const unsigned char sub = (unsigned char)(row[i]-(i>=4 ? row[i-4] : 0));
+				sums[1] += btMin(int(sub),256-int(sub));
+				const unsigned char up = (unsigned char)(row[i]-(prior ? prior[i] : 0));
+				sums[2] += btMin(int(up),256-int(up));
+			}
+			filter = sums[1] < sums[0] ? 1 : 0;
+			if (sums[2] < sums[filter])
+				filter = 2;
+		}
+		dst[0] = (unsigned char)filter;
+		for (int i=0;i<stride;i++)
+		{
+			unsigned char predicted = 0;
+			if (filter==1 && i>=4)
+				predicted = row[i-4];
+			else if (filter==2 && prior)
+				predicted = prior[i];
+			dst[i+1] = (unsigned char)(row[i]-predicted);
+		}
+	}
+}
+
+///deflate stored blocks, at most 65535 bytes each
+static void	deflateStored(const btAlignedObjectArray<unsigned char>& raw,btAlignedObjectArray<unsigned char>& out)
+{
+	int offset = 0;
+	do
+	{
+		const unsigned int blockSize = (unsigned int)btMin(raw.size()-offset,65535);
+		out.push_back(offset+int(blockSize)>=raw.size() ? 1 : 0);
+		out.push_back((unsigned char)(blockSize&0xff));
+		out.push_back((unsigned char)(blockSize>>8));
+		out.push_back((unsigned char)(~blockSize&0xff));
+		out.push_back((unsigned char)((~blockSize>>8)&0xff));
+		for (int i=0;i<int(blockSize);i++)
+		{
+			out.push_back(raw[offset+i]);
+		}
+		offset += int(blockSize);
+	} while (offset < raw.size());
+}
+
+///deflate bit stream, least significant bit first
+struct DeflateBits
+{
+	btAlignedObjectArray<unsigned char>&	m_out;
+	unsigned int	m_bits;
+	int		m_numBits;
+
+	DeflateBits(btAlignedObjectArray<unsigned char>& out)
+	:m_out(out),
+	m_bits(0),
+	m_numBits(0)
+	{
+	}
+	void	put(unsigned int value,int count)
+	{
+		m_bits |= value<<m_numBits;
+		m_numBits += count;
+		while (m_numBits >= 8)
+		{
+			m_out.push_back((unsigned char)(m_bits&0xff));
+			m_bits >>= 8;
+			m_numBits -= 8;
+		}
+	}
+	///Huffman codes are stored most significant bit first
+	void	putCode(unsigned int code,int length)
+	{
+		unsigned int reversed = 0;
+		for (int i=0;i<length;i++)
+		{
+			reversed = (reversed<<1)|((code>>i)&1);
+		}
+		put(reversed,length);
+	}
+	///the fixed Huffman code of a literal/length symbol (RFC 1951 3.2.6)
+	void	putSymbol(int symbol)
+	{
+		if (symbol < 144)
+			putCode(0x30+symbol,8);
+		else if (symbol < 256)
+			putCode(0x190+symbol-144,9);
+		else if (symbol < 280)
+			putCode(symbol-256,7);
+		else
+			putCode(0xc0+symbol-280,8);
+	}
+	void	flush()
+	{
+		if (m_numBits > 0)
+			m_out.push_back((unsigned char)(m_bits&0xff));
+		m_bits = 0;
+		m_numBits = 0;
+	}
+};
+
+static const int	sLengthBase[29] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+static const int	sLengthExtra[29] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+static const int	sDistanceBase[30] = {1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577};
+static const int	sDistanceExtra[30] = {0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+
+///one deflate block with the fixed Huffman codes and greedy LZ77 matches from hash chains. It is much
+///smaller than stored blocks for rendered frames, with their flat colors and repeated rows, and fast enough
+///to keep up with a capture thread.
+static void	deflateFixed(const btAlignedObjectArray<unsigned char>& raw,btAlignedObjectArray<unsigned char>& out)
+{
+	const int WINDOW_SIZE = 32768;
+	const int HASH_BITS = 15;
+	const int MIN_MATCH = 3;
+	const int MAX_MATCH = 258;
+	const int MAX_CHAIN = 16;
+	///longer matches do not insert their inner positions into the chains
+	const int MAX_INSERT = 32;
+	const unsigned char* data = raw.size() ? &raw[0] : 0;
+	const int size = raw.size();
+	btAlignedObjectArray<int> head;
+	head.resize(1<<HASH_BITS,-1);
+	btAlignedObjectArray<int> previous;
+	previous.resize(WINDOW_SIZE,-1);
+
+	DeflateBits bits(out);
+	bits.put(1,1);	//last block
+	bits.put(1,2);	//fixed Huffman codes
+
+	int pos = 0;
+	while (pos < size)
+	{
+		int bestLength = 0;
+		int bestDistance = 0;
+		int hash = 0;
+		if (pos+MIN_MATCH <= size)
+		{
+			hash = ((data[pos]<<10)^(data[pos+1]<<5)^data[pos+2])&((1<<HASH_BITS)-1);
+			const int maxLength = btMin(MAX_MATCH,size-pos);
+			int candidate = head[hash];
+			for (int chain=0;chain<MAX_CHAIN && candidate>=0 && pos-candidate<=WINDOW_SIZE;chain++)
+			{
+				if (data[candidate+bestLength]==data[pos+bestLength])
+				{
+					int length = 0;
+					while (length<maxLength && data[candidate+length]==data[pos+length])
+					{
+						length++;
+					}
+					if (length > bestLength)
+					{
+						bestLength = length;
+						bestDistance = pos-candidate;
+						if (length==maxLength)
+							break;
+					}
+				}
+				const int next = previous[candidate&(WINDOW_SIZE-1)];
+				if (next >= candidate)
+					break;
+				candidate = next;
+			}
+			previous[pos&(WINDOW_SIZE-1)] = head[hash];
+			head[hash] = pos;
+		}
+
+		if (bestLength < MIN_MATCH)
+		{
+			bits.putSymbol(data[pos]);
+			pos++;
+			continue;
+		}
+
+		int lengthCode = 0;
+		while (lengthCode<28 && sLengthBase[lengthCode+1]<=bestLength)
+		{
+			lengthCode++;
+		}
+		bits.putSymbol(257+lengthCode);
+		bits.put(bestLength-sLengthBase[lengthCode],sLengthExtra[lengthCode]);
+		int distanceCode = 0;
+		while (distanceCode<29 && sDistanceBase[distanceCode+1]<=bestDistance)
+		{
+			distanceCode++;
+		}
+		bits.putCode(distanceCode,5);
+		bits.put(bestDistance-sDistanceBase[distanceCode],sDistanceExtra[distanceCode]);
+
+		if (bestLength <= MAX_INSERT)
+		{
+			for (int i=1;i<bestLength && pos+i+MIN_MATCH<=size;i++)
+			{
+				const int p = pos+i;
+				const int h = ((data[p]<<10)^(data[p+1]<<5)^data[p+2])&((1<<HASH_BITS)-1);
+				previous[p&(WINDOW_SIZE-1)] = head[h];
+				head[h] = p;
+			}
+		}
+		pos += bestLength;
+	}
+	bits.putSymbol(256);
+	bits.flush();
+}
+
+bool	renderTexture::writePNG(const char* fileName,bool compress) const
+{
+	FILE* file = fopen(fileName,"wb");
+	if (!file)
+		return false;
+	static const unsigned char signature[8] = {137,80,78,71,13,10,26,10};
+	bool ok = fwrite(signature,1,8,file)==8;
+
+	btAlignedObjectArray<unsigned char> header;
+	appendBigEndian(header,(unsigned int)m_width);
+	appendBigEndian(header,(unsigned int)m_height);
+	header.push_back(8);	//bit depth
+	header.push_back(6);	//RGBA
+	header.push_back(0);	//deflate
+	header.push_back(0);	//adaptive filtering
+	header.push_back(0);	//no interlace
+	ok = ok && writePngChunk(file,"IHDR",header);
+
+	btAlignedObjectArray<unsigned char> raw;
+	filterScanlines(m_buffer,m_width,m_height,compress,raw);
+	btAlignedObjectArray<unsigned char> zlib;
+	zlib.reserve(compress ? raw.size()/4+64 : raw.size()+raw.size()/65535*5+16);
+	zlib.push_back(0x78);
+	zlib.push_back(0x01);
+	if (compress)
+		deflateFixed(raw,zlib);
+	else
+		deflateStored(raw,zlib);
+	unsigned int adlerA = 1;
+	unsigned int adlerB = 0;
+	for (int i=0;i<raw.size();i++)
+	{
+		adlerA = (adlerA+raw[i])%65521;
+		adlerB = (adlerB+adlerA)%65521;
+	}
+	appendBigEndian(zlib,(adlerB<<16)|adlerA);
+	ok = ok && writePngChunk(file,"IDAT",zlib);
+
+	btAlignedObjectArray<unsigned char> end;
+	ok = ok && writePngChunk(file,"IEND",end);
+	fclose(file);
+	return ok;
+}
@@ -62,11 +62,37 @@ public:
 			pixel[3]*1.f/255.f);
 	}
 
+	///fill the whole texture with one color
+	void	clear(const btVector4& rgba);
+
+	///Span and rectangle versions of setPixel, addPixel and getPixel. Pixels outside the texture are skipped.
+	///Colors are clamped to [0..1] and scaled by 255 with truncation, so a span gives the same bytes as setPixel
+	///and addPixel for colors in range. The loops use AVX2 or SSE2 when the compiler targets them.
+	void	fillSpan(int x,int y,int count,const btVector4& rgba);
+	void	fillRect(int x,int y,int width,int height,const btVector4& rgba);
+	///saturating add of one color to red, green and blue, alpha is kept like addPixel
+	void	addColorSpan(int x,int y,int count,const btVector4& rgba);
+	void	addColorRect(int x,int y,int width,int height,const btVector4& rgba);
+	///rgba holds 4 floats per pixel, e.g. one row of a float image
+	void	setSpan(int x,int y,int count,const float* rgba);
+	///saturating add of 4 floats per pixel to red, green and blue, alpha is kept
+	void	addSpan(int x,int y,int count,const float* rgba);
+	///the reverse of setSpan, 4 floats in [0..1] per pixel
+	void	getSpan(int x,int y,int count,float* rgba) const;
+
+	///rows top to bottom, RGBA8
+	unsigned char*	getBuffer() { return m_buffer;}
 	const unsigned char*	getBuffer() const { return m_buffer;}
 	int	getWidth() const { return m_width;}
 	int	getHeight() const { return m_height;}
 	void grapicalPrintf(char* str,	void* fontData, int startx = 0,int starty=0);
 
+	///binary PPM (P6), the alpha channel is dropped
+	bool	writePPM(const char* fileName) const;
+	///RGBA PNG. compress filters the rows and deflates them with fixed Huffman codes, otherwise the rows are
+	///stored uncompressed. Both give the same file on every platform.
+	bool	writePNG(const char* fileName,bool compress=true) const;
+
 };
 
 #endif //RENDER_TEXTURE_H
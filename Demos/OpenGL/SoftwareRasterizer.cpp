@@ -0,0 +1,535 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "SoftwareRasterizer.h"
+#include "RenderTexture.h"
+#include "TaskPool.h"
+#include "btBulletDynamicsCommon.h"
+#include "BulletCollision/CollisionShapes/btShapeHull.h"
+#include "BulletCollision/CollisionShapes/btTriangleCallback.h"
+#include "LinearMath/btQuickprof.h"
+#include <string.h>
+
+///light that reaches the faces turned away from the sun
+static const btScalar	sAmbient = btScalar(0.25);
+///half size of the quad that stands in for a static plane
+static const btScalar	sPlaneExtent = btScalar(1000.);
+
+///collects the triangles of a concave shape
+struct RasterTriangleCollector : public btTriangleCallback
+{
+	SoftwareRasterizer::RasterMesh*	m_mesh;
+
+	RasterTriangleCollector(SoftwareRasterizer::RasterMesh* mesh)
+		:m_mesh(mesh)
+	{
+	}
+
+	virtual void	processTriangle(btVector3* triangle,int partId,int triangleIndex)
+	{
+		(void)partId;
+		(void)triangleIndex;
+		for (int i=0;i<3;i++)
+		{
+			m_mesh->m_indices.push_back(m_mesh->m_vertices.size());
+			m_mesh->m_vertices.push_back(triangle[i]);
+		}
+	}
+};
+
+///turn every triangle of a closed convex mesh away from the centroid of its vertices
+static void	orientOutwards(SoftwareRasterizer::RasterMesh& mesh)
+{
+	btVector3 centroid(0,0,0);
+	for (int i=0;i<mesh.m_vertices.size();i++)
+	{
+		centroid += mesh.m_vertices[i];
+	}
+	if (mesh.m_vertices.size())
+		centroid /= btScalar(mesh.m_vertices.size());
+
+	for (int i=0;i+2<mesh.m_indices.size();i+=3)
+	{
+		const btVector3& a = mesh.m_vertices[mesh.m_indices[i]];
+		const btVector3& b = mesh.m_vertices[mesh.m_indices[i+1]];
+		const btVector3& c = mesh.m_vertices[mesh.m_indices[i+2]];
+		if ((b-a).cross(c-a).dot(a-centroid) < btScalar(0.))
+		{
+			btSwap(mesh.m_indices[i+1],mesh.m_indices[i+2]);
+		}
+	}
+}
+
+struct TileTask : public TaskPool::Task
+{
+	SoftwareRasterizer*	m_rasterizer;
+
+	virtual void	run(int index,int threadIndex)
+	{
+		(void)threadIndex;
+		m_rasterizer->rasterizeTile(index);
+	}
+};
+
+SoftwareRasterizer::SoftwareRasterizer(int width,int height,int numThreads)
+:m_width(width),
+m_height(height),
+m_numTilesX((width+TILE_SIZE-1)/TILE_SIZE),
+m_numTilesY((height+TILE_SIZE-1)/TILE_SIZE),
+m_tanHalfFovY(btScalar(1.)),
+m_zNear(btScalar(1.)),
+m_zFar(btScalar(10000.)),
+m_lightDirection(btVector3(1,-2,1).normalized()),
+m_setupTime(0.),
+m_rasterTime(0.)
+{
+	m_texture = new renderTexture(width,height);
+	m_depth.resize(width*height,1.f);
+	m_taskPool = new TaskPool(numThreads);
+	m_tileBins.resize(m_numTilesX*m_numTilesY);
+	m_view.setIdentity();
+	setClearColor(btVector4(btScalar(0.7),btScalar(0.7),btScalar(0.7),btScalar(1.)));
+}
+
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+	clearMeshCache();
+	delete m_taskPool;
+	delete m_texture;
+}
+
+int	SoftwareRasterizer::getNumThreads() const
+{
+	return m_taskPool->getNumThreads();
+}
+
+void	SoftwareRasterizer::setCamera(const btVector3& eye,const btVector3& target,const btVector3& up,btScalar fovY,btScalar zNear,btScalar zFar)
+{
+	btVector3 forward = target-eye;
+	if (forward.length2() < SIMD_EPSILON)
+		forward.setValue(0,0,-1);
+	forward.normalize();
+	btVector3 right = forward.cross(up);
+	if (right.length2() < SIMD_EPSILON)
+	{
+		btVector3 unused;
+		btPlaneSpace1(forward,right,unused);
+	}
+	right.normalize();
+	const btVector3 cameraUp = right.cross(forward);
+
+	///rows are the camera axes, the camera looks down -z like OpenGL
+	const btMatrix3x3 basis(right.getX(),right.getY(),right.getZ(),
+		cameraUp.getX(),cameraUp.getY(),cameraUp.getZ(),
+		-forward.getX(),-forward.getY(),-forward.getZ());
+	m_view.setBasis(basis);
+	m_view.setOrigin(-(basis*eye));
+	m_tanHalfFovY = btTan(fovY*SIMD_RADS_PER_DEG*btScalar(0.5));
+	m_zNear = zNear;
+	m_zFar = zFar;
+}
+
+void	SoftwareRasterizer::setLightDirection(const btVector3& direction)
+{
+	if (direction.length2() > SIMD_EPSILON)
+		m_lightDirection = direction.normalized();
+}
+
+void	SoftwareRasterizer::setClearColor(const btVector4& rgba)
+{
+	m_clearColor = rgba;
+}
+
+void	SoftwareRasterizer::invalidateShape(const btCollisionShape* shape)
+{
+	RasterMesh** mesh = m_meshes.find(btHashPtr(shape));
+	if (mesh)
+	{
+		delete *mesh;
+		m_meshes.remove(btHashPtr(shape));
+	}
+}
+
+void	SoftwareRasterizer::clearMeshCache()
+{
+	for (int i=0;i<m_meshes.size();i++)
+	{
+		delete *m_meshes.getAtIndex(i);
+	}
+	m_meshes.clear();
+}
+
+SoftwareRasterizer::RasterMesh*	SoftwareRasterizer::buildMesh(const btCollisionShape* shape) const
+{
+	RasterMesh* mesh = 0;
+	switch (shape->getShapeType())
+	{
+	case BOX_SHAPE_PROXYTYPE:
+		{
+			const btVector3 halfExtents = static_cast<const btBoxShape*>(shape)->getHalfExtentsWithMargin();
+			mesh = new RasterMesh;
+			for (int i=0;i<8;i++)
+			{
+				mesh->m_vertices.push_back(btVector3((i&1) ? halfExtents.getX() : -halfExtents.getX(),
+					(i&2) ? halfExtents.getY() : -halfExtents.getY(),
+					(i&4) ? halfExtents.getZ() : -halfExtents.getZ()));
+			}
+			static const int faces[6][4] = {{0,2,3,1},{4,5,7,6},{0,1,5,4},{2,6,7,3},{0,4,6,2},{1,3,7,5}};
+			for (int f=0;f<6;f++)
+			{
+				mesh->m_indices.push_back(faces[f][0]);
+				mesh->m_indices.push_back(faces[f][1]);
+				mesh->m_indices.push_back(faces[f][2]);
+				mesh->m_indices.push_back(faces[f][0]);
+				mesh->m_indices.push_back(faces[f][2]);
+				mesh->m_indices.push_back(faces[f][3]);
+			}
+			mesh->m_closed = true;
+			orientOutwards(*mesh);
+			break;
+		}
+	case STATIC_PLANE_PROXYTYPE:
+		{
+			const btStaticPlaneShape* plane = static_cast<const btStaticPlaneShape*>(shape);
+			const btVector3& normal = plane->getPlaneNormal();
+			const btVector3 center = normal*plane->getPlaneConstant();
+			btVector3 tangent0,tangent1;
+			btPlaneSpace1(normal,tangent0,tangent1);
+			tangent0 *= sPlaneExtent;
+			tangent1 *= sPlaneExtent;
+			mesh = new RasterMesh;
+			mesh->m_vertices.push_back(center-tangent0-tangent1);
+			mesh->m_vertices.push_back(center+tangent0-tangent1);
+			mesh->m_vertices.push_back(center+tangent0+tangent1);
+			mesh->m_vertices.push_back(center-tangent0+tangent1);
+			const bool flip = tangent0.cross(tangent1).dot(normal) < btScalar(0.);
+			static const int quad[6] = {0,1,2,0,2,3};
+			for (int i=0;i<6;i++)
+			{
+				mesh->m_indices.push_back(flip ? quad[5-i] : quad[i]);
+			}
+			mesh->m_closed = true;
+			break;
+		}
+	default:
+		{
+			if (shape->isConvex())
+			{
+				const btConvexShape* convex = static_cast<const btConvexShape*>(shape);
+				btShapeHull hull(convex);
+				if (!hull.buildHull(convex->getMargin()))
+					break;
+				mesh = new RasterMesh;
+				for (int i=0;i<hull.numVertices();i++)
+				{
+					mesh->m_vertices.push_back(hull.getVertexPointer()[i]);
+				}
+				for (int i=0;i<hull.numIndices();i++)
+				{
+					mesh->m_indices.push_back(int(hull.getIndexPointer()[i]));
+				}
+				mesh->m_closed = true;
+				orientOutwards(*mesh);
+			} else if (shape->isConcave())
+			{
+				mesh = new RasterMesh;
+				mesh->m_closed = false;
+				RasterTriangleCollector collector(mesh);
+				const btVector3 aabbMax(BT_LARGE_FLOAT,BT_LARGE_FLOAT,BT_LARGE_FLOAT);
+				static_cast<const btConcaveShape*>(shape)->processAllTriangles(&collector,-aabbMax,aabbMax);
+			}
+		}
+	}
+	return mesh;
+}
+
+const SoftwareRasterizer::RasterMesh*	SoftwareRasterizer::getMesh(const btCollisionShape* shape)
+{
+	RasterMesh** cached = m_meshes.find(btHashPtr(shape));
+	if (cached)
+		return *cached;
+	//shapes that can't be drawn are cached too, as a null mesh
+	RasterMesh* mesh = buildMesh(shape);
+	m_meshes.insert(btHashPtr(shape),mesh);
+	return mesh;
+}
+
+bool	SoftwareRasterizer::isSphereVisible(const btVector3& center,btScalar radius) const
+{
+	if (center.getZ()-radius > -m_zNear || center.getZ()+radius < -m_zFar)
+		return false;
+	const btScalar tanHalfFovX = m_tanHalfFovY*btScalar(m_width)/btScalar(m_height);
+	///distance to the side planes through the eye, positive outside
+	const btScalar scaleX = btScalar(1.)/btSqrt(btScalar(1.)+tanHalfFovX*tanHalfFovX);
+	const btScalar scaleY = btScalar(1.)/btSqrt(btScalar(1.)+m_tanHalfFovY*m_tanHalfFovY);
+	if ((btFabs(center.getX())+center.getZ()*tanHalfFovX)*scaleX > radius)
+		return false;
+	if ((btFabs(center.getY())+center.getZ()*m_tanHalfFovY)*scaleY > radius)
+		return false;
+	return true;
+}
+
+void	SoftwareRasterizer::emitTriangle(const btVector3& a,const btVector3& b,const btVector3& c,const unsigned char* color)
+{
+	const btVector3* corners[3] = {&a,&b,&c};
+	const btScalar focal = btScalar(1.)/m_tanHalfFovY;
+	const btScalar aspect = btScalar(m_width)/btScalar(m_height);
+	const btScalar depthScale = (m_zFar+m_zNear)/(m_zNear-m_zFar);
+	const btScalar depthOffset = btScalar(2.)*m_zFar*m_zNear/(m_zNear-m_zFar);
+
+	ScreenTriangle tri;
+	float minX = float(m_width),minY = float(m_height),maxX = 0.f,maxY = 0.f;
+	for (int i=0;i<3;i++)
+	{
+		const btVector3& p = *corners[i];
+		const btScalar w = -p.getZ();
+		const btScalar ndcX = focal/aspect*p.getX()/w;
+		const btScalar ndcY = focal*p.getY()/w;
+		const btScalar ndcZ = (depthScale*p.getZ()+depthOffset)/w;
+		tri.m_x[i] = float((ndcX*btScalar(0.5)+btScalar(0.5))*btScalar(m_width));
+		tri.m_y[i] = float((btScalar(0.5)-ndcY*btScalar(0.5))*btScalar(m_height));
+		tri.m_z[i] = float(ndcZ*btScalar(0.5)+btScalar(0.5));
+		minX = btMin(minX,tri.m_x[i]);
+		minY = btMin(minY,tri.m_y[i]);
+		maxX = btMax(maxX,tri.m_x[i]);
+		maxY = btMax(maxY,tri.m_y[i]);
+	}
+	if (maxX < 0.f || maxY < 0.f || minX >= float(m_width) || minY >= float(m_height))
+		return;
+	const float area = (tri.m_x[1]-tri.m_x[0])*(tri.m_y[2]-tri.m_y[0])-(tri.m_x[2]-tri.m_x[0])*(tri.m_y[1]-tri.m_y[0]);
+	if (btFabs(area) < 1e-8f)
+		return;
+	memcpy(tri.m_color,color,4);
+
+	const int triangleIndex = m_triangles.size();
+	m_triangles.push_back(tri);
+	//clamp before the conversion, vertices close to the near plane can be far off screen
+	const int tileX0 = int(btMax(minX,0.f))/TILE_SIZE;
+	const int tileY0 = int(btMax(minY,0.f))/TILE_SIZE;
+	const int tileX1 = int(btMin(maxX,float(m_width-1)))/TILE_SIZE;
+	const int tileY1 = int(btMin(maxY,float(m_height-1)))/TILE_SIZE;
+	for (int ty=tileY0;ty<=tileY1;ty++)
+	{
+		for (int tx=tileX0;tx<=tileX1;tx++)
+		{
+			m_tileBins[ty*m_numTilesX+tx].push_back(triangleIndex);
+		}
+	}
+}
+
+///clip the view space triangle against the near plane and emit the one or two triangles that are left
+void	SoftwareRasterizer::submitTriangle(const btVector3* viewVertices,const btVector3& color,btScalar intensity)
+{
+	unsigned char packed[4];
+	for (int i=0;i<3;i++)
+	{
+		packed[i] = (unsigned char)(btMin(btScalar(1.),color[i]*intensity)*btScalar(255.)+btScalar(0.5));
+	}
+	packed[3] = 255;
+
+	btVector3 polygon[4];
+	int numVertices = 0;
+	for (int i=0;i<3;i++)
+	{
+		const btVector3& a = viewVertices[i];
+		const btVector3& b = viewVertices[(i+1)%3];
+		const btScalar da = -m_zNear-a.getZ();
+		const btScalar db = -m_zNear-b.getZ();
+		if (da >= btScalar(0.))
+			polygon[numVertices++] = a;
+		if ((da >= btScalar(0.)) != (db >= btScalar(0.)))
+			polygon[numVertices++] = a+(b-a)*(da/(da-db));
+	}
+	for (int i=2;i<numVertices;i++)
+	{
+		emitTriangle(polygon[0],polygon[i-1],polygon[i],packed);
+	}
+}
+
+void	SoftwareRasterizer::submitShape(const btCollisionShape* shape,const btTransform& worldTransform,const btVector3& color)
+{
+	if (shape->isCompound())
+	{
+		const btCompoundShape* compound = static_cast<const btCompoundShape*>(shape);
+		for (int i=0;i<compound->getNumChildShapes();i++)
+		{
+			submitShape(compound->getChildShape(i),worldTransform*compound->getChildTransform(i),color);
+		}
+		return;
+	}
+
+	const RasterMesh* mesh = getMesh(shape);
+	if (!mesh)
+		return;
+
+	const btTransform modelView = m_view*worldTransform;
+	btVector3 center;
+	btScalar radius;
+	shape->getBoundingSphere(center,radius);
+	if (!isSphereVisible(modelView(center),radius))
+		return;
+
+	const btVector3 lightDirection = m_view.getBasis()*m_lightDirection;
+	btVector3 viewVertices[3];
+	for (int i=0;i+2<mesh->m_indices.size();i+=3)
+	{
+		for (int j=0;j<3;j++)
+		{
+			viewVertices[j] = modelView(mesh->m_vertices[mesh->m_indices[i+j]]);
+		}
+		btVector3 normal = (viewVertices[1]-viewVertices[0]).cross(viewVertices[2]-viewVertices[0]);
+		const btScalar length2 = normal.length2();
+		if (length2 < SIMD_EPSILON*SIMD_EPSILON)
+			continue;
+		//the eye is at the origin of view space
+		if (normal.dot(viewVertices[0]) >= btScalar(0.))
+		{
+			if (mesh->m_closed)
+				continue;
+			normal = -normal;
+		}
+		normal /= btSqrt(length2);
+		const btScalar intensity = sAmbient+(btScalar(1.)-sAmbient)*btMax(btScalar(0.),-normal.dot(lightDirection));
+		submitTriangle(viewVertices,color,intensity);
+	}
+}
+
+void	SoftwareRasterizer::renderWorld(const btCollisionWorld* world)
+{
+	BT_PROFILE("SoftwareRasterizer::renderWorld");
+	btClock clock;
+	m_triangles.resize(0);
+	for (int i=0;i<m_tileBins.size();i++)
+	{
+		m_tileBins[i].resize(0);
+	}
+
+	const btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	for (int i=0;i<objects.size();i++)
+	{
+		const btCollisionObject* colObj = objects[i];
+		btTransform trans = colObj->getWorldTransform();
+		const btRigidBody* body = btRigidBody::upcast(colObj);
+		if (body && body->getMotionState())
+		{
+			trans = static_cast<const btDefaultMotionState*>(body->getMotionState())->m_graphicsWorldTrans;
+		}
+
+		///the colors of DemoApplication::renderscene
+		btVector3 color(1.f,1.0f,0.5f);
+		if (i&1)
+			color = btVector3(0.f,0.0f,1.f);
+		if (colObj->getActivationState() == ACTIVE_TAG)
+		{
+			color += (i&1) ? btVector3(1.f,0.f,0.f) : btVector3(.5f,0.f,0.f);
+		}
+		if (colObj->getActivationState() == ISLAND_SLEEPING)
+		{
+			color += (i&1) ? btVector3(0.f,1.f,0.f) : btVector3(0.f,0.5f,0.f);
+		}
+		submitShape(colObj->getCollisionShape(),trans,color);
+	}
+	m_setupTime = double(clock.getTimeMicroseconds())*0.001;
+
+	clock.reset();
+	TileTask task;
+	task.m_rasterizer = this;
+	m_taskPool->parallelFor(m_tileBins.size(),task);
+	m_rasterTime = double(clock.getTimeMicroseconds())*0.001;
+}
+
+void	SoftwareRasterizer::rasterizeTile(int tileIndex)
+{
+	const int tileX = tileIndex%m_numTilesX;
+	const int tileY = tileIndex/m_numTilesX;
+	const int x0 = tileX*TILE_SIZE;
+	const int y0 = tileY*TILE_SIZE;
+	const int x1 = btMin(x0+TILE_SIZE,m_width);
+	const int y1 = btMin(y0+TILE_SIZE,m_height);
+	unsigned char* colors = m_texture->getBuffer();
+
+	m_texture->fillRect(x0,y0,x1-x0,y1-y0,m_clearColor);
+	for (int y=y0;y<y1;y++)
+	{
+		for (int x=x0;x<x1;x++)
+		{
+			m_depth[y*m_width+x] = 1.f;
+		}
+	}
+
+	const btAlignedObjectArray<int>& bin = m_tileBins[tileIndex];
+	for (int b=0;b<bin.size();b++)
+	{
+		const ScreenTriangle& tri = m_triangles[bin[b]];
+		int i1 = 1;
+		int i2 = 2;
+		float area = (tri.m_x[1]-tri.m_x[0])*(tri.m_y[2]-tri.m_y[0])-(tri.m_x[2]-tri.m_x[0])*(tri.m_y[1]-tri.m_y[0]);
+		if (area < 0.f)
+		{
+			i1 = 2;
+			i2 = 1;
+			area = -area;
+		}
+		const float ax = tri.m_x[0], ay = tri.m_y[0], az = tri.m_z[0];
+		const float bx = tri.m_x[i1], by = tri.m_y[i1], bz = tri.m_z[i1];
+		const float cx = tri.m_x[i2], cy = tri.m_y[i2], cz = tri.m_z[i2];
+
+		const int minX = int(btMax(float(x0),btMin(ax,btMin(bx,cx))));
+		const int minY = int(btMax(float(y0),btMin(ay,btMin(by,cy))));
+		const int maxX = int(btMin(float(x1-1),btMax(ax,btMax(bx,cx))));
+		const int maxY = int(btMin(float(y1-1),btMax(ay,btMax(by,cy))));
+		if (minX > maxX || minY > maxY)
+			continue;
+
+		///edge functions, w0 is the weight of a and so on
+		const float invArea = 1.f/area;
+		const float stepX0 = by-cy, stepX1 = cy-ay, stepX2 = ay-by;
+		for (int y=minY;y<=maxY;y++)
+		{
+			const float py = float(y)+0.5f;
+			const float px = float(minX)+0.5f;
+			float w0 = (cx-bx)*(py-by)-(cy-by)*(px-bx);
+			float w1 = (ax-cx)*(py-cy)-(ay-cy)*(px-cx);
+			float w2 = (bx-ax)*(py-ay)-(by-ay)*(px-ax);
+			float* depth = &m_depth[y*m_width+minX];
+			unsigned char* color = &colors[(y*m_width+minX)*4];
+			for (int x=minX;x<=maxX;x++)
+			{
+				if (w0 >= 0.f && w1 >= 0.f && w2 >= 0.f)
+				{
+					const float z = (w0*az+w1*bz+w2*cz)*invArea;
+					if (z < *depth && z >= 0.f)
+					{
+						*depth = z;
+						memcpy(color,tri.m_color,4);
+					}
+				}
+				w0 += stepX0;
+				w1 += stepX1;
+				w2 += stepX2;
+				depth++;
+				color += 4;
+			}
+		}
+	}
+}
+
+bool	SoftwareRasterizer::writeImage(const char* fileName) const
+{
+	const size_t length = strlen(fileName);
+	if (length >= 4 && (!strcmp(fileName+length-4,".png") || !strcmp(fileName+length-4,".PNG")))
+		return m_texture->writePNG(fileName);
+	return m_texture->writePPM(fileName);
+}
@@ -0,0 +1,147 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef SOFTWARE_RASTERIZER_H
+#define SOFTWARE_RASTERIZER_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btHashMap.h"
+#include "LinearMath/btTransform.h"
+
+class btCollisionShape;
+class btCollisionWorld;
+class renderTexture;
+class TaskPool;
+
+///SoftwareRasterizer draws the collision shapes of a world into a renderTexture without OpenGL, for servers
+///and continuous integration machines that have no display.
+///Every shape is turned into a triangle mesh once: exact boxes, btShapeHull for the other convex shapes, all
+///triangles of concave shapes and a large quad for static planes. Each frame the triangles are transformed,
+///clipped against the near plane, flat shaded and binned into 64x64 pixel tiles on the calling thread. Then the
+///tiles are rasterized with a depth buffer on a TaskPool. A tile draws its triangles in submission order and
+///no two threads touch the same pixel, so the image does not depend on the number of threads.
+class SoftwareRasterizer
+{
+public:
+
+	enum
+	{
+		TILE_SIZE = 64
+	};
+
+	struct RasterMesh
+	{
+		btAlignedObjectArray<btVector3>	m_vertices;
+		btAlignedObjectArray<int>		m_indices;
+		///triangles face outwards and the back faces are skipped, concave meshes are drawn from both sides
+		bool	m_closed;
+	};
+
+	///screen position and depth ([0,1]) of the corners, and the shaded color as RGBA8
+	struct ScreenTriangle
+	{
+		float			m_x[3];
+		float			m_y[3];
+		float			m_z[3];
+		unsigned char	m_color[4];
+	};
+
+private:
+
+	int		m_width;
+	int		m_height;
+	int		m_numTilesX;
+	int		m_numTilesY;
+	renderTexture*	m_texture;
+	btAlignedObjectArray<float>	m_depth;
+	TaskPool*	m_taskPool;
+
+	btHashMap<btHashPtr,RasterMesh*>	m_meshes;
+
+	btTransform	m_view;
+	btScalar	m_tanHalfFovY;
+	btScalar	m_zNear;
+	btScalar	m_zFar;
+	btVector3	m_lightDirection;
+	btVector4	m_clearColor;
+
+	btAlignedObjectArray<ScreenTriangle>	m_triangles;
+	///triangle indices per tile, in submission order
+	btAlignedObjectArray<btAlignedObjectArray<int> >	m_tileBins;
+
+	double	m_setupTime;
+	double	m_rasterTime;
+
+	const RasterMesh*	getMesh(const btCollisionShape* shape);
+	RasterMesh*	buildMesh(const btCollisionShape* shape) const;
+	void	submitShape(const btCollisionShape* shape,const btTransform& worldTransform,const btVector3& color);
+	void	submitTriangle(const btVector3* viewVertices,const btVector3& color,btScalar intensity);
+	void	emitTriangle(const btVector3& a,const btVector3& b,const btVector3& c,const unsigned char* color);
+	bool	isSphereVisible(const btVector3& viewCenter,btScalar radius) const;
+
+public:
+
+	///numThreads 0 uses one thread per processor
+	SoftwareRasterizer(int width,int height,int numThreads=0);
+	~SoftwareRasterizer();
+
+	///perspective camera, fovY in degrees. The demos use a 90 degree frustum with the near plane at 1.
+	void	setCamera(const btVector3& eye,const btVector3& target,const btVector3& up,btScalar fovY=btScalar(90.),btScalar zNear=btScalar(1.),btScalar zFar=btScalar(10000.));
+	///direction the light travels in, like DemoApplication::m_sundirection
+	void	setLightDirection(const btVector3& direction);
+	void	setClearColor(const btVector4& rgba);
+
+	///draw every collision object of the world, colored like DemoApplication::renderscene
+	void	renderWorld(const btCollisionWorld* world);
+
+	///the cached mesh of the shape is built again the next time it is drawn
+	void	invalidateShape(const btCollisionShape* shape);
+	void	clearMeshCache();
+
+	renderTexture*	getRenderTexture()
+	{
+		return m_texture;
+	}
+	///depth per pixel in [0,1], rows top to bottom like the texture
+	const float*	getDepthBuffer() const
+	{
+		return &m_depth[0];
+	}
+	int		getNumThreads() const;
+	int		getNumTriangles() const
+	{
+		return m_triangles.size();
+	}
+	int		getNumCachedMeshes() const
+	{
+		return m_meshes.size();
+	}
+	///milliseconds of the last renderWorld spent transforming and binning, and rasterizing the tiles
+	double	getSetupTime() const
+	{
+		return m_setupTime;
+	}
+	double	getRasterTime() const
+	{
+		return m_rasterTime;
+	}
+
+	///PNG when the name ends with .png, PPM otherwise
+	bool	writeImage(const char* fileName) const;
+
+	///rasterize one tile, called by the task pool
+	void	rasterizeTile(int tileIndex);
+};
+
+#endif //SOFTWARE_RASTERIZER_H
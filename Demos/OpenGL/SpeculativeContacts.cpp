@@ -0,0 +1,145 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "SpeculativeContacts.h"
+#include "BulletDynamics/Dynamics/btDiscreteDynamicsWorld.h"
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+#include "BulletCollision/BroadphaseCollision/btBroadphaseInterface.h"
+#include "BulletCollision/BroadphaseCollision/btDispatcher.h"
+#include "BulletCollision/CollisionShapes/btConvexShape.h"
+#include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkPairDetector.h"
+#include "BulletCollision/NarrowPhaseCollision/btPointCollector.h"
+#include "BulletCollision/NarrowPhaseCollision/btVoronoiSimplexSolver.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h"
+#include "LinearMath/btHashMap.h"
+#include "LinearMath/btQuickprof.h"
+
+///collects the objects whose proxies overlap the swept AABB of a fast body
+struct SpeculativeCandidateCallback : public btBroadphaseAabbCallback
+{
+	btAlignedObjectArray<btCollisionObject*>	m_candidates;
+
+	virtual bool	process(const btBroadphaseProxy* proxy)
+	{
+		m_candidates.push_back((btCollisionObject*)proxy->m_clientObject);
+		return true;
+	}
+};
+
+SpeculativeContacts::SpeculativeContacts()
+:m_motionThreshold(btScalar(0.5)),
+m_numContacts(0)
+{
+}
+
+void	SpeculativeContacts::createContacts(btDiscreteDynamicsWorld* world,btScalar timeStep,btAlignedObjectArray<btPersistentManifold*>& manifolds)
+{
+	BT_PROFILE("createSpeculativeContacts");
+
+	m_numContacts = 0;
+
+	btDispatcher* dispatcher = world->getDispatcher();
+	btScalar motionThreshold2 = m_motionThreshold*m_motionThreshold;
+
+	///gather the fast bodies first, so a pair of two fast bodies is only handled once
+	btHashMap<btHashPtr,int>	fastBodyIndex;
+	m_fastBodies.resize(0);
+	for (int i=0;i<world->getNumCollisionObjects();i++)
+	{
+		btRigidBody* body = btRigidBody::upcast(world->getCollisionObjectArray()[i]);
+		if (!body || body->isStaticOrKinematicObject() || !body->isActive() || !body->getCollisionShape()->isConvex())
+			continue;
+		btVector3 motion = (body->getLinearVelocity()+body->getGravity()*timeStep)*timeStep;
+		if (motion.length2() < motionThreshold2)
+			continue;
+		fastBodyIndex.insert(btHashPtr(body),m_fastBodies.size());
+		m_fastBodies.push_back(body);
+	}
+
+	btVoronoiSimplexSolver			simplexSolver;
+	btGjkEpaPenetrationDepthSolver	penetrationSolver;
+	SpeculativeCandidateCallback	candidates;
+
+	for (int i=0;i<m_fastBodies.size();i++)
+	{
+		btRigidBody* body = m_fastBodies[i];
+		btVector3 velocity = body->getLinearVelocity()+body->getGravity()*timeStep;
+		btVector3 motion = velocity*timeStep;
+
+		///expand the AABB by the motion of this step
+		btVector3 aabbMin,aabbMax;
+		body->getCollisionShape()->getAabb(body->getWorldTransform(),aabbMin,aabbMax);
+		for (int axis=0;axis<3;axis++)
+		{
+			if (motion[axis] < 0.f)
+				aabbMin[axis] += motion[axis];
+			else
+				aabbMax[axis] += motion[axis];
+		}
+
+		candidates.m_candidates.resize(0);
+		world->getBroadphase()->aabbTest(aabbMin,aabbMax,candidates);
+
+		for (int j=0;j<candidates.m_candidates.size();j++)
+		{
+			btCollisionObject* other = candidates.m_candidates[j];
+			if (other == body || !other->getCollisionShape()->isConvex())
+				continue;
+			if (!dispatcher->needsCollision(body,other) || !dispatcher->needsResponse(body,other))
+				continue;
+			int* otherIndex = fastBodyIndex.find(btHashPtr(other));
+			if (otherIndex && *otherIndex < i)
+				continue;
+
+			btRigidBody* otherBody = btRigidBody::upcast(other);
+			btVector3 otherVelocity(0,0,0);
+			if (otherBody && !otherBody->isStaticOrKinematicObject())
+				otherVelocity = otherBody->getLinearVelocity()+otherBody->getGravity()*timeStep;
+			btVector3 relativeMotion = (velocity-otherVelocity)*timeStep;
+			btScalar maxDistance = relativeMotion.length();
+
+			btGjkPairDetector gjk((const btConvexShape*)body->getCollisionShape(),(const btConvexShape*)other->getCollisionShape(),&simplexSolver,&penetrationSolver);
+			btGjkPairDetector::ClosestPointInput input;
+			input.m_transformA = body->getWorldTransform();
+			input.m_transformB = other->getWorldTransform();
+			input.m_maximumDistanceSquared = maxDistance*maxDistance;
+			btPointCollector closest;
+			gjk.getClosestPoints(input,closest,0);
+
+			///touching or penetrating pairs are left to the discrete collision detection
+			if (!closest.m_hasResult || closest.m_distance <= btScalar(0.) || closest.m_distance > maxDistance)
+				continue;
+
+			///only pairs that approach each other can close the gap
+			const btVector3& normalOnB = closest.m_normalOnBInWorld;
+			if (relativeMotion.dot(normalOnB) >= btScalar(0.))
+				continue;
+
+			btVector3 pointOnB = closest.m_pointInWorld;
+			btVector3 pointOnA = pointOnB + normalOnB*closest.m_distance;
+			btManifoldPoint point(body->getWorldTransform().invXform(pointOnA),other->getWorldTransform().invXform(pointOnB),normalOnB,closest.m_distance);
+			point.m_positionWorldOnA = pointOnA;
+			point.m_positionWorldOnB = pointOnB;
+			point.m_combinedFriction = btMin(body->getFriction()*other->getFriction(),btScalar(10.));
+			point.m_combinedRestitution = body->getRestitution()*other->getRestitution();
+
+			btPersistentManifold* manifold = dispatcher->getNewManifold(body,other);
+			manifold->addManifoldPoint(point,true);
+			manifolds.push_back(manifold);
+			m_numContacts++;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef SPECULATIVE_CONTACTS_H
+#define SPECULATIVE_CONTACTS_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btScalar.h"
+
+class btDiscreteDynamicsWorld;
+class btPersistentManifold;
+class btRigidBody;
+
+///SpeculativeContacts is a cheaper alternative to swept sphere CCD for fast convex bodies.
+///Before each internal step, the AABB of every fast body is expanded by its motion for that step and
+///queried against the broadphase. For each convex pair that is separated now but can close the gap
+///within the step, a contact with positive distance is added. The sequential impulse solver only removes
+///the part of the approaching velocity that would make the pair penetrate, so no separate sweep pass or
+///motion clamping is needed.
+///DemoDynamicsWorld calls it inside each internal step and hands the manifolds to the predictive contact path
+///of btDiscreteDynamicsWorld, which merges the islands of their bodies. They are released after the step.
+class SpeculativeContacts
+{
+	btAlignedObjectArray<btRigidBody*>	m_fastBodies;
+	btScalar	m_motionThreshold;
+	int			m_numContacts;
+
+public:
+
+	SpeculativeContacts();
+
+	///bodies moving less than this distance in one internal step are left to the discrete collision detection
+	void	setMotionThreshold(btScalar threshold)
+	{
+		m_motionThreshold = threshold;
+	}
+	btScalar	getMotionThreshold() const
+	{
+		return m_motionThreshold;
+	}
+
+	///number of speculative contacts added in the last internal step
+	int		getNumContacts() const
+	{
+		return m_numContacts;
+	}
+
+	///createContacts appends a manifold from the dispatcher of world, with one contact, to manifolds for every
+	///pair that can close its gap within timeStep. The caller releases the manifolds after the step.
+	void	createContacts(btDiscreteDynamicsWorld* world,btScalar timeStep,btAlignedObjectArray<btPersistentManifold*>& manifolds);
+};
+
+#endif //SPECULATIVE_CONTACTS_H
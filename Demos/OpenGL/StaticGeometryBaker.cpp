@@ -0,0 +1,358 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "StaticGeometryBaker.h"
+#include "BulletDynamics/Dynamics/btDynamicsWorld.h"
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+#include "BulletCollision/BroadphaseCollision/btBroadphaseProxy.h"
+#include "BulletCollision/CollisionShapes/btBoxShape.h"
+#include "BulletCollision/CollisionShapes/btCompoundShape.h"
+#include "BulletCollision/CollisionShapes/btConcaveShape.h"
+#include "BulletCollision/CollisionShapes/btShapeHull.h"
+#include "BulletCollision/CollisionShapes/btTriangleCallback.h"
+#include "BulletCollision/CollisionShapes/btTriangleMesh.h"
+#include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
+#include "BulletCollision/CollisionShapes/btOptimizedBvh.h"
+#include "LinearMath/btMotionState.h"
+#include "LinearMath/btQuickprof.h"
+
+#include <stdio.h>
+#include <string.h>
+
+///header of the cache file, followed by the in-place serialized btOptimizedBvh
+struct StaticGeometryBakeHeader
+{
+	char			m_magic[8];
+	int				m_version;
+	///1 as written by this machine, anything else means the file has a different endianness
+	int				m_endianCheck;
+	int				m_sizeofScalar;
+	unsigned int	m_meshHash;
+	int				m_numTriangles;
+	int				m_bvhSize;
+};
+
+static const char*	sBakeMagic = "BTBAKEBV";
+static const int	sBakeVersion = 1;
+
+struct BakeTriangleCallback : public btTriangleCallback
+{
+	StaticGeometryBaker*	m_baker;
+	btTransform				m_transform;
+
+	BakeTriangleCallback(StaticGeometryBaker* baker,const btTransform& transform)
+		:m_baker(baker),
+		m_transform(transform)
+	{
+	}
+
+	virtual void processTriangle(btVector3* triangle,int partId, int triangleIndex)
+	{
+		(void)partId;
+		(void)triangleIndex;
+		m_baker->addTriangle(m_transform*triangle[0],m_transform*triangle[1],m_transform*triangle[2]);
+	}
+};
+
+StaticGeometryBaker::StaticGeometryBaker()
+:m_mesh(0),
+m_shape(0),
+m_body(0),
+m_bvhBuffer(0),
+m_numBakedObjects(0),
+m_numTriangles(0),
+m_loadedFromCache(false),
+m_bakeTime(0.),
+m_meshHash(2166136261u)
+{
+	m_cacheFileName[0] = 0;
+}
+
+StaticGeometryBaker::~StaticGeometryBaker()
+{
+	clear();
+}
+
+void	StaticGeometryBaker::setCacheFileName(const char* fileName)
+{
+	strncpy(m_cacheFileName,fileName ? fileName : "",sizeof(m_cacheFileName)-1);
+	m_cacheFileName[sizeof(m_cacheFileName)-1] = 0;
+}
+
+void	StaticGeometryBaker::clear()
+{
+	///a BVH loaded in place is not owned by the shape
+	delete m_shape;
+	m_shape = 0;
+	if (m_bvhBuffer)
+	{
+		btAlignedFree(m_bvhBuffer);
+		m_bvhBuffer = 0;
+	}
+	delete m_mesh;
+	m_mesh = 0;
+	m_body = 0;
+	m_numBakedObjects = 0;
+	m_numTriangles = 0;
+	m_loadedFromCache = false;
+	m_meshHash = 2166136261u;
+}
+
+void	StaticGeometryBaker::addTriangle(const btVector3& vertex0,const btVector3& vertex1,const btVector3& vertex2)
+{
+	m_mesh->addTriangle(vertex0,vertex1,vertex2,false);
+	m_numTriangles++;
+
+	const btVector3* vertices[3] = {&vertex0,&vertex1,&vertex2};
+	for (int v=0;v<3;v++)
+	{
+		for (int axis=0;axis<3;axis++)
+		{
+			///hash the single precision value, that is what btTriangleMesh stores with 3 component vertices
+			float value = float((*vertices[v])[axis]);
+			const unsigned char* bytes = (const unsigned char*)&value;
+			for (unsigned int b=0;b<sizeof(float);b++)
+			{
+				m_meshHash ^= bytes[b];
+				m_meshHash *= 16777619u;
+			}
+		}
+	}
+}
+
+void	StaticGeometryBaker::addShapeTriangles(const btCollisionShape* shape,const btTransform& transform)
+{
+	if (shape->getShapeType() == BOX_SHAPE_PROXYTYPE)
+	{
+		btVector3 halfExtents = ((const btBoxShape*)shape)->getHalfExtentsWithMargin();
+		for (int axis=0;axis<3;axis++)
+		{
+			int b = (axis+1)%3;
+			int c = (axis+2)%3;
+			for (int side=-1;side<=1;side+=2)
+			{
+				///corners in counter clockwise order around +axis, reversed for the -axis face
+				btVector3 quad[4];
+				static const int signs[4][2] = {{-1,-1},{1,-1},{1,1},{-1,1}};
+				for (int i=0;i<4;i++)
+				{
+					btVector3 corner;
+					corner[axis] = halfExtents[axis]*btScalar(side);
+					corner[b] = halfExtents[b]*btScalar(signs[i][0]);
+					corner[c] = halfExtents[c]*btScalar(signs[i][1]);
+					quad[side > 0 ? i : 3-i] = transform*corner;
+				}
+				addTriangle(quad[0],quad[1],quad[2]);
+				addTriangle(quad[0],quad[2],quad[3]);
+			}
+		}
+		return;
+	}
+
+	if (shape->isCompound())
+	{
+		const btCompoundShape* compound = (const btCompoundShape*)shape;
+		for (int i=0;i<compound->getNumChildShapes();i++)
+		{
+			addShapeTriangles(compound->getChildShape(i),transform*compound->getChildTransform(i));
+		}
+		return;
+	}
+
+	if (shape->isConvex())
+	{
+		btShapeHull hull((const btConvexShape*)shape);
+		hull.buildHull(shape->getMargin());
+		const unsigned int* indices = hull.getIndexPointer();
+		const btVector3* vertices = hull.getVertexPointer();
+		for (int i=0;i<hull.numTriangles();i++)
+		{
+			addTriangle(transform*vertices[indices[i*3]],transform*vertices[indices[i*3+1]],transform*vertices[indices[i*3+2]]);
+		}
+		return;
+	}
+
+	if (shape->isConcave())
+	{
+		BakeTriangleCallback callback(this,transform);
+		btVector3 aabbMax(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+		((const btConcaveShape*)shape)->processAllTriangles(&callback,-aabbMax,aabbMax);
+	}
+}
+
+///only plain static rigid bodies are merged: triggers, ghost objects, bodies with contact callbacks or with
+///their own collision filter would change behaviour as part of the shared mesh
+static bool	isBakeable(const btCollisionObject* colObj)
+{
+	const btRigidBody* body = btRigidBody::upcast(colObj);
+	if (!body || !body->isStaticObject() || body->isKinematicObject())
+		return false;
+	if (body->getCollisionFlags() & (btCollisionObject::CF_NO_CONTACT_RESPONSE|btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK))
+		return false;
+	if (body->getCollisionShape()->isInfinite())
+		return false;
+	///constraints keep a pointer to the body
+	if (body->getNumConstraintRefs())
+		return false;
+	///the filter that btDiscreteDynamicsWorld::addRigidBody gives static bodies
+	const btBroadphaseProxy* proxy = body->getBroadphaseHandle();
+	if (!proxy || proxy->m_collisionFilterGroup != short(btBroadphaseProxy::StaticFilter)
+		|| proxy->m_collisionFilterMask != short(btBroadphaseProxy::AllFilter ^ btBroadphaseProxy::StaticFilter))
+		return false;
+	return true;
+}
+
+///the baked body has a single material, objects with another one keep their own body
+static bool	hasSameMaterial(const btCollisionObject* a,const btCollisionObject* b)
+{
+	return a->getFriction() == b->getFriction() && a->getRestitution() == b->getRestitution();
+}
+
+btRigidBody*	StaticGeometryBaker::bake(btDynamicsWorld* world)
+{
+	BT_PROFILE("bakeStaticGeometry");
+	btClock clock;
+
+	clear();
+
+	btAlignedObjectArray<btCollisionObject*> bakedObjects;
+	for (int i=0;i<world->getNumCollisionObjects();i++)
+	{
+		btCollisionObject* colObj = world->getCollisionObjectArray()[i];
+		if (isBakeable(colObj) && (!bakedObjects.size() || hasSameMaterial(colObj,bakedObjects[0])))
+			bakedObjects.push_back(colObj);
+	}
+	if (!bakedObjects.size())
+		return 0;
+
+	m_mesh = new btTriangleMesh(true,false);
+	for (int i=0;i<bakedObjects.size();i++)
+	{
+		addShapeTriangles(bakedObjects[i]->getCollisionShape(),bakedObjects[i]->getWorldTransform());
+	}
+	if (!m_numTriangles)
+	{
+		clear();
+		return 0;
+	}
+
+	m_loadedFromCache = loadBvh();
+	if (!m_loadedFromCache)
+	{
+		m_shape = new btBvhTriangleMeshShape(m_mesh,true,true);
+		saveBvh();
+	}
+
+	///all baked objects share the material of the first one
+	btRigidBody::btRigidBodyConstructionInfo rbInfo(btScalar(0.),0,m_shape);
+	rbInfo.m_friction = bakedObjects[0]->getFriction();
+	rbInfo.m_restitution = bakedObjects[0]->getRestitution();
+	m_body = new btRigidBody(rbInfo);
+
+	for (int i=0;i<bakedObjects.size();i++)
+	{
+		btCollisionObject* colObj = bakedObjects[i];
+		btRigidBody* body = btRigidBody::upcast(colObj);
+		if (body && body->getMotionState())
+			delete body->getMotionState();
+		world->removeCollisionObject(colObj);
+		delete colObj;
+	}
+	m_numBakedObjects = bakedObjects.size();
+
+	world->addRigidBody(m_body);
+
+	m_bakeTime = clock.getTimeMicroseconds()*0.001;
+	return m_body;
+}
+
+bool	StaticGeometryBaker::loadBvh()
+{
+	if (!m_cacheFileName[0])
+		return false;
+
+	FILE* file = fopen(m_cacheFileName,"rb");
+	if (!file)
+		return false;
+
+	StaticGeometryBakeHeader header;
+	bool valid = fread(&header,sizeof(header),1,file) == 1
+		&& !memcmp(header.m_magic,sBakeMagic,sizeof(header.m_magic))
+		&& header.m_version == sBakeVersion
+		&& header.m_endianCheck == 1
+		&& header.m_sizeofScalar == int(sizeof(btScalar))
+		&& header.m_meshHash == m_meshHash
+		&& header.m_numTriangles == m_numTriangles
+		&& header.m_bvhSize > 0;
+
+	if (valid)
+	{
+		///deSerializeInPlace requires 16 byte alignment
+		m_bvhBuffer = btAlignedAlloc(header.m_bvhSize,16);
+		valid = fread(m_bvhBuffer,header.m_bvhSize,1,file) == 1;
+	}
+	fclose(file);
+
+	btOptimizedBvh* bvh = valid ? btOptimizedBvh::deSerializeInPlace(m_bvhBuffer,header.m_bvhSize,false) : 0;
+	if (!bvh)
+	{
+		if (m_bvhBuffer)
+		{
+			btAlignedFree(m_bvhBuffer);
+			m_bvhBuffer = 0;
+		}
+		return false;
+	}
+
+	m_shape = new btBvhTriangleMeshShape(m_mesh,true,false);
+	m_shape->setOptimizedBvh(bvh);
+	return true;
+}
+
+void	StaticGeometryBaker::saveBvh()
+{
+	if (!m_cacheFileName[0])
+		return;
+
+	btOptimizedBvh* bvh = m_shape->getOptimizedBvh();
+	int bvhSize = bvh->calculateSerializeBufferSize();
+	void* buffer = btAlignedAlloc(bvhSize,16);
+	bvh->serializeInPlace(buffer,bvhSize,false);
+
+	StaticGeometryBakeHeader header;
+	memset(&header,0,sizeof(header));
+	memcpy(header.m_magic,sBakeMagic,sizeof(header.m_magic));
+	header.m_version = sBakeVersion;
+	header.m_endianCheck = 1;
+	header.m_sizeofScalar = int(sizeof(btScalar));
+	header.m_meshHash = m_meshHash;
+	header.m_numTriangles = m_numTriangles;
+	header.m_bvhSize = bvhSize;
+
+	FILE* file = fopen(m_cacheFileName,"wb");
+	bool written = false;
+	if (file)
+	{
+		written = fwrite(&header,sizeof(header),1,file)==1;
+		written = written && fwrite(buffer,bvhSize,1,file)==1;
+		written = (fclose(file)==0) && written;
+		///a truncated cache would be loaded by the next run, a missing one is just built again
+		if (!written)
+			remove(m_cacheFileName);
+	}
+	if (!written)
+		printf("StaticGeometryBaker: cannot write %s\n",m_cacheFileName);
+	btAlignedFree(buffer);
+}
@@ -0,0 +1,106 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef STATIC_GEOMETRY_BAKER_H
+#define STATIC_GEOMETRY_BAKER_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btTransform.h"
+
+class btDynamicsWorld;
+class btCollisionObject;
+class btCollisionShape;
+class btTriangleMesh;
+class btBvhTriangleMeshShape;
+class btRigidBody;
+
+///StaticGeometryBaker merges the static rigid bodies of a world into a single btBvhTriangleMeshShape with a quantized BVH.
+///Only bodies with contact response, the default static collision filter and the friction and restitution of the
+///first of them are merged; triggers, ghost objects and bodies with another filter or material keep their own.
+///Boxes are triangulated exactly, other convex shapes through btShapeHull and concave shapes through processAllTriangles.
+///Infinite shapes such as btStaticPlaneShape are left alone.
+///The baked BVH is written to a cache file with btOptimizedBvh::serializeInPlace. The next run loads it in place
+///instead of building the tree again, as long as the triangles hash to the same value as stored in the file.
+///The merged static objects are removed from the world and deleted together with their motion states, their
+///collision shapes are not touched. The baked body is added to the world and deleted by the world owner like
+///any other body; the mesh, shape and BVH stay owned by the baker, so call clear() after the bodies are deleted.
+class StaticGeometryBaker
+{
+	btTriangleMesh*				m_mesh;
+	btBvhTriangleMeshShape*		m_shape;
+	btRigidBody*				m_body;
+	///buffer of a BVH that was loaded in place from the cache file
+	void*						m_bvhBuffer;
+
+	char	m_cacheFileName[1024];
+
+	int		m_numBakedObjects;
+	int		m_numTriangles;
+	bool	m_loadedFromCache;
+	double	m_bakeTime;
+
+	///FNV-1a hash of the baked triangles, identifies the matching cache file
+	unsigned int	m_meshHash;
+
+	void	addShapeTriangles(const btCollisionShape* shape,const btTransform& transform);
+	bool	loadBvh();
+	void	saveBvh();
+
+public:
+
+	///adds a triangle in world space to the mesh that is being baked
+	void	addTriangle(const btVector3& vertex0,const btVector3& vertex1,const btVector3& vertex2);
+
+	StaticGeometryBaker();
+	virtual ~StaticGeometryBaker();
+
+	///empty name disables the cache file, the BVH is then built every time
+	void	setCacheFileName(const char* fileName);
+	const char*	getCacheFileName() const
+	{
+		return m_cacheFileName;
+	}
+
+	///returns the baked body, or 0 if there was no static geometry to bake
+	btRigidBody*	bake(btDynamicsWorld* world);
+
+	///delete the baked shape and mesh, after the baked body was removed from the world
+	void	clear();
+
+	///the baked mesh shape, drawers that cache render data per shape must forget it before clear()
+	btBvhTriangleMeshShape*	getShape()
+	{
+		return m_shape;
+	}
+
+	int		getNumBakedObjects() const
+	{
+		return m_numBakedObjects;
+	}
+	int		getNumTriangles() const
+	{
+		return m_numTriangles;
+	}
+	bool	isLoadedFromCache() const
+	{
+		return m_loadedFromCache;
+	}
+	///time spent in the last bake, in milliseconds
+	double	getBakeTime() const
+	{
+		return m_bakeTime;
+	}
+};
+
+#endif //STATIC_GEOMETRY_BAKER_H
@@ -0,0 +1,400 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "StreamDebugDrawer.h"
+
+#include <string.h>
+
+///"BTDD" at the start of the file, followed by the version
+static const char			sStreamMagic[4] = {'B','T','D','D'};
+static const unsigned int	sStreamVersion = 1;
+///"FRME" in the byte order of the writer, also tells a reader with the other byte order apart
+static const unsigned int	sFrameMagic = 0x454d5246;
+
+static unsigned int	packColor(const btVector3& color,btScalar alpha)
+{
+	unsigned int packed = 0;
+	const btScalar channels[4] = {color.getX(),color.getY(),color.getZ(),alpha};
+	for (int i=0;i<4;i++)
+	{
+		const btScalar c = btMax(btScalar(0.),btMin(btScalar(1.),channels[i]));
+		packed |= ((unsigned int)(c*btScalar(255.)+btScalar(0.5)))<<(i*8);
+	}
+	return packed;
+}
+
+static btVector3	unpackColor(unsigned int color)
+{
+	return btVector3(btScalar(color&0xff),btScalar((color>>8)&0xff),btScalar((color>>16)&0xff))/btScalar(255.);
+}
+
+static btScalar	unpackAlpha(unsigned int color)
+{
+	return btScalar(color>>24)/btScalar(255.);
+}
+
+static void	storeVector(float* dest,const btVector3& v)
+{
+	dest[0] = float(v.getX());
+	dest[1] = float(v.getY());
+	dest[2] = float(v.getZ());
+}
+
+static btVector3	loadVector(const float* src)
+{
+	return btVector3(src[0],src[1],src[2]);
+}
+
+static bool	writeStreamHeader(FILE* file)
+{
+	return fwrite(sStreamMagic,sizeof(sStreamMagic),1,file)==1 && fwrite(&sStreamVersion,sizeof(sStreamVersion),1,file)==1;
+}
+
+///append the raw bytes of an array to a byte buffer
+template <typename T>
+static void	appendArray(btAlignedObjectArray<unsigned char>& buffer,const btAlignedObjectArray<T>& array)
+{
+	if (!array.size())
+		return;
+	const int offset = buffer.size();
+	buffer.resize(offset+array.size()*int(sizeof(T)));
+	memcpy(&buffer[offset],&array[0],array.size()*sizeof(T));
+}
+
+template <typename T>
+static bool	writeArray(FILE* file,const btAlignedObjectArray<T>& array)
+{
+	return !array.size() || fwrite(&array[0],sizeof(T),array.size(),file)==size_t(array.size());
+}
+
+template <typename T>
+static bool	readArray(FILE* file,btAlignedObjectArray<T>& array,unsigned int count)
+{
+	array.resize(int(count));
+	return !count || fread(&array[0],sizeof(T),count,file)==count;
+}
+
+void	DebugDrawStreamFrame::clear()
+{
+	memset(&m_header,0,sizeof(m_header));
+	//resize keeps the capacity, the arrays stop growing after the first frames
+	m_lines.resize(0);
+	m_triangles.resize(0);
+	m_contacts.resize(0);
+	m_spheres.resize(0);
+}
+
+size_t	DebugDrawStreamFrame::getStreamSize() const
+{
+	return sizeof(DebugDrawStreamFrameHeader)+
+		m_lines.size()*sizeof(DebugDrawStreamLine)+
+		m_triangles.size()*sizeof(DebugDrawStreamTriangle)+
+		m_contacts.size()*sizeof(DebugDrawStreamContact)+
+		m_spheres.size()*sizeof(DebugDrawStreamSphere);
+}
+
+void	DebugDrawStreamFrame::draw(btIDebugDraw* drawer) const
+{
+	for (int i=0;i<m_triangles.size();i++)
+	{
+		const DebugDrawStreamTriangle& t = m_triangles[i];
+		drawer->drawTriangle(loadVector(&t.m_vertices[0]),loadVector(&t.m_vertices[3]),loadVector(&t.m_vertices[6]),unpackColor(t.m_color),unpackAlpha(t.m_color));
+	}
+	for (int i=0;i<m_lines.size();i++)
+	{
+		const DebugDrawStreamLine& l = m_lines[i];
+		drawer->drawLine(loadVector(l.m_from),loadVector(l.m_to),unpackColor(l.m_fromColor),unpackColor(l.m_toColor));
+	}
+	for (int i=0;i<m_contacts.size();i++)
+	{
+		const DebugDrawStreamContact& c = m_contacts[i];
+		drawer->drawContactPoint(loadVector(c.m_point),loadVector(c.m_normal),c.m_distance,c.m_lifeTime,unpackColor(c.m_color));
+	}
+	for (int i=0;i<m_spheres.size();i++)
+	{
+		const DebugDrawStreamSphere& s = m_spheres[i];
+		drawer->drawSphere(loadVector(s.m_center),s.m_radius,unpackColor(s.m_color));
+	}
+}
+
+bool	DebugDrawStreamFrame::getBounds(btVector3& aabbMin,btVector3& aabbMax) const
+{
+	aabbMin.setValue(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+	aabbMax = -aabbMin;
+	for (int i=0;i<m_lines.size();i++)
+	{
+		aabbMin.setMin(loadVector(m_lines[i].m_from));aabbMax.setMax(loadVector(m_lines[i].m_from));
+		aabbMin.setMin(loadVector(m_lines[i].m_to));aabbMax.setMax(loadVector(m_lines[i].m_to));
+	}
+	for (int i=0;i<m_triangles.size();i++)
+	{
+		for (int v=0;v<3;v++)
+		{
+			aabbMin.setMin(loadVector(&m_triangles[i].m_vertices[v*3]));
+			aabbMax.setMax(loadVector(&m_triangles[i].m_vertices[v*3]));
+		}
+	}
+	for (int i=0;i<m_contacts.size();i++)
+	{
+		aabbMin.setMin(loadVector(m_contacts[i].m_point));aabbMax.setMax(loadVector(m_contacts[i].m_point));
+	}
+	for (int i=0;i<m_spheres.size();i++)
+	{
+		const btVector3 radius(m_spheres[i].m_radius,m_spheres[i].m_radius,m_spheres[i].m_radius);
+		aabbMin.setMin(loadVector(m_spheres[i].m_center)-radius);aabbMax.setMax(loadVector(m_spheres[i].m_center)+radius);
+	}
+	return aabbMin.getX()<=aabbMax.getX();
+}
+
+StreamDebugDrawer::StreamDebugDrawer()
+:m_debugMode(0),
+m_file(0),
+m_frameIndex(0),
+m_bytesWritten(0),
+m_ringHead(0),
+m_ringCount(0)
+{
+}
+
+StreamDebugDrawer::~StreamDebugDrawer()
+{
+	closeFile();
+}
+
+bool	StreamDebugDrawer::openFile(const char* fileName)
+{
+	closeFile();
+	m_file = fopen(fileName,"wb");
+	if (!m_file)
+		return false;
+	if (!writeStreamHeader(m_file))
+	{
+		closeFile();
+		return false;
+	}
+	m_bytesWritten = sizeof(sStreamMagic)+sizeof(sStreamVersion);
+	return true;
+}
+
+void	StreamDebugDrawer::closeFile()
+{
+	if (m_file)
+	{
+		fclose(m_file);
+		m_file = 0;
+	}
+}
+
+void	StreamDebugDrawer::setRingBufferFrames(int numFrames)
+{
+	m_ring.clear();
+	m_ring.resize(btMax(numFrames,0));
+	m_ringHead = 0;
+	m_ringCount = 0;
+}
+
+bool	StreamDebugDrawer::saveRingBuffer(const char* fileName) const
+{
+	FILE* file = fopen(fileName,"wb");
+	if (!file)
+		return false;
+	bool ok = writeStreamHeader(file);
+	for (int i=0;i<m_ringCount && ok;i++)
+	{
+		const btAlignedObjectArray<unsigned char>& frame = m_ring[(m_ringHead+i)%m_ring.size()];
+		ok = fwrite(&frame[0],1,frame.size(),file)==size_t(frame.size());
+	}
+	fclose(file);
+	return ok;
+}
+
+void	StreamDebugDrawer::writeFrame(FILE* file,const DebugDrawStreamFrame& frame)
+{
+	const bool ok = fwrite(&frame.m_header,sizeof(frame.m_header),1,file)==1 &&
+		writeArray(file,frame.m_lines) &&
+		writeArray(file,frame.m_triangles) &&
+		writeArray(file,frame.m_contacts) &&
+		writeArray(file,frame.m_spheres);
+	if (!ok)
+	{
+		reportErrorWarning("StreamDebugDrawer: write failed, the stream file is closed");
+		closeFile();
+		return;
+	}
+	m_bytesWritten += frame.getStreamSize();
+}
+
+void	StreamDebugDrawer::endFrame()
+{
+	DebugDrawStreamFrameHeader& header = m_frame.m_header;
+	header.m_magic = sFrameMagic;
+	header.m_frameIndex = m_frameIndex++;
+	header.m_numLines = m_frame.m_lines.size();
+	header.m_numTriangles = m_frame.m_triangles.size();
+	header.m_numContacts = m_frame.m_contacts.size();
+	header.m_numSpheres = m_frame.m_spheres.size();
+
+	if (m_file)
+		writeFrame(m_file,m_frame);
+
+	if (m_ring.size())
+	{
+		int slot;
+		if (m_ringCount < m_ring.size())
+		{
+			slot = (m_ringHead+m_ringCount)%m_ring.size();
+			m_ringCount++;
+		} else
+		{
+			slot = m_ringHead;
+			m_ringHead = (m_ringHead+1)%m_ring.size();
+		}
+		btAlignedObjectArray<unsigned char>& buffer = m_ring[slot];
+		buffer.resize(sizeof(DebugDrawStreamFrameHeader));
+		memcpy(&buffer[0],&header,sizeof(header));
+		appendArray(buffer,m_frame.m_lines);
+		appendArray(buffer,m_frame.m_triangles);
+		appendArray(buffer,m_frame.m_contacts);
+		appendArray(buffer,m_frame.m_spheres);
+	}
+
+	m_frame.clear();
+}
+
+void	StreamDebugDrawer::drawLine(const btVector3& from,const btVector3& to,const btVector3& fromColor, const btVector3& toColor)
+{
+	DebugDrawStreamLine& line = m_frame.m_lines.expand();
+	storeVector(line.m_from,from);
+	storeVector(line.m_to,to);
+	line.m_fromColor = packColor(fromColor,btScalar(1.));
+	line.m_toColor = packColor(toColor,btScalar(1.));
+}
+
+void	StreamDebugDrawer::drawLine(const btVector3& from,const btVector3& to,const btVector3& color)
+{
+	DebugDrawStreamLine& line = m_frame.m_lines.expand();
+	storeVector(line.m_from,from);
+	storeVector(line.m_to,to);
+	line.m_fromColor = line.m_toColor = packColor(color,btScalar(1.));
+}
+
+void	StreamDebugDrawer::drawSphere(const btVector3& p, btScalar radius, const btVector3& color)
+{
+	DebugDrawStreamSphere& sphere = m_frame.m_spheres.expand();
+	storeVector(sphere.m_center,p);
+	sphere.m_radius = float(radius);
+	sphere.m_color = packColor(color,btScalar(1.));
+}
+
+void	StreamDebugDrawer::drawTriangle(const btVector3& a,const btVector3& b,const btVector3& c,const btVector3& color,btScalar alpha)
+{
+	DebugDrawStreamTriangle& triangle = m_frame.m_triangles.expand();
+	storeVector(&triangle.m_vertices[0],a);
+	storeVector(&triangle.m_vertices[3],b);
+	storeVector(&triangle.m_vertices[6],c);
+	triangle.m_color = packColor(color,alpha);
+}
+
+void	StreamDebugDrawer::drawContactPoint(const btVector3& pointOnB,const btVector3& normalOnB,btScalar distance,int lifeTime,const btVector3& color)
+{
+	DebugDrawStreamContact& contact = m_frame.m_contacts.expand();
+	storeVector(contact.m_point,pointOnB);
+	storeVector(contact.m_normal,normalOnB);
+	contact.m_distance = float(distance);
+	contact.m_lifeTime = lifeTime;
+	contact.m_color = packColor(color,btScalar(1.));
+}
+
+void	StreamDebugDrawer::reportErrorWarning(const char* warningString)
+{
+	printf("%s\n",warningString);
+}
+
+void	StreamDebugDrawer::draw3dText(const btVector3& location,const char* textString)
+{
+	(void)location;
+	(void)textString;
+}
+
+DebugDrawStreamReader::DebugDrawStreamReader()
+:m_file(0)
+{
+}
+
+DebugDrawStreamReader::~DebugDrawStreamReader()
+{
+	close();
+}
+
+bool	DebugDrawStreamReader::open(const char* fileName)
+{
+	close();
+	m_file = fopen(fileName,"rb");
+	if (!m_file)
+		return false;
+
+	char magic[4];
+	unsigned int version = 0;
+	if (fread(magic,sizeof(magic),1,m_file)!=1 || memcmp(magic,sStreamMagic,sizeof(magic))!=0 ||
+		fread(&version,sizeof(version),1,m_file)!=1 || version!=sStreamVersion)
+	{
+		close();
+		return false;
+	}
+
+	///skip from frame header to frame header, a truncated last frame is left out
+	DebugDrawStreamFrameHeader header;
+	long offset = ftell(m_file);
+	while (fread(&header,sizeof(header),1,m_file)==1 && header.m_magic==sFrameMagic)
+	{
+		const long size = long(header.m_numLines*sizeof(DebugDrawStreamLine)+
+			header.m_numTriangles*sizeof(DebugDrawStreamTriangle)+
+			header.m_numContacts*sizeof(DebugDrawStreamContact)+
+			header.m_numSpheres*sizeof(DebugDrawStreamSphere));
+		if (fseek(m_file,size,SEEK_CUR)!=0)
+			break;
+		const long next = ftell(m_file);
+		///fseek past the end succeeds, so check that the payload was really there
+		if (fseek(m_file,-1,SEEK_CUR)!=0 || fgetc(m_file)==EOF)
+			break;
+		m_frameOffsets.push_back(offset);
+		offset = next;
+	}
+	return true;
+}
+
+void	DebugDrawStreamReader::close()
+{
+	if (m_file)
+	{
+		fclose(m_file);
+		m_file = 0;
+	}
+	m_frameOffsets.clear();
+}
+
+bool	DebugDrawStreamReader::readFrame(int index,DebugDrawStreamFrame& frame)
+{
+	frame.clear();
+	if (!m_file || index<0 || index>=m_frameOffsets.size())
+		return false;
+	if (fseek(m_file,m_frameOffsets[index],SEEK_SET)!=0 || fread(&frame.m_header,sizeof(frame.m_header),1,m_file)!=1)
+		return false;
+	const DebugDrawStreamFrameHeader& header = frame.m_header;
+	return readArray(m_file,frame.m_lines,header.m_numLines) &&
+		readArray(m_file,frame.m_triangles,header.m_numTriangles) &&
+		readArray(m_file,frame.m_contacts,header.m_numContacts) &&
+		readArray(m_file,frame.m_spheres,header.m_numSpheres);
+}
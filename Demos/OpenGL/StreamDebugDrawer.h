@@ -0,0 +1,183 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef STREAM_DEBUG_DRAWER_H
+#define STREAM_DEBUG_DRAWER_H
+
+#include "LinearMath/btIDebugDraw.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+#include <stdio.h>
+
+///records of a debug draw stream. Positions are 32 bit floats, colors are RGBA8 with red in the lowest byte,
+///everything in the byte order of the machine that wrote the stream.
+struct DebugDrawStreamLine
+{
+	float			m_from[3];
+	float			m_to[3];
+	unsigned int	m_fromColor;
+	unsigned int	m_toColor;
+};
+
+struct DebugDrawStreamTriangle
+{
+	float			m_vertices[9];
+	unsigned int	m_color;
+};
+
+struct DebugDrawStreamContact
+{
+	float			m_point[3];
+	float			m_normal[3];
+	float			m_distance;
+	int				m_lifeTime;
+	unsigned int	m_color;
+};
+
+struct DebugDrawStreamSphere
+{
+	float			m_center[3];
+	float			m_radius;
+	unsigned int	m_color;
+};
+
+///every frame starts with this header, followed by the lines, triangles, contacts and spheres
+struct DebugDrawStreamFrameHeader
+{
+	unsigned int	m_magic;
+	unsigned int	m_frameIndex;
+	unsigned int	m_numLines;
+	unsigned int	m_numTriangles;
+	unsigned int	m_numContacts;
+	unsigned int	m_numSpheres;
+};
+
+///one frame of a debug draw stream
+struct DebugDrawStreamFrame
+{
+	DebugDrawStreamFrameHeader						m_header;
+	btAlignedObjectArray<DebugDrawStreamLine>		m_lines;
+	btAlignedObjectArray<DebugDrawStreamTriangle>	m_triangles;
+	btAlignedObjectArray<DebugDrawStreamContact>	m_contacts;
+	btAlignedObjectArray<DebugDrawStreamSphere>		m_spheres;
+
+	DebugDrawStreamFrame()
+	{
+		clear();
+	}
+
+	void	clear();
+	///bytes of the frame in the stream, header included
+	size_t	getStreamSize() const;
+	///replay the frame into another debug drawer, for example a GLDebugDrawer
+	void	draw(btIDebugDraw* drawer) const;
+	///returns false for an empty frame
+	bool	getBounds(btVector3& aabbMin,btVector3& aabbMax) const;
+};
+
+///StreamDebugDrawer records the debug geometry of btIDebugDraw into a compact binary stream, without OpenGL,
+///for simulations that run without a window. Lines, triangles, contact points and spheres are appended to the
+///arrays of the current frame, and endFrame writes the frame to the stream file, or keeps it in a ring buffer of
+///the last frames that saveRingBuffer writes out on demand. Both can be used at the same time.
+class StreamDebugDrawer : public btIDebugDraw
+{
+	int		m_debugMode;
+	FILE*	m_file;
+	DebugDrawStreamFrame	m_frame;
+	unsigned int	m_frameIndex;
+	size_t	m_bytesWritten;
+
+	///serialized frames, m_ringHead is the oldest once the ring is full
+	btAlignedObjectArray< btAlignedObjectArray<unsigned char> >	m_ring;
+	int		m_ringHead;
+	int		m_ringCount;
+
+	void	writeFrame(FILE* file,const DebugDrawStreamFrame& frame);
+
+public:
+
+	StreamDebugDrawer();
+	virtual ~StreamDebugDrawer();
+
+	///start a new stream file, frames are appended by endFrame until closeFile
+	bool	openFile(const char* fileName);
+	void	closeFile();
+
+	///keep the last numFrames frames in memory, 0 disables the ring buffer
+	void	setRingBufferFrames(int numFrames);
+	///write the frames of the ring buffer, oldest first, as a stream file
+	bool	saveRingBuffer(const char* fileName) const;
+
+	///finish the current frame: write it to the file and the ring buffer, and start the next one
+	void	endFrame();
+
+	unsigned int	getNumFrames() const
+	{
+		return m_frameIndex;
+	}
+	size_t	getBytesWritten() const
+	{
+		return m_bytesWritten;
+	}
+	const DebugDrawStreamFrame&	getCurrentFrame() const
+	{
+		return m_frame;
+	}
+
+	virtual void	drawLine(const btVector3& from,const btVector3& to,const btVector3& fromColor, const btVector3& toColor);
+
+	virtual void	drawLine(const btVector3& from,const btVector3& to,const btVector3& color);
+
+	virtual void	drawSphere (const btVector3& p, btScalar radius, const btVector3& color);
+
+	virtual void	drawTriangle(const btVector3& a,const btVector3& b,const btVector3& c,const btVector3& color,btScalar alpha);
+
+	virtual void	drawContactPoint(const btVector3& PointOnB,const btVector3& normalOnB,btScalar distance,int lifeTime,const btVector3& color);
+
+	virtual void	reportErrorWarning(const char* warningString);
+
+	///text is not recorded
+	virtual void	draw3dText(const btVector3& location,const char* textString);
+
+	virtual void	setDebugMode(int debugMode)
+	{
+		m_debugMode = debugMode;
+	}
+
+	virtual int		getDebugMode() const { return m_debugMode;}
+};
+
+///DebugDrawStreamReader indexes the frames of a stream file when it is opened, and reads any of them on demand
+class DebugDrawStreamReader
+{
+	FILE*	m_file;
+	btAlignedObjectArray<long>	m_frameOffsets;
+
+public:
+
+	DebugDrawStreamReader();
+	virtual ~DebugDrawStreamReader();
+
+	bool	open(const char* fileName);
+	void	close();
+
+	int		getNumFrames() const
+	{
+		return m_frameOffsets.size();
+	}
+
+	bool	readFrame(int index,DebugDrawStreamFrame& frame);
+};
+
+#endif //STREAM_DEBUG_DRAWER_H
@@ -0,0 +1,130 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "StreamingSerializer.h"
+
+#include <string.h>
+
+///placeholder keys are handed out from blocks of this many bytes
+static const int	sKeyBlockSize=4096;
+
+StreamingSerializer::StreamingSerializer(FILE* file)
+:btDefaultSerializer(0),
+m_file(file),
+m_numFreeKeys(0),
+m_writeError(!file),
+m_bytesWritten(0),
+m_numChunks(0),
+m_numLiveChunks(0),
+m_maxLiveChunks(0)
+{
+}
+
+StreamingSerializer::~StreamingSerializer()
+{
+	btAssert(!m_numLiveChunks);
+	//the pointer maps of btDefaultSerializer keep the keys until here
+	for (int i=0;i<m_keyBlocks.size();i++)
+	{
+		btAlignedFree(m_keyBlocks[i]);
+	}
+}
+
+void	StreamingSerializer::write(const void* data,size_t size)
+{
+	//after an error the chunks are still freed, but nothing is written any more
+	if (m_writeError)
+		return;
+	if (fwrite(data,1,size,m_file)!=size)
+	{
+		m_writeError = true;
+		return;
+	}
+	m_bytesWritten += size;
+}
+
+void*	StreamingSerializer::newKey()
+{
+	if (!m_numFreeKeys)
+	{
+		m_keyBlocks.push_back((char*)btAlignedAlloc(sKeyBlockSize,16));
+		m_numFreeKeys = sKeyBlockSize;
+	}
+	m_numFreeKeys--;
+	return m_keyBlocks[m_keyBlocks.size()-1]+m_numFreeKeys;
+}
+
+void*	StreamingSerializer::getKey(void* ptr)
+{
+	void** key = m_chunkKeys.find(btHashPtr(ptr));
+	return key ? *key : ptr;
+}
+
+void*	StreamingSerializer::getUniquePointer(void* oldPtr)
+{
+	return btDefaultSerializer::getUniquePointer(getKey(oldPtr));
+}
+
+const void*	StreamingSerializer::findPointer(void* oldPtr)
+{
+	return btDefaultSerializer::findPointer(getKey(oldPtr));
+}
+
+///like btDefaultSerializer::allocate, but every chunk has a block of its own, freed when it is written
+btChunk*	StreamingSerializer::allocate(size_t size,int numElements)
+{
+	const size_t length = size*size_t(numElements);
+	unsigned char* ptr = (unsigned char*)btAlignedAlloc(sizeof(btChunk)+length,16);
+	btChunk* chunk = (btChunk*)ptr;
+	//padding that the serializers leave alone is written as zeros, not as old heap contents
+	memset(ptr+sizeof(btChunk),0,length);
+	chunk->m_chunkCode = 0;
+	chunk->m_oldPtr = ptr+sizeof(btChunk);
+	chunk->m_length = int(length);
+	chunk->m_number = numElements;
+	m_chunkKeys.insert(btHashPtr(chunk->m_oldPtr),newKey());
+	m_numLiveChunks++;
+	m_maxLiveChunks = btMax(m_maxLiveChunks,m_numLiveChunks);
+	return chunk;
+}
+
+void	StreamingSerializer::finalizeChunk(btChunk* chunk,const char* structType,int chunkCode,void* oldPtr)
+{
+	//the data is complete, pointers in it are already unique ids, so the chunk can go to the file
+	void* data = (unsigned char*)chunk+sizeof(btChunk);
+	btDefaultSerializer::finalizeChunk(chunk,structType,chunkCode,getKey(oldPtr));
+	write(chunk,sizeof(btChunk)+chunk->m_length);
+	//the address may be reused from here on, its key stays taken
+	m_chunkKeys.remove(btHashPtr(data));
+	btAlignedFree(chunk);
+	m_numLiveChunks--;
+	m_numChunks++;
+}
+
+void	StreamingSerializer::startSerialization()
+{
+	btDefaultSerializer::startSerialization();
+	unsigned char header[BT_HEADER_LENGTH];
+	writeHeader(header);
+	write(header,BT_HEADER_LENGTH);
+}
+
+void	StreamingSerializer::finishSerialization()
+{
+	//not btDefaultSerializer::finishSerialization, which would gather the chunks into one buffer
+	writeDNA();
+	if (!m_writeError && fflush(m_file)!=0)
+		m_writeError = true;
+}
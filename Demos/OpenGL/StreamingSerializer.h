@@ -0,0 +1,95 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef STREAMING_SERIALIZER_H
+#define STREAMING_SERIALIZER_H
+
+#include "LinearMath/btSerializer.h"
+#include "LinearMath/btHashMap.h"
+
+#include <stdio.h>
+
+///StreamingSerializer writes a .bullet file while the world is serialized, instead of collecting it in one
+///buffer like btDefaultSerializer(maxSize). Every chunk is written to the file as soon as it is finalized and
+///freed, so there is no size limit and only the chunks under construction (a few, compound shapes nest them)
+///are in memory, besides the pointer maps of btDefaultSerializer and one byte per chunk for its key (below).
+///The file has the same header, chunks and DNA chunk (last) as with btDefaultSerializer. Only chunks allocated
+///while serializing another one, like the child array of a compound shape, come before it instead of after it.
+///The loader resolves the pointers after reading all chunks, so their order does not matter.
+///Like btDefaultSerializer, one serializer writes one world.
+///
+///btDefaultSerializer uses the address of a chunk's data as the key of its pointer maps (unique ids, written
+///pointers). A freed chunk address can come back from the allocator for a later chunk, so the chunk addresses are
+///replaced by placeholder keys, one byte each, that are never reused while the serializer lives.
+class StreamingSerializer : public btDefaultSerializer
+{
+	FILE*	m_file;
+	///data address of every chunk under construction to its placeholder key
+	btHashMap<btHashPtr,void*>		m_chunkKeys;
+	btAlignedObjectArray<char*>		m_keyBlocks;
+	int		m_numFreeKeys;
+	bool	m_writeError;
+	size_t	m_bytesWritten;
+	int		m_numChunks;
+	int		m_numLiveChunks;
+	int		m_maxLiveChunks;
+
+	void	write(const void* data,size_t size);
+	void*	newKey();
+	///the placeholder key of a chunk address, other pointers are their own key
+	void*	getKey(void* ptr);
+
+public:
+
+	///the caller opens the file ("wb") and closes it after the serialization
+	StreamingSerializer(FILE* file);
+	virtual ~StreamingSerializer();
+
+	virtual	btChunk*	allocate(size_t size,int numElements);
+	virtual	void	finalizeChunk(btChunk* chunk,const char* structType,int chunkCode,void* oldPtr);
+	virtual	void	startSerialization();
+	virtual	void	finishSerialization();
+	virtual	void*	getUniquePointer(void* oldPtr);
+	virtual	const void*	findPointer(void* oldPtr);
+
+	///nothing is kept in memory
+	virtual	const unsigned char*	getBufferPointer() const
+	{
+		return 0;
+	}
+	virtual	int		getCurrentBufferSize() const
+	{
+		return int(m_bytesWritten);
+	}
+
+	size_t	getBytesWritten() const
+	{
+		return m_bytesWritten;
+	}
+	int		getNumChunks() const
+	{
+		return m_numChunks;
+	}
+	///most chunks allocated and not yet written at the same time
+	int		getMaxLiveChunks() const
+	{
+		return m_maxLiveChunks;
+	}
+	bool	hasWriteError() const
+	{
+		return m_writeError;
+	}
+};
+
+#endif //STREAMING_SERIALIZER_H
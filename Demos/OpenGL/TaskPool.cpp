@@ -0,0 +1,187 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "TaskPool.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+#include "ThreadSupport.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+struct TaskPool::Shared
+{
+	ThreadMutex		m_mutex;
+	///a new parallelFor started, or the pool shuts down
+	ThreadCondition	m_work;
+	///the last worker finished its items
+	ThreadCondition	m_done;
+	btAlignedObjectArray<ThreadHandle>	m_threads;
+
+	int		m_generation;
+	bool	m_quit;
+	Task*	m_task;
+	int		m_count;
+	int		m_next;
+	int		m_numBusy;
+
+	///take items until none is left
+	void	runItems(int threadIndex)
+	{
+		for (;;)
+		{
+			lockMutex(m_mutex);
+			const int index = m_next < m_count ? m_next++ : -1;
+			unlockMutex(m_mutex);
+			if (index < 0)
+				return;
+			m_task->run(index,threadIndex);
+		}
+	}
+};
+
+struct WorkerStart
+{
+	TaskPool::Shared*	m_shared;
+	int					m_threadIndex;
+};
+
+static void	workerLoop(TaskPool::Shared* shared,int threadIndex)
+{
+	int generation = 0;
+	lockMutex(shared->m_mutex);
+	for (;;)
+	{
+		while (!shared->m_quit && shared->m_generation==generation)
+		{
+			waitCondition(shared->m_work,shared->m_mutex);
+		}
+		if (shared->m_quit)
+			break;
+		generation = shared->m_generation;
+		unlockMutex(shared->m_mutex);
+
+		shared->runItems(threadIndex);
+
+		lockMutex(shared->m_mutex);
+		if (--shared->m_numBusy==0)
+		{
+			broadcastCondition(shared->m_done);
+		}
+	}
+	unlockMutex(shared->m_mutex);
+}
+
+static void	workerThread(void* arg)
+{
+	WorkerStart* start = (WorkerStart*)arg;
+	TaskPool::Shared* shared = start->m_shared;
+	const int threadIndex = start->m_threadIndex;
+	delete start;
+	workerLoop(shared,threadIndex);
+}
+
+int	TaskPool::getNumProcessors()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return int(info.dwNumberOfProcessors);
+#else
+	const long numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+	return numProcessors > 0 ? int(numProcessors) : 1;
+#endif
+}
+
+TaskPool::TaskPool(int numThreads)
+:m_numThreads(numThreads > 0 ? numThreads : getNumProcessors()),
+m_shared(new Shared)
+{
+	initMutex(m_shared->m_mutex);
+	initCondition(m_shared->m_work);
+	initCondition(m_shared->m_done);
+	m_shared->m_generation = 0;
+	m_shared->m_quit = false;
+	m_shared->m_task = 0;
+	m_shared->m_count = 0;
+	m_shared->m_next = 0;
+	m_shared->m_numBusy = 0;
+
+	//the calling thread is thread 0
+	for (int i=1;i<m_numThreads;i++)
+	{
+		WorkerStart* start = new WorkerStart;
+		start->m_shared = m_shared;
+		start->m_threadIndex = i;
+		ThreadHandle thread;
+		if (!startThread(thread,workerThread,start))
+		{
+			delete start;
+			break;
+		}
+		m_shared->m_threads.push_back(thread);
+	}
+	m_numThreads = m_shared->m_threads.size()+1;
+}
+
+TaskPool::~TaskPool()
+{
+	lockMutex(m_shared->m_mutex);
+	m_shared->m_quit = true;
+	broadcastCondition(m_shared->m_work);
+	unlockMutex(m_shared->m_mutex);
+	for (int i=0;i<m_shared->m_threads.size();i++)
+	{
+		joinThread(m_shared->m_threads[i]);
+	}
+	destroyCondition(m_shared->m_done);
+	destroyCondition(m_shared->m_work);
+	destroyMutex(m_shared->m_mutex);
+	delete m_shared;
+}
+
+void	TaskPool::parallelFor(int count,Task& task)
+{
+	if (count <= 0)
+		return;
+	if (m_numThreads==1 || count==1)
+	{
+		for (int i=0;i<count;i++)
+		{
+			task.run(i,0);
+		}
+		return;
+	}
+
+	lockMutex(m_shared->m_mutex);
+	m_shared->m_task = &task;
+	m_shared->m_count = count;
+	m_shared->m_next = 0;
+	m_shared->m_numBusy = m_shared->m_threads.size();
+	m_shared->m_generation++;
+	broadcastCondition(m_shared->m_work);
+	unlockMutex(m_shared->m_mutex);
+
+	m_shared->runItems(0);
+
+	lockMutex(m_shared->m_mutex);
+	while (m_shared->m_numBusy > 0)
+	{
+		waitCondition(m_shared->m_done,m_shared->m_mutex);
+	}
+	m_shared->m_task = 0;
+	unlockMutex(m_shared->m_mutex);
+}
@@ -0,0 +1,55 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+///TaskPool keeps a few worker threads (Win32 or pthreads) waiting for parallelFor. The calling thread works
+///on the items too, so a pool of one thread runs everything inline. Items are handed out one at a time in
+///increasing order, the work done for an item must not depend on which thread runs it.
+class TaskPool
+{
+public:
+
+	struct Task
+	{
+		virtual ~Task() {}
+		///threadIndex is in [0,getNumThreads()), for per thread scratch memory
+		virtual void	run(int index,int threadIndex) = 0;
+	};
+
+	///0 threads uses one per processor
+	TaskPool(int numThreads=0);
+	~TaskPool();
+
+	///run task for every index in [0,count) and return when all are done
+	void	parallelFor(int count,Task& task);
+
+	int		getNumThreads() const
+	{
+		return m_numThreads;
+	}
+
+	static int	getNumProcessors();
+
+	///the platform threads and synchronization, only TaskPool.cpp knows them
+	struct Shared;
+
+private:
+
+	int		m_numThreads;
+	Shared*	m_shared;
+};
+
+#endif //TASK_POOL_H
@@ -0,0 +1,82 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "ThreadSupport.h"
+
+#ifdef _WIN32
+void	initMutex(ThreadMutex& mutex)		{ InitializeCriticalSection(&mutex); }
+void	destroyMutex(ThreadMutex& mutex)	{ DeleteCriticalSection(&mutex); }
+void	lockMutex(ThreadMutex& mutex)		{ EnterCriticalSection(&mutex); }
+void	unlockMutex(ThreadMutex& mutex)		{ LeaveCriticalSection(&mutex); }
+void	initCondition(ThreadCondition& cond)	{ InitializeConditionVariable(&cond); }
+void	destroyCondition(ThreadCondition&)		{}
+void	waitCondition(ThreadCondition& cond,ThreadMutex& mutex)	{ SleepConditionVariableCS(&cond,&mutex,INFINITE); }
+void	broadcastCondition(ThreadCondition& cond)	{ WakeAllConditionVariable(&cond); }
+#else
+void	initMutex(ThreadMutex& mutex)		{ pthread_mutex_init(&mutex,0); }
+void	destroyMutex(ThreadMutex& mutex)	{ pthread_mutex_destroy(&mutex); }
+void	lockMutex(ThreadMutex& mutex)		{ pthread_mutex_lock(&mutex); }
+void	unlockMutex(ThreadMutex& mutex)		{ pthread_mutex_unlock(&mutex); }
+void	initCondition(ThreadCondition& cond)	{ pthread_cond_init(&cond,0); }
+void	destroyCondition(ThreadCondition& cond)	{ pthread_cond_destroy(&cond); }
+void	waitCondition(ThreadCondition& cond,ThreadMutex& mutex)	{ pthread_cond_wait(&cond,&mutex); }
+void	broadcastCondition(ThreadCondition& cond)	{ pthread_cond_broadcast(&cond); }
+#endif //_WIN32
+
+struct ThreadStart
+{
+	ThreadEntry	m_entry;
+	void*		m_arg;
+};
+
+#ifdef _WIN32
+static DWORD WINAPI	threadMain(LPVOID arg)
+#else
+static void*	threadMain(void* arg)
+#endif
+{
+	ThreadStart* start = (ThreadStart*)arg;
+	const ThreadEntry entry = start->m_entry;
+	void* entryArg = start->m_arg;
+	delete start;
+	entry(entryArg);
+	return 0;
+}
+
+bool	startThread(ThreadHandle& thread,ThreadEntry entry,void* arg)
+{
+	ThreadStart* start = new ThreadStart;
+	start->m_entry = entry;
+	start->m_arg = arg;
+#ifdef _WIN32
+	thread = CreateThread(0,0,threadMain,start,0,0);
+	const bool created = thread!=0;
+#else
+	const bool created = pthread_create(&thread,0,threadMain,start)==0;
+#endif
+	if (!created)
+		delete start;
+	return created;
+}
+
+void	joinThread(ThreadHandle& thread)
+{
+#ifdef _WIN32
+	WaitForSingleObject(thread,INFINITE);
+	CloseHandle(thread);
+#else
+	pthread_join(thread,0);
+#endif
+}
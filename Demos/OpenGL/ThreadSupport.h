@@ -0,0 +1,49 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef THREAD_SUPPORT_H
+#define THREAD_SUPPORT_H
+
+///The few threading primitives of TaskPool and FrameCapture, on Win32 threads or pthreads, because Bullet 2.82
+///LinearMath has none. It includes windows.h or pthread.h, so only include it from .cpp files.
+#ifdef _WIN32
+#include <windows.h>
+typedef CRITICAL_SECTION	ThreadMutex;
+typedef CONDITION_VARIABLE	ThreadCondition;
+typedef HANDLE				ThreadHandle;
+#else
+#include <pthread.h>
+typedef pthread_mutex_t		ThreadMutex;
+typedef pthread_cond_t		ThreadCondition;
+typedef pthread_t			ThreadHandle;
+#endif //_WIN32
+
+void	initMutex(ThreadMutex& mutex);
+void	destroyMutex(ThreadMutex& mutex);
+void	lockMutex(ThreadMutex& mutex);
+void	unlockMutex(ThreadMutex& mutex);
+
+void	initCondition(ThreadCondition& cond);
+void	destroyCondition(ThreadCondition& cond);
+///the mutex must be locked, it is locked again when the wait returns
+void	waitCondition(ThreadCondition& cond,ThreadMutex& mutex);
+void	broadcastCondition(ThreadCondition& cond);
+
+typedef void	(*ThreadEntry)(void* arg);
+///run entry(arg) on a new thread
+bool	startThread(ThreadHandle& thread,ThreadEntry entry,void* arg);
+///wait until the thread returns and release it
+void	joinThread(ThreadHandle& thread);
+
+#endif //THREAD_SUPPORT_H
@@ -189,6 +189,8 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
 		glClearColor( .7f, 0.7f, 0.7f, 1.f );
 		
 		gDemoApplication->moveAndDisplay();
+		//the debug lines and triangles of the frame are drawn together
+		debugDraw.flush();
 
 
 		SwapBuffers( hDC );
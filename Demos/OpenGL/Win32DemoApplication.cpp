@@ -16,6 +16,7 @@ subject to the following restrictions:
 #ifdef _WINDOWS
 
 #include "Win32DemoApplication.h"
+#include "GLDebugFont.h"
 
 
 
@@ -73,6 +74,9 @@ void Win32DemoApplication::specialKeyboard(int key, int x, int y)
 
 void	Win32DemoApplication::swapBuffers()
 {
+	//Win32AppMain swaps the buffers itself, but the queued text has to be drawn before it
+	GLDebugFlushStrings();
+	captureFrame();
 }
 	
 #endif